@@ -35,15 +35,19 @@
 #include <stdio.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "dev/leds.h"
 
 #include "sys/autostart.h"
 #include "sys/rtimer.h"
 #include "sys/etimer.h"
+#include "lib/random.h"
 
 #include "glossy.h"
+#include "glossy-fec.h"
 #include "deployment.h"
+#include "reg.h"
 /*---------------------------------------------------------------------------*/
 #define XSTR(x) #x
 #define STR(x) XSTR(x)
@@ -56,6 +60,8 @@
 //#define GLOSSY_T_SLOT                   (RTIMER_SECOND / 33)        /* 30 ms*/
 #define GLOSSY_T_SLOT                   (RTIMER_SECOND / 50)       /* 20 ms*/
 #define GLOSSY_T_GUARD                  (RTIMER_SECOND / 1000)     /* 1ms */
+/* Delay of the first SFD after the start of the initiator, used with channel hopping */
+#define GLOSSY_T_FLOOD_REF              (RTIMER_SECOND / 2048)     /* ~0.5 ms */
 #ifdef GLOSSY_TEST_CONF_N_TX
 #define GLOSSY_N_TX                     GLOSSY_TEST_CONF_N_TX
 #else
@@ -68,6 +74,31 @@
 #define PAYLOAD_DATA_LEN                109
 #endif
 /*---------------------------------------------------------------------------*/
+/* Measure the CPU cycles of glossy_start()/glossy_stop() pairs instead of
+ * running the test
+ */
+#ifdef GLOSSY_TEST_CONF_BENCHMARK
+#define GLOSSY_TEST_BENCHMARK           GLOSSY_TEST_CONF_BENCHMARK
+#else
+#define GLOSSY_TEST_BENCHMARK           0
+#endif
+#define GLOSSY_TEST_BENCHMARK_N_RUNS    100
+
+/* Correct random payloads with injected byte errors instead of running the test */
+#ifdef GLOSSY_TEST_CONF_FEC_SELFTEST
+#define GLOSSY_TEST_FEC_SELFTEST        GLOSSY_TEST_CONF_FEC_SELFTEST
+#else
+#define GLOSSY_TEST_FEC_SELFTEST        0
+#endif
+#define GLOSSY_TEST_FEC_N_RUNS          200
+
+/* Encrypt the floods with a fixed key. The payload must fit next to the MAC and the NONCE. */
+#ifdef GLOSSY_TEST_CONF_ENC
+#define GLOSSY_TEST_ENC                 GLOSSY_TEST_CONF_ENC
+#else
+#define GLOSSY_TEST_ENC                 0
+#endif
+/*---------------------------------------------------------------------------*/
 /*                          PRINT MACRO DEFINITIONS                          */
 /*---------------------------------------------------------------------------*/
 #pragma message ("INITIATOR_ID:             "   STR( INITIATOR_ID ))
@@ -76,6 +107,8 @@
 #pragma message ("GLOSSY_PERIOD:            "   STR( GLOSSY_PERIOD ))
 #pragma message ("GLOSSY_SLOT:              "   STR( GLOSSY_T_SLOT ))
 #pragma message ("GLOSSY_GUARD:             "   STR( GLOSSY_T_GUARD ))
+#pragma message ("GLOSSY_TEST_BENCHMARK:    "   STR( GLOSSY_TEST_BENCHMARK ))
+#pragma message ("GLOSSY_TEST_FEC_SELFTEST: "   STR( GLOSSY_TEST_FEC_SELFTEST ))
 /*---------------------------------------------------------------------------*/
 #define WAIT_UNTIL(time) \
 {\
@@ -115,6 +148,127 @@ static bool    password_set = false;
 static bool password_check(
         const uint8_t *payload_data, const size_t payload_len,
         const uint8_t *password, const size_t password_len);
+#if GLOSSY_TEST_BENCHMARK || GLOSSY_TEST_FEC_SELFTEST
+/*---------------------------------------------------------------------------*/
+/*                 DWT cycle counter of the Cortex-M3 core                   */
+/*---------------------------------------------------------------------------*/
+#define CORE_DEMCR                      0xE000EDFC
+#define CORE_DEMCR_TRCENA               0x01000000
+#define DWT_CTRL                        0xE0001000
+#define DWT_CTRL_CYCCNTENA              0x00000001
+#define DWT_CYCCNT                      0xE0001004
+#endif /* GLOSSY_TEST_BENCHMARK || GLOSSY_TEST_FEC_SELFTEST */
+#if GLOSSY_TEST_BENCHMARK
+/*---------------------------------------------------------------------------*/
+static void
+benchmark_start_stop(const char *name, uint16_t initiator)
+{
+    uint16_t i;
+    uint32_t t_start, cycles;
+    uint32_t min = UINT32_MAX, max = 0;
+    uint64_t sum = 0;
+
+    for (i = 0; i < GLOSSY_TEST_BENCHMARK_N_RUNS; i++) {
+        t_start = REG(DWT_CYCCNT);
+        glossy_start(initiator, (uint8_t*)&glossy_payload,
+                initiator == GLOSSY_UNKNOWN_INITIATOR ? GLOSSY_UNKNOWN_PAYLOAD_LEN
+                                                      : sizeof(glossy_data_t),
+                GLOSSY_N_TX, GLOSSY_WITH_SYNC);
+        glossy_stop();
+        cycles = REG(DWT_CYCCNT) - t_start;
+
+        min = cycles < min ? cycles : min;
+        max = cycles > max ? cycles : max;
+        sum += cycles;
+    }
+
+    printf("[BENCHMARK]%s cycles min %"PRIu32", avg %"PRIu32", max %"PRIu32"\n",
+            name, min, (uint32_t)(sum / GLOSSY_TEST_BENCHMARK_N_RUNS), max);
+}
+/*---------------------------------------------------------------------------*/
+static void
+benchmark(void)
+{
+    REG(CORE_DEMCR) |= CORE_DEMCR_TRCENA;
+    REG(DWT_CYCCNT) = 0;
+    REG(DWT_CTRL) |= DWT_CTRL_CYCCNTENA;
+
+    printf("[BENCHMARK]%u start/stop pairs per run\n", GLOSSY_TEST_BENCHMARK_N_RUNS);
+
+    benchmark_start_stop("rx", GLOSSY_UNKNOWN_INITIATOR);
+    benchmark_start_stop("tx", node_id);
+
+    glossy_hold_irq_priorities(1);
+    benchmark_start_stop("rx held_irq_prio", GLOSSY_UNKNOWN_INITIATOR);
+    benchmark_start_stop("tx held_irq_prio", node_id);
+    glossy_hold_irq_priorities(0);
+}
+#endif /* GLOSSY_TEST_BENCHMARK */
+#if GLOSSY_TEST_FEC_SELFTEST
+/*---------------------------------------------------------------------------*/
+static void
+fec_selftest(void)
+{
+    /* Same size as the codewords of the test: ID header, Glossy header and payload */
+    static uint8_t cw[1 + 4 + sizeof(glossy_data_t) + GLOSSY_FEC_N_PARITY];
+    static uint8_t orig[sizeof(cw)];
+    const uint8_t msg_len = sizeof(cw) - GLOSSY_FEC_N_PARITY;
+    const uint8_t cw_len = sizeof(cw);
+    uint8_t n_err, i;
+    uint16_t run;
+
+    REG(CORE_DEMCR) |= CORE_DEMCR_TRCENA;
+    REG(DWT_CYCCNT) = 0;
+    REG(DWT_CTRL) |= DWT_CTRL_CYCCNTENA;
+
+    glossy_fec_init();
+    printf("[FEC_SELFTEST]msg_len %u, n_parity %u, %u runs per error count\n",
+            msg_len, GLOSSY_FEC_N_PARITY, GLOSSY_TEST_FEC_N_RUNS);
+
+    /* Up to two byte errors beyond what the code can correct */
+    for (n_err = 0; n_err <= GLOSSY_FEC_N_PARITY / 2 + 2; n_err++) {
+        uint16_t corrected = 0, detected = 0, miscorrected = 0;
+        uint32_t cycles, cycles_max = 0;
+        uint64_t cycles_sum = 0;
+
+        for (run = 0; run < GLOSSY_TEST_FEC_N_RUNS; run++) {
+            for (i = 0; i < msg_len; i++) {
+                cw[i] = random_rand();
+            }
+            glossy_fec_encode(cw, msg_len, &cw[msg_len]);
+            memcpy(orig, cw, cw_len);
+
+            /* Flip bits of n_err distinct bytes */
+            for (i = 0; i < n_err; ) {
+                uint8_t pos = random_rand() % cw_len;
+                if (cw[pos] == orig[pos]) {
+                    cw[pos] ^= 1 + random_rand() % 255;
+                    i++;
+                }
+            }
+
+            cycles = REG(DWT_CYCCNT);
+            int8_t ret = glossy_fec_decode(cw, cw_len);
+            cycles = REG(DWT_CYCCNT) - cycles;
+            cycles_sum += cycles;
+            cycles_max = cycles > cycles_max ? cycles : cycles_max;
+
+            if (ret < 0) {
+                detected++;
+            } else if (memcmp(cw, orig, cw_len) == 0) {
+                corrected++;
+            } else {
+                miscorrected++;
+            }
+        }
+
+        printf("[FEC_SELFTEST]n_err %u: corrected %"PRIu16", detected %"PRIu16
+                ", miscorrected %"PRIu16", cycles avg %"PRIu32", max %"PRIu32"\n",
+                n_err, corrected, detected, miscorrected,
+                (uint32_t)(cycles_sum / GLOSSY_TEST_FEC_N_RUNS), cycles_max);
+    }
+}
+#endif /* GLOSSY_TEST_FEC_SELFTEST */
 /*---------------------------------------------------------------------------*/
 PT_THREAD(glossy_thread(struct rtimer *rt))
 {
@@ -129,6 +283,8 @@ PT_THREAD(glossy_thread(struct rtimer *rt))
 
         if(node_id == initiator_id) {
 
+            /* Receivers expect the first SFD one period after the last one */
+            glossy_set_next_t_ref(rt->time + GLOSSY_T_FLOOD_REF, sizeof(glossy_data_t));
             glossy_start(node_id,
                     (uint8_t*)&glossy_payload,
                     sizeof(glossy_data_t),
@@ -184,6 +340,7 @@ PT_THREAD(glossy_thread(struct rtimer *rt))
                 bootstrapped = 1;
             } else {
                 /* already synchronized, receive a packet */
+                glossy_set_next_t_ref(t_ref, sizeof(glossy_data_t));
                 glossy_start(GLOSSY_UNKNOWN_INITIATOR, (uint8_t*)&glossy_payload,
                         GLOSSY_UNKNOWN_PAYLOAD_LEN,
                         GLOSSY_N_TX, GLOSSY_WITH_SYNC);
@@ -272,8 +429,20 @@ PROCESS_THREAD(glossy_test, ev, data)
 
     printf("Glossy successfully initialised\n");
 
+#if GLOSSY_TEST_ENC
+    {
+      static uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+      if (glossy_set_enc_key(key, GLOSSY_AES_128_KEY_SIZE) == GLOSSY_STATUS_FAIL) {
+        printf("Glossy key setup failed\n");
+        PROCESS_EXIT();
+      }
+    }
+    glossy_set_enc(GLOSSY_ENC_ON);
+#else
     // DON'T SET ENCODING
     glossy_set_enc(GLOSSY_ENC_OFF);
+#endif /* GLOSSY_TEST_ENC */
 
     // Add a password to the data payload to check for packet integrity
     glossy_payload.seq_no  = 0;
@@ -288,6 +457,16 @@ PROCESS_THREAD(glossy_test, ev, data)
     }
     previous_payload = glossy_payload;
 
+#if GLOSSY_TEST_BENCHMARK
+    benchmark();
+    PROCESS_EXIT();
+#endif /* GLOSSY_TEST_BENCHMARK */
+
+#if GLOSSY_TEST_FEC_SELFTEST
+    fec_selftest();
+    PROCESS_EXIT();
+#endif /* GLOSSY_TEST_FEC_SELFTEST */
+
     /*-----------------------------------------------------------------------*/
     // make the initiator wait a bit longer
     if(node_id == initiator_id) {
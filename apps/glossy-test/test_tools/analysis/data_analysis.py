@@ -14,6 +14,8 @@ from parser import SEQNO_ATTR, REF_RELAY_CNT_ATTR, T_SLOT_ATTR
 from parser import N_TX_ATTR, N_RX_ATTR
 from parser import N_RX_ERR_ATTR, N_RX_TIMEOUT_ATTR
 from parser import BAD_LEN_ATTR, BAD_HEADER_ATTR, BAD_PAYLOAD_ATTR, REL_CNT_FIRST_RX_ATTR
+from parser import BAD_I_HEADER_ATTR, HW_FILTERED_ATTR, FEC_CORRECTED_ATTR, CIPHER_RELAYED_ATTR
+from parser import HOP_RETUNES_ATTR, HOP_RX_OFF_BASE_ATTR
 from parser import APP_ENTRY, N_SYNC_ATTR, N_NO_SYNC_ATTR
 from parser import RTIMER_EPOCH_ATTR
 
@@ -228,6 +230,14 @@ def get_sim_trx_error_details(data):
     results.pop(N_RX_ATTR)
     results.pop(N_TX_ATTR)
     results.pop(REL_CNT_FIRST_RX_ATTR)
+    # foreign frames, not reception errors
+    results.pop(BAD_I_HEADER_ATTR, None)
+    results.pop(HW_FILTERED_ATTR, None)
+    results.pop(FEC_CORRECTED_ATTR, None)
+    results.pop(CIPHER_RELAYED_ATTR, None)
+    # channel hopping counters
+    results.pop(HOP_RETUNES_ATTR, None)
+    results.pop(HOP_RX_OFF_BASE_ATTR, None)
     detailed_errors = sum(results.values())
     results["unknown_err"] = nerrs - detailed_errors
     return results
@@ -0,0 +1,104 @@
+#!/usr/bin/python3
+"""Compare the frame rejections of two glossy-test runs, one compiled
+without and one with HW_FRAME_FILTER set.
+
+Without the filter, foreign frames are rejected in software, by the
+length check (`n_bad_length`) or by the ID header check
+(`n_bad_i_header`). With the filter, the radio drops the frames of other
+PANs before they reach the software checks (`n_hw_filtered`). Both runs
+must be taken on the same testbed and channel, with the same foreign
+traffic, for the numbers to be comparable.
+"""
+import json
+import logging
+
+from parser import get_log_data
+from parser import NODES_ENTRY, NODE_ENTRY, GLOSSY_ENTRY
+from parser import N_RX_ATTR, BAD_LEN_ATTR, BAD_I_HEADER_ATTR, HW_FILTERED_ATTR
+# -----------------------------------------------------------------------------
+logger = logging.getLogger(__name__)
+logging.basicConfig(level=logging.DEBUG)
+logging.getLogger(__name__).setLevel(level=logging.DEBUG)
+# -----------------------------------------------------------------------------
+COUNTERS = [N_RX_ATTR, BAD_LEN_ATTR, BAD_I_HEADER_ATTR, HW_FILTERED_ATTR]
+
+# Result keys
+NO_FILTER_ENTRY = "no_filter"
+FILTER_ENTRY    = "filter"
+TOTAL_ENTRY     = "total"
+SW_REJECTED_ENTRY = "sw_rejected"
+# -----------------------------------------------------------------------------
+
+def load(source, is_json, testbed):
+    if is_json:
+        with open(source, "r") as fh:
+            return json.load(fh)
+    return get_log_data(source, testbed)
+
+def get_rejections(data):
+    """Return the map <node_id, <counter, value>> of the last Glossy
+    statistics of every node, plus the frames rejected in software."""
+    rejections = {}
+    for node in data[NODES_ENTRY]:
+        stats = node.get(GLOSSY_ENTRY, {})
+        counters = {c : stats.get(c, 0) for c in COUNTERS}
+        counters[SW_REJECTED_ENTRY] = counters[BAD_LEN_ATTR] + counters[BAD_I_HEADER_ATTR]
+        rejections[node[NODE_ENTRY]] = counters
+    total = {c : sum(r[c] for r in rejections.values())\
+            for c in COUNTERS + [SW_REJECTED_ENTRY]}
+    return {NODES_ENTRY : rejections, TOTAL_ENTRY : total}
+
+def print_report(results):
+    header = "{:>6} {:>8} {:>8} {:>8} {:>8} {:>8}".format(
+            "node", "n_rx", "bad_len", "bad_ihdr", "sw_rej", "hw_filt")
+    row = "{:>6} {:>8} {:>8} {:>8} {:>8} {:>8}"
+    for title, key in (("Without the frame filter", NO_FILTER_ENTRY),\
+            ("With the frame filter", FILTER_ENTRY)):
+        print("\n" + title)
+        print(header)
+        entries = sorted(results[key][NODES_ENTRY].items())
+        entries.append((TOTAL_ENTRY, results[key][TOTAL_ENTRY]))
+        for node_id, c in entries:
+            print(row.format(node_id, c[N_RX_ATTR], c[BAD_LEN_ATTR], c[BAD_I_HEADER_ATTR],
+                c[SW_REJECTED_ENTRY], c[HW_FILTERED_ATTR]))
+    before = results[NO_FILTER_ENTRY][TOTAL_ENTRY][SW_REJECTED_ENTRY]
+    after  = results[FILTER_ENTRY][TOTAL_ENTRY][SW_REJECTED_ENTRY]
+    print("\nFrames rejected in software: {} -> {}".format(before, after))
+    if before > 0:
+        print("Reduction: {:.1f}%".format(100.0 * (before - after) / before))
+
+
+if __name__ == "__main__":
+    import argparse
+    # -------------------------------------------------------------------------
+    # PARSING ARGUMENTS
+    # -------------------------------------------------------------------------
+    parser = argparse.ArgumentParser()
+    # required arguments
+    parser.add_argument("no_filter",\
+            help="The log of the run without HW_FRAME_FILTER")
+    parser.add_argument("filter",\
+            help="The log of the run with HW_FRAME_FILTER=1")
+    # optional args
+    parser.add_argument("-j", "--json",\
+            help="When flagged, the sources are JSON files saved by parser.py",\
+            action="store_true")
+    parser.add_argument("-n", "--normal-log",\
+            help="When flagged, parsing is performed assuming the log doesn't follow the testbed format",\
+            action="store_true")
+    parser.add_argument("-s", "--save-json",\
+            help="The file where the results will be dumped in JSON format.")
+    args = parser.parse_args()
+
+    results = {
+        NO_FILTER_ENTRY: get_rejections(load(args.no_filter, args.json, not args.normal_log)),
+        FILTER_ENTRY   : get_rejections(load(args.filter, args.json, not args.normal_log))
+    }
+    print_report(results)
+
+    if args.save_json:
+        dest_file = args.save_json
+        if dest_file.split(".")[-1].lower() != "json":
+            dest_file += ".json"
+        with open(dest_file, "w") as fh:
+            json.dump(results, fh, indent=2)
@@ -49,12 +49,19 @@ RTIMER_EPOCH_ATTR = "epoch_rtimer"
 BAD_LEN_ATTR       = "n_bad_length"
 BAD_HEADER_ATTR    = "n_bad_header"
 BAD_PAYLOAD_ATTR   = "n_bad_payload"
+BAD_I_HEADER_ATTR  = "n_bad_i_header"
+HW_FILTERED_ATTR   = "n_hw_filtered"
+FEC_CORRECTED_ATTR = "n_fec_corrected"
+CIPHER_RELAYED_ATTR = "n_cipher_relayed"
+HOP_RETUNES_ATTR   = "n_hop_retunes"
+HOP_RX_OFF_BASE_ATTR = "n_hop_rx_off_base"
 
 # -----------------------------------------------------------------------------
 # SPECIFIC ERRORS
 # -----------------------------------------------------------------------------
 RF_ERROR_ATTR         = "rf_err"
 CRC_ERROR_ATTR        = "bad_crc"
+BAD_MAC_ATTR          = "n_bad_mac"
 
 # -----------------------------------------------------------------------------
 # Accepted keys: keys that can be found while parsing
@@ -64,18 +71,25 @@ GLOSSY_FLOOD_KEYS = [
     "T_slot",
     "relay_cnt_t_ref",
     "tref_ts",
-    "T_slot_estimated"
+    "T_slot_estimated",
+    "T_slot_persistent",
+    "n_tref_samples",
+    "tref_spread"
 ]
 GLOSSY_STATS_KEYS = [
     N_RX_ATTR,
     N_TX_ATTR,
     REL_CNT_FIRST_RX_ATTR,
     BAD_LEN_ATTR, BAD_HEADER_ATTR, BAD_PAYLOAD_ATTR,
+    BAD_I_HEADER_ATTR, HW_FILTERED_ATTR, FEC_CORRECTED_ATTR,
+    CIPHER_RELAYED_ATTR,
+    HOP_RETUNES_ATTR, HOP_RX_OFF_BASE_ATTR,
 ]
 ERROR_KEYS = [
         N_RX_ERR_ATTR, N_RX_TIMEOUT_ATTR,
         CRC_ERROR_ATTR,
-        RF_ERROR_ATTR
+        RF_ERROR_ATTR,
+        BAD_MAC_ATTR
 ]
 ALLOWED_KEYS = GLOSSY_FLOOD_KEYS + GLOSSY_STATS_KEYS + ERROR_KEYS
 # -----------------------------------------------------------------------------
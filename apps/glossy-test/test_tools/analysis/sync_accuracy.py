@@ -0,0 +1,209 @@
+#!/usr/bin/python3
+"""Measure the time synchronization error of Glossy across nodes.
+
+The reference time of a flood (`tref_ts`, MAC timer ticks of the node
+back-dated to the first transmission of the initiator) is logged by
+every node that received it. All nodes should therefore agree on it,
+up to the offset and the drift between their clocks.
+
+For every receiver, the reference timestamps of the floods it shares
+with the initiator are fitted with a line against those of the
+initiator. The residuals of the fit are the synchronization errors of
+the receiver. The difference of the residuals of two receivers for the
+same flood is their pairwise synchronization error.
+
+The tool requires the floods debug information, i.e. glossy-test
+compiled with GLOSSY_DEBUG set.
+"""
+import json
+import logging
+
+import numpy as np
+
+from itertools import combinations
+
+from parser import get_log_data
+from parser import NODES_ENTRY, NODE_ENTRY, BROADCAST_ENTRY, FLOODS_ENTRY, FLOOD_ENTRY
+from parser import REF_RELAY_CNT_ATTR
+# -----------------------------------------------------------------------------
+logger = logging.getLogger(__name__)
+logging.basicConfig(level=logging.DEBUG)
+logging.getLogger(__name__).setLevel(level=logging.DEBUG)
+# -----------------------------------------------------------------------------
+TREF_ATTR = "tref_ts"
+# MAC timer ticks per microsecond
+MT_TICKS_PER_US = 32
+
+# Result keys
+INITIATOR_ENTRY = "initiator"
+TO_INITIATOR_ENTRY = "to_initiator"
+PAIRWISE_ENTRY  = "pairwise"
+NODE_FIT_ENTRY  = "fit"
+# -----------------------------------------------------------------------------
+
+class SyncAccuracyException(Exception):
+
+    def __init__(self, message):
+        super(Exception, self).__init__(message)
+
+
+def get_tref_samples(data):
+    """Return the map <node_id, <seqno, (tref_ts, relay_cnt_t_ref)>>
+    of every node logging the reference time of its floods."""
+    samples = {}
+    for node in data[NODES_ENTRY]:
+        floods = {}
+        for flood in node.get(FLOODS_ENTRY, []):
+            if TREF_ATTR not in flood or REF_RELAY_CNT_ATTR not in flood:
+                continue
+            floods[flood[FLOOD_ENTRY]] = (flood[TREF_ATTR], flood[REF_RELAY_CNT_ATTR])
+        if len(floods) > 0:
+            samples[node[NODE_ENTRY]] = floods
+    return samples
+
+def get_initiator(data):
+    """Return the id of the (single) node broadcasting floods."""
+    initiators = [node[NODE_ENTRY] for node in data[NODES_ENTRY]\
+            if len(node.get(BROADCAST_ENTRY, [])) > 0]
+    if len(initiators) != 1:
+        raise SyncAccuracyException("Expected one initiator, found {}".format(initiators))
+    return initiators[0]
+
+def fit_to_initiator(ref_floods, node_floods, offset=0):
+    """Fit the reference times of a node against the ones of the
+    initiator and return the residuals in us as <seqno, (error, n_hops)>.
+
+    The `offset` first and last common floods are dropped.
+    """
+    seqnos = sorted(set(ref_floods).intersection(node_floods))
+    if offset > 0:
+        seqnos = seqnos[offset : -offset]
+    if len(seqnos) < 3:
+        return {}, None
+    x = np.array([ref_floods[s][0] for s in seqnos], dtype=np.float64)
+    y = np.array([node_floods[s][0] for s in seqnos], dtype=np.float64)
+    # center the timestamps, 40-bit values lose precision in the fit otherwise
+    x0, y0 = x[0], y[0]
+    drift, clock_offset = np.polyfit(x - x0, y - y0, 1)
+    residuals = (y - y0) - (drift * (x - x0) + clock_offset)
+    errors = {s : (residuals[i] / MT_TICKS_PER_US, node_floods[s][1] + 1)\
+            for i, s in enumerate(seqnos)}
+    # drift in ppm, how much faster the node's clock runs
+    return errors, (drift - 1) * 1e6
+
+def describe(values):
+    """Summary statistics of a list of errors in us."""
+    values = np.array(values, dtype=np.float64)
+    abs_values = np.abs(values)
+    return {
+        "n"      : int(len(values)),
+        "mean"   : float(np.mean(values)),
+        "std"    : float(np.std(values)),
+        "p50_abs": float(np.percentile(abs_values, 50)),
+        "p95_abs": float(np.percentile(abs_values, 95)),
+        "p99_abs": float(np.percentile(abs_values, 99)),
+        "max_abs": float(np.max(abs_values))
+    }
+
+def get_sync_accuracy(data, offset=0):
+    """Return the synchronization error distributions of a simulation.
+
+    * `to_initiator`: the errors of each receiver against the initiator,
+      grouped by the hop count of the flood (relay counter of the first
+      reception + 1);
+    * `pairwise`: the difference of the errors of any two receivers in
+      the same flood, grouped by the larger hop count of the two.
+    """
+    samples   = get_tref_samples(data)
+    initiator = get_initiator(data)
+    if initiator not in samples:
+        raise SyncAccuracyException("No reference times logged by the initiator {}."
+                " Was GLOSSY_DEBUG set?".format(initiator))
+    ref_floods = samples[initiator]
+
+    node_errors = {}
+    node_fit    = {}
+    for node_id, floods in samples.items():
+        if node_id == initiator:
+            continue
+        errors, drift_ppm = fit_to_initiator(ref_floods, floods, offset)
+        if len(errors) == 0:
+            logger.debug("Node {}: not enough floods in common with the initiator".format(node_id))
+            continue
+        node_errors[node_id] = errors
+        node_fit[node_id] = {"drift_ppm": drift_ppm, "n_floods": len(errors)}
+
+    to_initiator = {}
+    for errors in node_errors.values():
+        for error, n_hops in errors.values():
+            to_initiator.setdefault(n_hops, []).append(error)
+
+    pairwise = {}
+    for node_a, node_b in combinations(sorted(node_errors), 2):
+        errors_a, errors_b = node_errors[node_a], node_errors[node_b]
+        for seqno in set(errors_a).intersection(errors_b):
+            error = errors_a[seqno][0] - errors_b[seqno][0]
+            n_hops = max(errors_a[seqno][1], errors_b[seqno][1])
+            pairwise.setdefault(n_hops, []).append(error)
+
+    return {
+        INITIATOR_ENTRY   : initiator,
+        NODE_FIT_ENTRY    : node_fit,
+        TO_INITIATOR_ENTRY: {h : describe(v) for h, v in sorted(to_initiator.items())},
+        PAIRWISE_ENTRY    : {h : describe(v) for h, v in sorted(pairwise.items())}
+    }
+
+def print_sync_accuracy(results):
+    header = "{:>6} {:>8} {:>9} {:>9} {:>9} {:>9} {:>9} {:>9}".format(
+            "hops", "n", "mean", "std", "p50|e|", "p95|e|", "p99|e|", "max|e|")
+    row = "{:>6} {:>8} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f}"
+    print("Initiator: {}".format(results[INITIATOR_ENTRY]))
+    for node_id, fit in sorted(results[NODE_FIT_ENTRY].items()):
+        print("Node {:>4}: {:>5} floods, drift {:.2f} ppm".format(node_id, fit["n_floods"],
+            fit["drift_ppm"]))
+    for title, key in (("Error against the initiator [us]", TO_INITIATOR_ENTRY),\
+            ("Pairwise error [us]", PAIRWISE_ENTRY)):
+        print("\n" + title)
+        print(header)
+        for n_hops, d in results[key].items():
+            print(row.format(n_hops, d["n"], d["mean"], d["std"], d["p50_abs"], d["p95_abs"],
+                d["p99_abs"], d["max_abs"]))
+
+
+if __name__ == "__main__":
+    import argparse
+    # -------------------------------------------------------------------------
+    # PARSING ARGUMENTS
+    # -------------------------------------------------------------------------
+    parser = argparse.ArgumentParser()
+    # required arguments
+    parser.add_argument("source",\
+            help="The log file to analyse, or the JSON file saved by parser.py with -s")
+    # optional args
+    parser.add_argument("-j", "--json",\
+            help="When flagged, the source is the JSON file saved by parser.py",\
+            action="store_true")
+    parser.add_argument("-n", "--normal-log",\
+            help="When flagged, parsing is performed assuming the log doesn't follow the testbed format",\
+            action="store_true")
+    parser.add_argument("-o", "--offset", type=int, default=2,\
+            help="Number of initial and final floods to drop for each node (default 2)")
+    parser.add_argument("-s", "--save-json",\
+            help="The file where the results will be dumped in JSON format.")
+    args = parser.parse_args()
+
+    if args.json:
+        with open(args.source, "r") as fh:
+            data = json.load(fh)
+    else:
+        data = get_log_data(args.source, not args.normal_log)
+
+    results = get_sync_accuracy(data, args.offset)
+    print_sync_accuracy(results)
+
+    if args.save_json:
+        dest_file = args.save_json
+        if dest_file.split(".")[-1].lower() != "json":
+            dest_file += ".json"
+        with open(dest_file, "w") as fh:
+            json.dump(results, fh, indent=2)
@@ -40,6 +40,7 @@
 #include "lwb-debug-print.h"
 #include "lwb.h"
 #include "lwb-macros.h"
+#include "lwb-channel.h"
 
 extern lwb_context_t lwb_context;
 
@@ -75,13 +76,51 @@ void lwb_debug_print()
          lwb_context.skew,
          lwb_context.t_sync_guard);
 
-  printf("time %"PRIu32", sync rc_first_rx %"PRIu8", n_rx %"PRIu8"\n",
+  printf("time %"PRIu32", sync rc_first_rx %"PRIu8", n_rx %"PRIu8", t_ref_spread %"PRIu32"\n",
          sched->sched_info.time,
          lwb_context.sync_stats.relay_cnt_first_rx,
-         lwb_context.sync_stats.n_rx);
+         lwb_context.sync_stats.n_rx,
+         lwb_context.sync_stats.t_ref_spread);
+
+#if LWB_DYN_SLOT_LEN_ON
+  printf("time %"PRIu32", n_hops %"PRIu8", t_sync %"PRIu32", t_rr %"PRIu32", fallbacks %"PRIu16"\n",
+         sched->sched_info.time,
+         sched->sched_info.n_hops,
+         (uint32_t)T_SYNC_LEN(sched->sched_info),
+         (uint32_t)T_RR_LEN(sched->sched_info),
+         lwb_context.sched_stats.n_slot_len_fallbacks);
+#endif /* LWB_DYN_SLOT_LEN_ON */
+
+#if LWB_DYN_T_COMP_ON
+  if (lwb_context.lwb_mode == LWB_MODE_HOST) {
+    printf("time %"PRIu32", t_comp %"PRIu32", overruns %"PRIu16"\n",
+           sched->sched_info.time,
+           (uint32_t)LWB_T_COMP(),
+           lwb_context.sched_stats.n_t_comp_overruns);
+  }
+#endif /* LWB_DYN_T_COMP_ON */
+
+#if LWB_SCHED_ADMISSION_ON
+  if (lwb_context.lwb_mode == LWB_MODE_HOST) {
+    printf("time %"PRIu32", added %"PRIu16", waitlisted %"PRIu16", rejected %"PRIu16"\n",
+           sched->sched_info.time,
+           lwb_context.sched_stats.n_added,
+           lwb_context.sched_stats.n_waitlisted,
+           lwb_context.sched_stats.n_rejected);
+  }
+#endif /* LWB_SCHED_ADMISSION_ON */
+
+#if LWB_CHANNEL_SELECT_ON
+  printf("time %"PRIu32", channel_switch %"PRIu8", quality %"PRIu8", switches %"PRIu16"\n",
+         sched->sched_info.time,
+         sched->sched_info.channel_switch,
+         lwb_channel_get_quality(),
+         lwb_context.sched_stats.n_channel_switches);
+#endif /* LWB_CHANNEL_SELECT_ON */
 
   lwb_context.sync_stats.n_rx = 0;
   lwb_context.sync_stats.relay_cnt_first_rx = 0;
+  lwb_context.sync_stats.t_ref_spread = 0;
 
   printf("-------- %s --------\n", CONTIKI_VERSION_STRING);
 
@@ -33,6 +33,7 @@
  */
  
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 
 #include "contiki.h"
@@ -46,8 +47,23 @@
 PROCESS(lwb_test_process, "lwb test");
 AUTOSTART_PROCESSES(&lwb_test_process);
 
+/* The host pushes a command to every source it has heard from, up to this many, like a
+ * configuration update, and reports how long it takes until all of them have confirmed it.
+ * Sources confirm the last command in their data packets. Needs LWB_CONF_HOST_SLOTS.
+ */
+#ifdef LWB_TEST_CONF_PUSH_N_NODES
+#define LWB_TEST_PUSH_N_NODES   LWB_TEST_CONF_PUSH_N_NODES
+#else
+#define LWB_TEST_PUSH_N_NODES   0
+#endif
+#define LWB_TEST_PUSH_WAIT      60   ///< Seconds between the confirmation of a push and the next one
+#define LWB_TEST_PUSH_RETRY     30   ///< Seconds after queuing the last command to resend unconfirmed ones
+
 typedef struct __attribute__ ((__packed__)) {
   uint32_t seq;
+#if LWB_TEST_PUSH_N_NODES > 0
+  uint32_t cmd_seq;             ///< Last command received from the host
+#endif
   uint8_t data[20];
 } app_data_t;
 
@@ -59,6 +75,89 @@ static uint8_t aes_key[32];
 #define STREAM_ID    2
 #define STREAM_IPI   5
 
+#if LWB_TEST_PUSH_N_NODES > 0
+static uint16_t push_nodes[LWB_TEST_PUSH_N_NODES];
+static uint8_t  push_done[LWB_TEST_PUSH_N_NODES];
+static uint16_t n_push_nodes;
+static uint16_t n_push_queued;
+static uint16_t n_push_done;
+static uint8_t  pushing;
+static uint32_t push_seq;
+static unsigned long t_push_start;
+static unsigned long t_push_queued;
+static unsigned long t_push_end;
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Keep track of the sources and of their confirmations of the current push
+static void push_on_data(app_data_t* data_ptr, uint16_t from_id)
+{
+  uint16_t i;
+  for (i = 0; i < n_push_nodes && push_nodes[i] != from_id; i++);
+
+  if (i == n_push_nodes) {
+    if (n_push_nodes == LWB_TEST_PUSH_N_NODES) {
+      return;
+    }
+    /* A new node joins the current push or the next one */
+    push_nodes[n_push_nodes] = from_id;
+    push_done[n_push_nodes++] = 0;
+    return;
+  }
+
+  if (!pushing || push_done[i] || data_ptr->cmd_seq != push_seq) {
+    return;
+  }
+  push_done[i] = 1;
+  if (++n_push_done == n_push_nodes) {
+    pushing = 0;
+    t_push_end = clock_seconds();
+    printf("PUSH %"PRIu32" done: %"PRIu16" nodes in %lu s\n", push_seq, n_push_done,
+           t_push_end - t_push_start);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Start a push once the last one has been confirmed and queue as many commands as fit.
+///        Commands that are not confirmed in time are queued again, but only once all of them have
+///        left the TX queue, so that no source gets a command twice from the same attempt.
+static void push_commands(void)
+{
+  app_data_t cmd;
+
+  if (!pushing) {
+    if (n_push_nodes == 0 || clock_seconds() - t_push_end < LWB_TEST_PUSH_WAIT) {
+      return;
+    }
+    pushing = 1;
+    push_seq++;
+    n_push_queued = 0;
+    n_push_done = 0;
+    memset(push_done, 0, sizeof(push_done));
+    t_push_start = clock_seconds();
+    printf("PUSH %"PRIu32" start: %"PRIu16" nodes\n", push_seq, n_push_nodes);
+  } else if (n_push_queued == n_push_nodes && lwb_get_tx_q_size() == 0
+             && clock_seconds() - t_push_queued >= LWB_TEST_PUSH_RETRY) {
+    n_push_queued = 0;
+  }
+
+  if (n_push_queued == n_push_nodes) {
+    return;
+  }
+
+  memset(&cmd, 0, sizeof(app_data_t));
+  cmd.seq = push_seq;
+  while (n_push_queued < n_push_nodes) {
+    if (!push_done[n_push_queued]
+        && !lwb_queue_packet((uint8_t*)&cmd, sizeof(app_data_t), push_nodes[n_push_queued])) {
+      /* The queue is full. Go on in the next round */
+      return;
+    }
+    n_push_queued++;
+  }
+  t_push_queued = clock_seconds();
+}
+#endif /* LWB_TEST_PUSH_N_NODES > 0 */
+
 /*------------------------------------------------------------------------------------------------*/
 void on_schd_end(void)
 {
@@ -70,10 +169,44 @@ void on_data(uint8_t *data, uint8_t data_len, uint16_t from_id)
 {
   app_data_t* data_ptr = (app_data_t*)data;
   printf("DATA from %"PRIu16", seq %"PRIu32"\n", from_id, data_ptr->seq);
+#if LWB_TEST_PUSH_N_NODES > 0
+  if (node_id == LWB_HOST_ID) {
+    push_on_data(data_ptr, from_id);
+  } else if (from_id == LWB_HOST_ID) {
+    if (data_ptr->seq <= app_data.cmd_seq) {
+      /* Resent because our confirmation has not reached the host yet. Apply it only once */
+      printf("CMD %"PRIu32" duplicate\n", data_ptr->seq);
+    } else {
+      /* A new command of the host, confirm it with the next packet */
+      printf("CMD %"PRIu32"\n", data_ptr->seq);
+      app_data.cmd_seq = data_ptr->seq;
+    }
+  }
+#endif /* LWB_TEST_PUSH_N_NODES > 0 */
+#if LWB_NET_TIME_ON
+  lwb_net_time_t nt;
+  if (lwb_get_rx_net_time(&nt) == LWB_STATUS_SUCCESS) {
+    printf("DATA net time %"PRIu32".%06"PRIu32", err %"PRIu32"\n",
+           (uint32_t)(nt / RTIMER_SECOND),
+           (uint32_t)(((nt % RTIMER_SECOND) * 1000000) / RTIMER_SECOND),
+           (uint32_t)lwb_get_net_time_error());
+  }
+#endif /* LWB_NET_TIME_ON */
   /* Handle what happens to the received data in here */
 }
 
+#if LWB_SCHED_ADMISSION_ON
+/*------------------------------------------------------------------------------------------------*/
+void on_stream_ack(uint8_t stream_id, lwb_stream_result_t result)
+{
+  static const char* results[] = { "admitted", "rejected", "waitlisted" };
+  printf("STREAM %"PRIu8" %s\n", stream_id, results[result]);
+}
+
+lwb_callbacks_t callbacks = { on_data, on_schd_end, on_stream_ack };
+#else
 lwb_callbacks_t callbacks = { on_data, on_schd_end };
+#endif /* LWB_SCHED_ADMISSION_ON */
 
 /*------------------------------------------------------------------------------------------------*/
 PROCESS_THREAD(lwb_test_process, ev, data)
@@ -105,6 +238,15 @@ PROCESS_THREAD(lwb_test_process, ev, data)
     /* Enable Glossy encryption */
     glossy_set_enc(GLOSSY_ENC_ON);
 
+#if LWB_TEST_PUSH_N_NODES > 0
+    etimer_set(&et, CLOCK_SECOND);
+    while (1) {
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+      push_commands();
+      etimer_set(&et, CLOCK_SECOND);
+    }
+#endif /* LWB_TEST_PUSH_N_NODES > 0 */
+
   } else {
     /* Initialize LWB as a source */
     lwb_init(LWB_MODE_SOURCE, &callbacks);
@@ -223,6 +223,35 @@ cc2538_rf_set_tx_power(radio_value_t power)
   }
 }
 
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Enable or disable hardware frame filtering
+ * \param enable Non-zero to drop frames that do not match \e pan_id and
+ *        \e short_addr (or the broadcast PAN ID / address) in the radio
+ * \param pan_id The PAN ID to accept
+ * \param short_addr The short address to accept
+ *
+ * Only data frames are accepted. Frames rejected by the filter are removed
+ * from the RX FIFO and neither FIFOP nor RXPKTDONE is raised for them.
+ */
+void
+cc2538_rf_set_frame_filter(uint8_t enable, uint16_t pan_id, uint16_t short_addr)
+{
+  REG(RFCORE_FFSM_PAN_ID0) = pan_id & 0xFF;
+  REG(RFCORE_FFSM_PAN_ID1) = pan_id >> 8;
+  REG(RFCORE_FFSM_SHORT_ADDR0) = short_addr & 0xFF;
+  REG(RFCORE_FFSM_SHORT_ADDR1) = short_addr >> 8;
+
+  if(enable) {
+    REG(RFCORE_XREG_FRMFILT1) = RFCORE_XREG_FRMFILT1_ACCEPT_FT_1_DATA;
+    REG(RFCORE_XREG_FRMFILT0) = (REG(RFCORE_XREG_FRMFILT0)
+                                 & ~RFCORE_XREG_FRMFILT0_PAN_COORDINATOR)
+                                | RFCORE_XREG_FRMFILT0_FRAME_FILTER_EN;
+  } else {
+    REG(RFCORE_XREG_FRMFILT0) &= ~RFCORE_XREG_FRMFILT0_FRAME_FILTER_EN;
+  }
+}
+/*---------------------------------------------------------------------------*/
 int
 cc2538_rf_csp_reset(void)
 {
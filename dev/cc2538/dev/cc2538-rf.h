@@ -158,6 +158,7 @@ void cc2538_rf_set_tx_power(radio_value_t power);
 radio_value_t cc2538_rf_get_tx_power(void);
 int8_t cc2538_rf_set_channel(uint8_t channel);
 uint8_t cc2538_rf_get_channel();
+void cc2538_rf_set_frame_filter(uint8_t enable, uint16_t pan_id, uint16_t short_addr);
 
 /*---------------------------------------------------------------------------*/
 #endif /* CC2538_RF_H__ */
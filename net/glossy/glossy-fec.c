@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2026, Uppsala University, Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file   glossy-fec.c
+ *
+ * Reed-Solomon code over GF(2^8) (primitive polynomial 0x11d) with the consecutive roots
+ * alpha^0 ... alpha^(GLOSSY_FEC_N_PARITY - 1). Frames are shortened codewords: the message bytes,
+ * highest degree first, followed by the parity bytes. Decoding uses Berlekamp-Massey, a Chien
+ * search and Forney's algorithm.
+ */
+
+#include <string.h>
+
+#include "glossy-fec.h"
+
+#define GF_PRIM_POLY                  0x11d
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+/* Generator polynomial, highest degree first without the leading 1 */
+static uint8_t generator[GLOSSY_FEC_N_PARITY];
+
+/* ---------------------------------------------------------------------------------------------- */
+static inline uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+  if (a == 0 || b == 0) {
+    return 0;
+  }
+  return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+static inline uint8_t gf_div(uint8_t a, uint8_t b)
+{
+  if (a == 0) {
+    return 0;
+  }
+  return gf_exp[gf_log[a] + 255 - gf_log[b]];
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Evaluate a polynomial given lowest degree first */
+static uint8_t poly_eval_low_first(const uint8_t* p, uint8_t len, uint8_t x)
+{
+  uint8_t y = 0;
+  while (len > 0) {
+    len--;
+    y = gf_mul(y, x) ^ p[len];
+  }
+  return y;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Syndromes of a codeword. Returns non-zero if any of them is non-zero */
+static uint8_t compute_syndromes(const uint8_t* cw, uint8_t cw_len, uint8_t* s)
+{
+  uint8_t i, j;
+  uint8_t errors = 0;
+
+  for (j = 0; j < GLOSSY_FEC_N_PARITY; j++) {
+    uint8_t x = gf_exp[j];
+    uint8_t y = 0;
+    for (i = 0; i < cw_len; i++) {
+      y = gf_mul(y, x) ^ cw[i];
+    }
+    s[j] = y;
+    errors |= y;
+  }
+  return errors;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+void glossy_fec_init(void)
+{
+  uint16_t i, x = 1;
+  uint8_t j;
+
+  for (i = 0; i < 255; i++) {
+    gf_exp[i] = x;
+    gf_log[x] = i;
+    x <<= 1;
+    if (x & 0x100) {
+      x ^= GF_PRIM_POLY;
+    }
+  }
+  for (i = 255; i < 512; i++) {
+    gf_exp[i] = gf_exp[i - 255];
+  }
+  gf_log[0] = 0;
+
+  /* g(x) = (x - a^0)(x - a^1)...(x - a^(n-1)), built up lowest degree first */
+  uint8_t g[GLOSSY_FEC_N_PARITY + 1];
+  memset(g, 0, sizeof(g));
+  g[0] = 1;
+  for (i = 0; i < GLOSSY_FEC_N_PARITY; i++) {
+    for (j = i + 1; j > 0; j--) {
+      g[j] = g[j - 1] ^ gf_mul(g[j], gf_exp[i]);
+    }
+    g[0] = gf_mul(g[0], gf_exp[i]);
+  }
+  /* g[GLOSSY_FEC_N_PARITY] is 1. Store the rest highest degree first */
+  for (i = 0; i < GLOSSY_FEC_N_PARITY; i++) {
+    generator[i] = g[GLOSSY_FEC_N_PARITY - 1 - i];
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+void glossy_fec_encode(const uint8_t* msg, uint8_t msg_len, uint8_t* parity)
+{
+  uint8_t i, j;
+
+  memset(parity, 0, GLOSSY_FEC_N_PARITY);
+  /* Remainder of msg(x) * x^n divided by g(x), computed with a shift register */
+  for (i = 0; i < msg_len; i++) {
+    uint8_t feedback = msg[i] ^ parity[0];
+    for (j = 0; j < GLOSSY_FEC_N_PARITY - 1; j++) {
+      parity[j] = parity[j + 1] ^ gf_mul(feedback, generator[j]);
+    }
+    parity[GLOSSY_FEC_N_PARITY - 1] = gf_mul(feedback, generator[GLOSSY_FEC_N_PARITY - 1]);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+int8_t glossy_fec_decode(uint8_t* cw, uint8_t cw_len)
+{
+  uint8_t s[GLOSSY_FEC_N_PARITY];
+  /* Error locator, error evaluator and a temporary polynomial, lowest degree first */
+  uint8_t lambda[GLOSSY_FEC_N_PARITY + 1];
+  uint8_t prev[GLOSSY_FEC_N_PARITY + 1];
+  uint8_t tmp[GLOSSY_FEC_N_PARITY + 1];
+  uint8_t omega[GLOSSY_FEC_N_PARITY];
+  uint8_t n_errors = 0, n_found = 0;
+  uint8_t shift = 1, prev_d = 1;
+  uint8_t i, j, k;
+
+  if (cw_len <= GLOSSY_FEC_N_PARITY) {
+    return -1;
+  }
+
+  if (!compute_syndromes(cw, cw_len, s)) {
+    return 0;
+  }
+
+  /* Berlekamp-Massey */
+  memset(lambda, 0, sizeof(lambda));
+  memset(prev, 0, sizeof(prev));
+  lambda[0] = 1;
+  prev[0] = 1;
+  for (k = 0; k < GLOSSY_FEC_N_PARITY; k++) {
+    uint8_t d = s[k];
+    for (i = 1; i <= n_errors; i++) {
+      d ^= gf_mul(lambda[i], s[k - i]);
+    }
+    if (d == 0) {
+      shift++;
+      continue;
+    }
+    memcpy(tmp, lambda, sizeof(lambda));
+    uint8_t coef = gf_div(d, prev_d);
+    for (i = shift; i <= GLOSSY_FEC_N_PARITY; i++) {
+      lambda[i] ^= gf_mul(coef, prev[i - shift]);
+    }
+    if (2 * n_errors <= k) {
+      n_errors = k + 1 - n_errors;
+      memcpy(prev, tmp, sizeof(prev));
+      prev_d = d;
+      shift = 1;
+    } else {
+      shift++;
+    }
+  }
+
+  if (n_errors > GLOSSY_FEC_N_PARITY / 2) {
+    return -1;
+  }
+
+  /* Omega(x) = S(x) * Lambda(x) mod x^n */
+  for (i = 0; i < GLOSSY_FEC_N_PARITY; i++) {
+    omega[i] = 0;
+    for (j = 0; j <= i && j <= n_errors; j++) {
+      omega[i] ^= gf_mul(lambda[j], s[i - j]);
+    }
+  }
+
+  /* Chien search over the positions of the shortened codeword. Byte i has the degree
+   * cw_len - 1 - i, i.e. the error locator X = a^(cw_len - 1 - i).
+   */
+  for (i = 0; i < cw_len; i++) {
+    uint8_t deg = cw_len - 1 - i;
+    uint8_t x_inv = gf_exp[255 - deg];
+    if (poly_eval_low_first(lambda, n_errors + 1, x_inv) != 0) {
+      continue;
+    }
+    /* Forney: e = X * Omega(X^-1) / Lambda'(X^-1). Lambda' keeps the odd terms only */
+    uint8_t num = poly_eval_low_first(omega, GLOSSY_FEC_N_PARITY, x_inv);
+    uint8_t den = 0;
+    for (j = 1; j <= n_errors; j += 2) {
+      den ^= gf_mul(lambda[j], gf_exp[(uint16_t)(255 - deg) * (j - 1) % 255]);
+    }
+    if (den == 0) {
+      return -1;
+    }
+    cw[i] ^= gf_mul(gf_exp[deg], gf_div(num, den));
+    n_found++;
+  }
+
+  if (n_found != n_errors || compute_syndromes(cw, cw_len, s)) {
+    return -1;
+  }
+
+  return n_found;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2026, Uppsala University, Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \defgroup glossy-fec Reed-Solomon forward error correction for Glossy frames
+ * @{
+ * \file   glossy-fec.h
+ * \file   glossy-fec.c
+ */
+
+#ifndef GLOSSY_FEC_H_
+#define GLOSSY_FEC_H_
+
+#include <inttypes.h>
+
+/**
+ * Number of parity bytes appended to a frame. Up to half of it corrupted bytes are corrected.
+ */
+#ifdef GLOSSY_FEC_CONF_N_PARITY
+#define GLOSSY_FEC_N_PARITY           GLOSSY_FEC_CONF_N_PARITY
+#else
+#define GLOSSY_FEC_N_PARITY           8
+#endif
+
+#if (GLOSSY_FEC_N_PARITY < 2) || (GLOSSY_FEC_N_PARITY > 32) || (GLOSSY_FEC_N_PARITY % 2)
+#error "GLOSSY_FEC_N_PARITY must be an even number between 2 and 32"
+#endif
+
+/**
+ * @brief Initialize the Galois field tables. Must be called before encoding or decoding.
+ */
+void glossy_fec_init(void);
+
+/**
+ * @brief       Compute the parity bytes of a message (systematic RS code over GF(256))
+ * @param[in]   msg     Pointer to the message
+ * @param[in]   msg_len Length of the message, at most 255 - GLOSSY_FEC_N_PARITY
+ * @param[out]  parity  GLOSSY_FEC_N_PARITY bytes of parity
+ */
+void glossy_fec_encode(const uint8_t* msg, uint8_t msg_len, uint8_t* parity);
+
+/**
+ * @brief          Correct a codeword in place
+ * @param[in,out]  cw     Pointer to the message followed by its parity bytes
+ * @param[in]      cw_len Length of the message plus GLOSSY_FEC_N_PARITY
+ * @return         Number of corrected bytes, or -1 if the codeword could not be corrected
+ */
+int8_t glossy_fec_decode(uint8_t* cw, uint8_t cw_len);
+
+#endif /* GLOSSY_FEC_H_ */
+
+/** @} */
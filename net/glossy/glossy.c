@@ -153,15 +153,228 @@
 #define GLOSSY_RX_MAJORITY_VOTE   0
 #endif
 
+/* Use RX/TX handlers specialized for the mode of the flood (encryption, initiator or relay, sync
+ * option). They are selected once per flood instead of checking the mode for every packet.
+ */
+#ifdef GLOSSY_CONF_ISR_SPECIALIZE
+#define GLOSSY_ISR_SPECIALIZE     GLOSSY_CONF_ISR_SPECIALIZE
+#else
+#define GLOSSY_ISR_SPECIALIZE     0
+#endif
+
+/* Measure CPU cycles and stack use of the RF RX/TX ISR. See glossy_get_isr_profile() */
+#ifdef GLOSSY_CONF_ISR_PROFILE
+#define GLOSSY_ISR_PROFILE        GLOSSY_CONF_ISR_PROFILE
+#else
+#define GLOSSY_ISR_PROFILE        0
+#endif
+
+/* Prepend an IEEE 802.15.4 data frame MAC header to every Glossy frame and let the radio drop
+ * frames of other PANs (Zigbee, Thread, ...) before they raise FIFOP/RXPKTDONE interrupts.
+ * All nodes of a network must use the same setting and the same GLOSSY_PAN_ID. The 7 bytes cost
+ * 224 us of airtime in every slot of a flood, see the README.
+ */
+#ifdef GLOSSY_CONF_HW_FRAME_FILTER
+#define GLOSSY_HW_FRAME_FILTER    GLOSSY_CONF_HW_FRAME_FILTER
+#else
+#define GLOSSY_HW_FRAME_FILTER    0
+#endif
+
+/* PAN ID of Glossy frames with GLOSSY_HW_FRAME_FILTER. Must differ from co-located networks */
+#ifdef GLOSSY_CONF_PAN_ID
+#define GLOSSY_PAN_ID             GLOSSY_CONF_PAN_ID
+#else
+#define GLOSSY_PAN_ID             0x4c57
+#endif
+
+/* Append Reed-Solomon parity to every frame, behind the nonce of encrypted ones. Receivers keep a
+ * frame that failed the CRC check and try to correct it at the end of a flood without any valid
+ * reception, before its MIC is checked. See glossy-fec.h
+ */
+#ifdef GLOSSY_CONF_FEC
+#define GLOSSY_FEC                GLOSSY_CONF_FEC
+#else
+#define GLOSSY_FEC                0
+#endif
+
+#if GLOSSY_FEC
+#include <stddef.h>
+#include "glossy-fec.h"
+#endif /* GLOSSY_FEC */
+
+/* Change the channel at every relay step of floods with a relay counter. A frame with relay counter
+ * c is sent on the channel set with glossy_set_channel() plus GLOSSY_CHANNEL_HOPPING_OFFSETS[c % n].
+ * Receivers that were told the reference time of the flood with glossy_set_next_t_ref() follow the
+ * relay steps from it until their first reception. Other nodes that have not received anything yet
+ * listen on the base channel, so the sequence has to return to offset 0 for transmitters of either
+ * parity of the relay counter.
+ */
+#ifdef GLOSSY_CONF_CHANNEL_HOPPING
+#define GLOSSY_CHANNEL_HOPPING            GLOSSY_CONF_CHANNEL_HOPPING
+#else
+#define GLOSSY_CHANNEL_HOPPING            0
+#endif
+
+/* Channel offsets of the relay steps, wrapping around within channels 11 - 26 */
+#ifdef GLOSSY_CONF_CHANNEL_HOPPING_OFFSETS
+#define GLOSSY_CHANNEL_HOPPING_OFFSETS    GLOSSY_CONF_CHANNEL_HOPPING_OFFSETS
+#else
+#define GLOSSY_CHANNEL_HOPPING_OFFSETS    { 0, 0, 5 }
+#endif
+
+/* Time in us added to every relay step for changing the channel. Relays write FREQCTRL before the
+ * RX/TX turnaround, and the synthesizer calibration that is part of every turnaround applies it, so
+ * retuning does not add to RF_TRUNAROUND_TIME. Raise it if the measured slots say otherwise.
+ */
+#ifdef GLOSSY_CONF_CHANNEL_HOPPING_T_RETUNE
+#define GLOSSY_CHANNEL_HOPPING_T_RETUNE   GLOSSY_CONF_CHANNEL_HOPPING_T_RETUNE
+#else
+#define GLOSSY_CHANNEL_HOPPING_T_RETUNE   0
+#endif
+
+/* Time in us by which receivers following the relay steps tune to the channel of a step before its
+ * frame is expected. Covers the error of the reference time given to glossy_set_next_t_ref(), which
+ * is at least one rtimer tick, and the drift of the relay steps from the slot formula. Retuning is
+ * skipped while a frame is being received.
+ */
+#ifdef GLOSSY_CONF_CHANNEL_HOPPING_GUARD
+#define GLOSSY_CHANNEL_HOPPING_GUARD      GLOSSY_CONF_CHANNEL_HOPPING_GUARD
+#else
+#define GLOSSY_CHANNEL_HOPPING_GUARD      100
+#endif
+
+#if GLOSSY_CHANNEL_HOPPING
+#define T_HOP_RETUNE_US                   GLOSSY_CHANNEL_HOPPING_T_RETUNE
+#else
+#define T_HOP_RETUNE_US                   0
+#endif
+
+/* With encryption, send the Glossy header in the clear and encrypt only the payload, so that relays
+ * forward the ciphertext unchanged and only update the relay counter. The initiator encrypts once
+ * per flood, and receivers verify the MIC of their first reception once in glossy_stop(). The
+ * initiator ID and the configuration word are authenticated, the relay counter is not. Relays
+ * forward forged frames, which their receivers then drop.
+ */
+#ifdef GLOSSY_CONF_ENC_RELAY_CIPHER
+#define GLOSSY_ENC_RELAY_CIPHER           GLOSSY_CONF_ENC_RELAY_CIPHER
+#else
+#define GLOSSY_ENC_RELAY_CIPHER           0
+#endif
+
+#if GLOSSY_ENC_RELAY_CIPHER && GLOSSY_RX_MAJORITY_VOTE
+#error "GLOSSY_CONF_ENC_RELAY_CIPHER cannot be used with GLOSSY_CONF_RX_MAJORITY_VOTE"
+#endif
+
+/* Testing only: the node with this ID flips a bit of the ciphertext of the encrypted frames it
+ * relays and keeps the MIC, as an attacker could. Its neighbours must drop these frames. 0 disables.
+ */
+#ifdef GLOSSY_CONF_FORGE_NODE
+#define GLOSSY_FORGE_NODE                 GLOSSY_CONF_FORGE_NODE
+#else
+#define GLOSSY_FORGE_NODE                 0
+#endif
+
+/* Keep a smoothed slot length per frame length and encryption state across floods. It replaces the
+ * packet length formula when glossy_stop() back-dates the reference time of a flood in which no
+ * TX/RX pair has been measured, e.g. on nodes that receive for the first time at a high relay count.
+ */
+#ifdef GLOSSY_CONF_SLOT_ESTIMATOR
+#define GLOSSY_SLOT_ESTIMATOR             GLOSSY_CONF_SLOT_ESTIMATOR
+#else
+#define GLOSSY_SLOT_ESTIMATOR             0
+#endif
+
+/* Number of (frame length, encryption) pairs remembered, the least recently updated is replaced */
+#ifdef GLOSSY_CONF_SLOT_EST_N_ENTRIES
+#define GLOSSY_SLOT_EST_N_ENTRIES         GLOSSY_CONF_SLOT_EST_N_ENTRIES
+#else
+#define GLOSSY_SLOT_EST_N_ENTRIES         4
+#endif
+
+/* Weight of a new flood in the estimate is 1 / 2^GLOSSY_SLOT_EST_SHIFT */
+#ifdef GLOSSY_CONF_SLOT_EST_SHIFT
+#define GLOSSY_SLOT_EST_SHIFT             GLOSSY_CONF_SLOT_EST_SHIFT
+#else
+#define GLOSSY_SLOT_EST_SHIFT             3
+#endif
+
+/* Floods whose mean slot length is further away from the estimate are ignored (in us). The estimate
+ * restarts from the measurement after GLOSSY_SLOT_EST_N_OUTLIERS such floods in a row.
+ */
+#ifdef GLOSSY_CONF_SLOT_EST_MAX_DEV
+#define GLOSSY_SLOT_EST_MAX_DEV           GLOSSY_CONF_SLOT_EST_MAX_DEV
+#else
+#define GLOSSY_SLOT_EST_MAX_DEV           16
+#endif
+
+#ifdef GLOSSY_CONF_SLOT_EST_N_OUTLIERS
+#define GLOSSY_SLOT_EST_N_OUTLIERS        GLOSSY_CONF_SLOT_EST_N_OUTLIERS
+#else
+#define GLOSSY_SLOT_EST_N_OUTLIERS        4
+#endif
+
+/* Combine the timestamps of all receptions and transmissions of a flood, each back-dated by its relay
+ * count times the measured slot length, into the reference time instead of using only the first one.
+ */
+#ifdef GLOSSY_CONF_T_REF_MULTI
+#define GLOSSY_T_REF_MULTI                GLOSSY_CONF_T_REF_MULTI
+#else
+#define GLOSSY_T_REF_MULTI                0
+#endif
+
+/* One-byte initiator ID in the Glossy header, for networks whose node IDs are all below 256 */
+#ifdef GLOSSY_CONF_SHORT_INITIATOR
+#define GLOSSY_SHORT_INITIATOR            GLOSSY_CONF_SHORT_INITIATOR
+#else
+#define GLOSSY_SHORT_INITIATOR            0
+#endif
+
+/* Length of the AES-CCM MIC of encrypted frames: 4, 6, 8, 10, 12, 14 or 16 bytes */
+#ifdef GLOSSY_CONF_SEC_MAC_LEN
+#define GLOSSY_SEC_MAC_LEN                GLOSSY_CONF_SEC_MAC_LEN
+#else
+#define GLOSSY_SEC_MAC_LEN                16
+#endif
+
+#if GLOSSY_CHANNEL_HOPPING
+static const uint8_t hop_offsets[] = GLOSSY_CHANNEL_HOPPING_OFFSETS;
+#define N_HOP_STEPS                       (sizeof(hop_offsets) / sizeof(hop_offsets[0]))
+#define N_RF_CHANNELS                     (CC2538_RF_CHANNEL_MAX - CC2538_RF_CHANNEL_MIN + 1)
+#endif /* GLOSSY_CHANNEL_HOPPING */
+
 /*
  * The Glossy frame format with byte offsets of different fields (without encryption)
  * 0          4     5     6         7                                 2 bytes
  * +--------------------------------------------------------------------------+
  * | PREAMBLE | SFD | LEN | IHEADER | GLOSSY HEADER | GLOSSY PAYLOAD | FOOTER |
  * +--------------------------------------------------------------------------+
+ *
+ * With GLOSSY_HW_FRAME_FILTER, a 7 bytes MAC header (MHR) precedes the ID header
+ * 0          4     5     6                                            2 bytes
+ * +------------------------------------------------------------------------------+
+ * | PREAMBLE | SFD | LEN | MHR | IHEADER | GLOSSY HEADER | GLOSSY PAYLOAD | FOOTER |
+ * +------------------------------------------------------------------------------+
  */
 
-#define GLOSSY_MIN_PKT_LEN_PLAIN      6   // ID header (1) + glossy header (>3) + FCS (2) = 6
+#if GLOSSY_HW_FRAME_FILTER
+/*
+ * MAC header: frame control (2), sequence number (1), destination PAN ID (2) and the broadcast
+ * short address (2). Data frame, no security, no ACK request, no source address.
+ */
+#define MHR_LEN                       7
+#define MHR_FCF0                      0x01  // Frame type: data
+#define MHR_FCF1                      0x08  // Short destination address, no source address
+#define MHR_BROADCAST_ADDR            0xffff
+#else
+#define MHR_LEN                       0
+#endif /* GLOSSY_HW_FRAME_FILTER */
+
+// MHR + ID header (1) + glossy header (>3, >2 with short initiator IDs) + FCS (2)
+#if GLOSSY_SHORT_INITIATOR
+#define GLOSSY_MIN_PKT_LEN_PLAIN      (MHR_LEN + 5)
+#else
+#define GLOSSY_MIN_PKT_LEN_PLAIN      (MHR_LEN + 6)
+#endif /* GLOSSY_SHORT_INITIATOR */
 #define GLOSSY_PROCESSING_TIME        50  // in us
 #define GLOSSY_N_TX_MAX_GLOBAL        8   // Absolute maximum number of transmissions
 #define GLOSSY_BUFFER_LEN             130
@@ -177,26 +390,42 @@
  * Identification header format with bit offsets
  * 8                 2          1          0
  * +---------------------------------------+
- * | Glossy ID Magic | reserved | enc flag |
+ * | Glossy ID Magic | FEC flag | enc flag |
  * +---------------------------------------+
  */
 
-#define BUF_TXRX_IHEADER_OFFSET         0
+#define BUF_TXRX_IHEADER_OFFSET         MHR_LEN
 #define BUF_TXRX_IHEADER_FIELD          tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET]
-#define BUF_TXRX_G_PKT_OFFSET           1
+#define BUF_TXRX_G_PKT_OFFSET           (MHR_LEN + 1)
 #define BUF_TXRX_G_PAYLOAD_OFFSET(cfg)  BUF_TXRX_G_PKT_OFFSET + GET_GLOSSY_HEADER_LEN(cfg)
 
 #define IHEADER_MAGIC                   0xa8
 #define IHEADER_MAGIC_MASK              0xfc
 #define IHEADER_ENC_FLAG                0x01
 #define IHEADER_ENC_FLAG_MASK           0x01
+#define IHEADER_FEC_FLAG                0x02
+#define IHEADER_FEC_FLAG_MASK           0x02
 #define IHEADER_LEN                     1
+/* Everything in front of the Glossy header */
+#define FRAME_HEADER_LEN                (MHR_LEN + IHEADER_LEN)
 
 #define GET_IHEADER_MAGIC(id)           ((id) & IHEADER_MAGIC_MASK)
 #define SET_IHEADER_MAGIC(id)           (id) = ((id) & ~IHEADER_MAGIC_MASK) | IHEADER_MAGIC
 #define GET_IHEADER_ENC_FLAG(id)        ((id) & IHEADER_ENC_FLAG_MASK)
 #define SET_IHEADER_ENC_FLAG(id)        (id) = ((id) & ~IHEADER_ENC_FLAG_MASK) | IHEADER_ENC_FLAG
 #define CLR_IHEADER_ENC_FLAG(id)        (id) &= ~IHEADER_ENC_FLAG_MASK
+#define GET_IHEADER_FEC_FLAG(id)        ((id) & IHEADER_FEC_FLAG_MASK)
+#define SET_IHEADER_FEC_FLAG(id)        (id) = ((id) & ~IHEADER_FEC_FLAG_MASK) | IHEADER_FEC_FLAG
+#define CLR_IHEADER_FEC_FLAG(id)        (id) &= ~IHEADER_FEC_FLAG_MASK
+
+/* Parity bytes at the end of the frame, after the MIC and the nonce of encrypted frames */
+#if GLOSSY_FEC
+#define FEC_PARITY_LEN                  GLOSSY_FEC_N_PARITY
+#define FEC_LEN(id)                     (GET_IHEADER_FEC_FLAG(id) ? GLOSSY_FEC_N_PARITY : 0)
+#else
+#define FEC_PARITY_LEN                  0
+#define FEC_LEN(id)                     0
+#endif /* GLOSSY_FEC */
 
 /*
  * Configuration word format with bit offsets
@@ -207,7 +436,11 @@
  */
 
 typedef struct {
+#if GLOSSY_SHORT_INITIATOR
+  uint8_t  initiator_id;  /**< ID of the initiator */
+#else
   uint16_t initiator_id;  /**< ID of the initiator */
+#endif /* GLOSSY_SHORT_INITIATOR */
   uint8_t  config;        /**< Configuration word. See above for the format */
   uint8_t  relay_cnt;     /**< This is optional   */
 } glossy_header_t;
@@ -232,7 +465,9 @@ typedef struct {
 #define FOOTER1_RSSI_FIELD                      g_cntxt.tx_rx_buffer[g_cntxt.tx_rx_len - 2]
 #define FOOTER1_CRC_FIELD                       g_cntxt.tx_rx_buffer[g_cntxt.tx_rx_len - 1]
 
-#define GET_GLOSSY_HEADER_LEN(cfg)              (GET_GLOSSY_HEADER_SYNC_OPT(cfg) == GLOSSY_WITHOUT_SYNC ? 3 : 4)
+#define GLOSSY_HEADER_LEN_NO_RELAY_CNT          (sizeof(glossy_header_t) - 1)
+#define GET_GLOSSY_HEADER_LEN(cfg)              (GET_GLOSSY_HEADER_SYNC_OPT(cfg) == GLOSSY_WITHOUT_SYNC \
+                                                 ? GLOSSY_HEADER_LEN_NO_RELAY_CNT : sizeof(glossy_header_t))
 
 #define WITH_SYNC(cfg)                          (GET_GLOSSY_HEADER_SYNC_OPT(cfg) == GLOSSY_WITH_SYNC)
 
@@ -240,9 +475,35 @@ typedef struct {
 
 #define IS_INITIATOR()                          (g_cntxt.crr_header.initiator_id == node_id)
 
+/*
+ * Mode parameters of the RX/TX handler templates. Handlers instantiated with constants contain only
+ * the code of their mode. ISR_ANY evaluates the mode at runtime.
+ */
+#define ISR_ANY                                 0xff
+#define ISR_ENC(enc)                            ((enc) == ISR_ANY \
+                                                 ? GET_IHEADER_ENC_FLAG(g_cntxt.id_header) == IHEADER_ENC_FLAG \
+                                                 : (enc))
+#define ISR_INITIATOR(init)                     ((init) == ISR_ANY ? IS_INITIATOR() : (init))
+#define ISR_SYNC_OPT(sync)                      ((sync) == ISR_ANY \
+                                                 ? GET_GLOSSY_HEADER_SYNC_OPT(g_cntxt.crr_header.config) \
+                                                 : (sync))
+#define ISR_WITH_SYNC(sync)                     (ISR_SYNC_OPT(sync) == GLOSSY_WITH_SYNC)
+#define ISR_WITH_RELAY_CNT(sync)                (ISR_WITH_SYNC(sync) \
+                                                 || ISR_SYNC_OPT(sync) == GLOSSY_ONLY_RELAY_CNT)
+#define ISR_HEADER_LEN(sync)                    (ISR_SYNC_OPT(sync) == GLOSSY_WITHOUT_SYNC \
+                                                 ? GLOSSY_HEADER_LEN_NO_RELAY_CNT : sizeof(glossy_header_t))
+
+#define ISR_TEMPLATE                            static inline __attribute__((always_inline))
+
 #define BUF_PLAIN_DATA_OFFSET(cfg)              (BUF_PLAIN_HEADER_OFFSET + GET_GLOSSY_HEADER_LEN(cfg))
 
 
+#define DWT_CTRL                                0xE0001000
+#define DWT_CTRL_CYCCNTENA                      0x00000001
+#define DWT_CYCCNT                              0xE0001004
+#define CORE_DEMCR                              0xE000EDFC
+#define CORE_DEMCR_TRCENA                       0x01000000
+
 #define IRQ_PRIORITY_GROUPING                   0
 #define N_IRQ_PRIORITY_VALS                     12
 
@@ -259,10 +520,13 @@ typedef struct {
 #define IRQ_PRIORITY_IDX_UART0_IRQ              10
 #define IRQ_PRIORITY_IDX_UART1_IRQ              11
 
-#define GLOSSY_SEC_MAC_LEN                      16
 #define GLOSSY_SEC_NONCE_LEN                    13
 #define GLOSSY_SEC_AES_LEN_LEN                  2
 #define GLOSSY_SEC_KEY_AREA                     0
+/* With GLOSSY_ENC_RELAY_CIPHER, the ID header and the Glossy header up to the relay counter are
+ * authenticated, but not encrypted
+ */
+#define CIPHER_ADATA_LEN                        (IHEADER_LEN + GLOSSY_HEADER_LEN_NO_RELAY_CNT)
 
 typedef struct {
   uint8_t data[GLOSSY_BUFFER_LEN];
@@ -271,6 +535,16 @@ typedef struct {
 } glossy_payload_t;
 
 
+#if GLOSSY_SLOT_ESTIMATOR
+typedef struct {
+  uint32_t T_slot;                 /**< Smoothed slot length in MAC timer ticks, zero if unused */
+  uint8_t  len;                    /**< Frame length (tx_rx_len) */
+  uint8_t  enc;                    /**< Encryption flag of the ID header */
+  uint8_t  n_outliers;             /**< Consecutive floods rejected as outliers */
+  uint8_t  age;                    /**< Floods since the last update */
+} slot_estimate_t;
+#endif /* GLOSSY_SLOT_ESTIMATOR */
+
 typedef struct {
 
   uint64_t sfd_time;               /**< MAC timer timestamp when the SFD is received or sent. */
@@ -295,13 +569,25 @@ typedef struct {
 
   uint64_t T_slot_estimated;       /**< An estimation of the slot length based on the packet length
                                         after the first transmission/reception */
-  uint64_t T_slot_sum;             /**< Summation of slot times. */
+  uint32_t T_slot_sum;             /**< Summation of slot times. */
   uint8_t  n_T_slots;              /**< Number of slots in the Glossy flood. */
+#if GLOSSY_T_REF_MULTI
+  uint32_t t_ref_offset[2 * GLOSSY_N_TX_MAX_GLOBAL]; /**< SFD times of the flood relative to t_ref_mtt */
+  uint8_t  t_ref_relay_cnt[2 * GLOSSY_N_TX_MAX_GLOBAL]; /**< Relay counts of these frames */
+  uint8_t  n_t_ref_samples;        /**< Number of timestamps taken in the flood */
+  uint32_t t_ref_spread;           /**< Spread of the back-dated timestamps in MAC timer ticks */
+#endif /* GLOSSY_T_REF_MULTI */
+#if GLOSSY_SLOT_ESTIMATOR
+  uint8_t  t_ref_len;              /**< Frame length of the flood when the reference was taken */
+  uint8_t  t_ref_enc;              /**< Encryption flag of the flood when the reference was taken */
+  uint32_t T_slot_persistent;      /**< Slot length used from the persistent estimate, else zero */
+#endif /* GLOSSY_SLOT_ESTIMATOR */
 
   uint8_t         id_header;       /**< Identification header */
   glossy_header_t crr_header;      /**< Current Glossy header */
 
   uint8_t         relay_cnt_last_rx;  /**< Last received relay count. */
+  uint8_t         relay_cnt_first_rx; /**< Received relay count of the first reception. */
   uint8_t         relay_cnt_last_tx;  /**< Last sent relay count. */
 
   uint8_t* payload;               /**< A pointer to the Glossy's payload */
@@ -313,24 +599,94 @@ typedef struct {
 #endif
 
   glossy_stats_t stats;            /**< Glossy statistics */
+#if GLOSSY_HW_FRAME_FILTER
+  uint8_t  rx_pending;             /**< SFD received, waiting for RXPKTDONE */
+  uint8_t  rx_accepted;            /**< The radio raised FRAME_ACCEPTED for the pending frame */
+#endif /* GLOSSY_HW_FRAME_FILTER */
+#if GLOSSY_FEC
+  uint8_t  fec_buffer[GLOSSY_BUFFER_LEN]; /**< First frame of the flood that failed the CRC check */
+  uint8_t  fec_len;                /**< Length of the frame in fec_buffer, zero if there is none */
+#endif /* GLOSSY_FEC */
+#if GLOSSY_CHANNEL_HOPPING
+  uint32_t base_freqctrl;          /**< FREQCTRL value of the channel set with glossy_set_channel() */
+  uint32_t hop_freqctrl[N_HOP_STEPS]; /**< FREQCTRL value of each relay step */
+  uint64_t hop_t_ref;              /**< Reference time of the next flood in MAC timer ticks */
+  uint32_t hop_T_step;             /**< Relay step length of the next flood, zero if unknown */
+  uint32_t rt_to_mtt;              /**< System clock / RTIMER_SECOND as 16.16 fixed-point number */
+  uint8_t  hop_t_ref_set;          /**< hop_t_ref has been set for the next flood */
+  uint8_t  hop_lock;               /**< Following the relay steps, nothing received yet */
+  uint8_t  hop_step;               /**< Relay step whose channel is tuned to next */
+#endif /* GLOSSY_CHANNEL_HOPPING */
   uint32_t rf_err_reg_last;        /**< Content of RF_ERR register (for debugging) */
 
   uint8_t irq_priority_grouping;
   uint8_t irq_priorities[N_IRQ_PRIORITY_VALS];
+  uint8_t irq_priorities_held;     /**< Glossy priorities are kept between floods */
+
+  uint32_t mtt_to_rt;              /**< RTIMER_SECOND / system clock as 0.32 fixed-point number */
 
   glossy_enc_t enc;                    /**< State if AES encryption is enabled/disabled. */
+  uint8_t aes_used;                    /**< The cryptoprocessor was started during this flood */
   uint8_t nonce[GLOSSY_SEC_NONCE_LEN]; /**< Holds the NONCE */
   uint8_t mac[GLOSSY_SEC_MAC_LEN];     /**< Holds the MAC of the encrypted data */
+#if GLOSSY_ENC_RELAY_CIPHER
+  uint8_t verify_buffer[GLOSSY_BUFFER_LEN];  /**< First frame received in the flood, MIC unchecked */
+  uint8_t verify_len;                        /**< Its Glossy packet length, zero if there is none */
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
 
   volatile glossy_state_t state;
 
+#if GLOSSY_ISR_SPECIALIZE
+  const struct glossy_isr* isr;        /**< RX/TX handlers of the current flood */
+#endif
+#if GLOSSY_ISR_PROFILE
+  glossy_isr_profile_t isr_profile;
+  uint32_t isr_sp_entry;               /**< Stack pointer when the ISR was entered */
+  uint32_t isr_sp_min;                 /**< Lowest stack pointer seen during the ISR */
+#endif
+
 } glossy_context_t;
 
 static glossy_context_t g_cntxt;
 
-static void process_received_data();
+#if GLOSSY_SLOT_ESTIMATOR
+static slot_estimate_t slot_est[GLOSSY_SLOT_EST_N_ENTRIES]; /**< Kept across floods */
+#endif /* GLOSSY_SLOT_ESTIMATOR */
+
+/**
+ * RX/TX handlers of one flood mode
+ */
+typedef struct glossy_isr {
+  void (*rx_started)(void);
+  void (*rx_ended)(void);
+  void (*tx_ended)(void);
+  void (*process_received_data)(void);
+} glossy_isr_t;
+
+#if GLOSSY_ISR_SPECIALIZE
+#define GLOSSY_ISR_CALL(handler)                g_cntxt.isr->handler()
+static void select_isr(void);
+#else
+#define GLOSSY_ISR_CALL(handler)                glossy_##handler##_generic()
+static void glossy_process_received_data_generic(void);
+#endif
+
+#if GLOSSY_ISR_PROFILE
+#define GLOSSY_ISR_PROFILE_STACK()              do { \
+                                                  uint32_t sp; \
+                                                  __asm volatile ("mov %0, sp" : "=r" (sp)); \
+                                                  if (sp < g_cntxt.isr_sp_min) { \
+                                                    g_cntxt.isr_sp_min = sp; \
+                                                  } \
+                                                } while (0)
+#else
+#define GLOSSY_ISR_PROFILE_STACK()
+#endif
 static inline void mt_disable_cmp_events(void);
 static inline void radio_abort_tx(void);
+#if GLOSSY_CHANNEL_HOPPING
+static void hop_lock_schedule(void);
+#endif /* GLOSSY_CHANNEL_HOPPING */
 
 /* ---------------------------------------------------------------------------------------------- */
 /**
@@ -387,6 +743,95 @@ static inline void copy_from_rf_fifo(uint8_t nbytes)
   g_cntxt.bytes_read += nbytes;
 }
 
+#if GLOSSY_FEC
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * \brief Append the parity to the frame in tx_rx_buffer
+ * \param sec_len Length of the MIC and the nonce following the Glossy packet, zero if plaintext
+ */
+static inline void fec_add_parity(uint8_t sec_len)
+{
+  glossy_fec_encode(&g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET],
+                    IHEADER_LEN + g_cntxt.g_pkt_len + sec_len,
+                    &g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET + g_cntxt.g_pkt_len + sec_len]);
+}
+#endif /* GLOSSY_FEC */
+
+#if GLOSSY_ENC_RELAY_CIPHER || GLOSSY_FEC
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * \brief Decrypt data in place and check its MIC, polling the cryptoprocessor
+ * \param adata     Authenticated data, NULL if there is none
+ * \param adata_len Length of adata
+ * \param data      Ciphertext followed by the MIC and the nonce
+ * \param len       Length of the ciphertext
+ * \return Non-zero if the MIC is valid
+ *
+ *        It runs at most once per flood from glossy_stop().
+ */
+static uint8_t auth_decrypt_poll(uint8_t* adata, uint8_t adata_len, uint8_t* data, uint8_t len)
+{
+  uint8_t ret;
+
+  g_cntxt.aes_used = 1;
+  crypto_set_isr_callback(NULL);
+  ret = ccm_auth_decrypt_start(GLOSSY_SEC_AES_LEN_LEN,
+                               GLOSSY_SEC_KEY_AREA,
+                               &data[len + GLOSSY_SEC_MAC_LEN],
+                               adata,
+                               adata_len,
+                               data,
+                               len + GLOSSY_SEC_MAC_LEN,
+                               data,
+                               GLOSSY_SEC_MAC_LEN,
+                               NULL);
+  if (ret != CRYPTO_SUCCESS) {
+    g_cntxt.stats.enc_dec_errs++;
+    return 0;
+  }
+  while (!ccm_auth_decrypt_check_status());
+  ret = ccm_auth_decrypt_get_result(data, len + GLOSSY_SEC_MAC_LEN, g_cntxt.mac, GLOSSY_SEC_MAC_LEN);
+  if (ret != CRYPTO_SUCCESS) {
+    g_cntxt.stats.enc_dec_errs++;
+    return 0;
+  }
+  if (memcmp(&data[len], g_cntxt.mac, GLOSSY_SEC_MAC_LEN)) {
+    g_cntxt.stats.bad_mac++;
+    return 0;
+  }
+
+  return 1;
+}
+#endif /* GLOSSY_ENC_RELAY_CIPHER || GLOSSY_FEC */
+
+#if GLOSSY_ENC_RELAY_CIPHER
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * \brief Verify and decrypt a frame whose payload is encrypted and whose header is in the clear
+ * \param frame     Frame, starting with the MAC header
+ * \param g_pkt_len Length of the Glossy packet without the MIC and the nonce
+ * \return Non-zero if its MIC is valid. The payload is then copied to the payload buffer
+ *
+ *        Relays do not check the frames they forward, only the payload handed to the application.
+ */
+static uint8_t cipher_verify(uint8_t* frame, uint8_t g_pkt_len)
+{
+  uint8_t header_len = GET_GLOSSY_HEADER_LEN(
+      ((glossy_header_t*)&frame[BUF_TXRX_G_PKT_OFFSET])->config);
+  uint8_t* data = &frame[BUF_TXRX_G_PKT_OFFSET + header_len];
+  uint8_t len = g_pkt_len - header_len;
+
+  if (!auth_decrypt_poll(&frame[BUF_TXRX_IHEADER_OFFSET], CIPHER_ADATA_LEN, data, len)) {
+    return 0;
+  }
+
+  memcpy(g_cntxt.payload, data, len);
+  g_cntxt.payload_len = len;
+
+  return 1;
+}
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
+
 /* ---------------------------------------------------------------------------------------------- */
 static void encryption_done(void)
 {
@@ -403,27 +848,66 @@ static void encryption_done(void)
     g_cntxt.stats.enc_dec_errs++;
     return;
   }
+#if GLOSSY_FEC
+  if (GET_IHEADER_FEC_FLAG(g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET])) {
+    /* The parity protects the frame as sent. Without GLOSSY_ENC_RELAY_CIPHER, every relay step has
+     * its own nonce and ciphertext, so every transmitter computes it again. With it, only the
+     * initiator does, with a zero relay counter in the clear
+     */
+    fec_add_parity(GLOSSY_SEC_MAC_LEN + GLOSSY_SEC_NONCE_LEN);
+  }
+#endif /* GLOSSY_FEC */
+#if GLOSSY_ENC_RELAY_CIPHER
+  /* Only the initiator encrypts. Its retransmissions reuse the ciphertext */
+  memcpy(g_cntxt.saved_buffer, g_cntxt.tx_rx_buffer, g_cntxt.tx_rx_len);
+#elif GLOSSY_FORGE_NODE
+  if (node_id == GLOSSY_FORGE_NODE && !IS_INITIATOR()) {
+    g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET + g_cntxt.g_pkt_len - 1] ^= 0x01;
+  }
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
   /* Copy the encrypted data to the RF FIFO */
   copy_to_rf_fifo();
-
 }
 
 /* ---------------------------------------------------------------------------------------------- */
 static glossy_status_t encryption_start(void)
 {
   uint8_t ret;
+#if GLOSSY_ENC_RELAY_CIPHER
+  uint8_t header_len;
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
+
+  GLOSSY_ISR_PROFILE_STACK();
 
   /* Increment NONCE by one to prevent collision attacks */
   add_to_nonce(&g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET +
                                      g_cntxt.g_pkt_len + GLOSSY_SEC_MAC_LEN],
                1);
 
+#if GLOSSY_ENC_RELAY_CIPHER
+  g_cntxt.aes_used = 1;
+  crypto_set_isr_callback(encryption_done);
+  /* Encrypt the payload only, the relay counter in front of it stays in the clear */
+  header_len = GET_GLOSSY_HEADER_LEN(g_cntxt.crr_header.config);
+  ret = ccm_auth_encrypt_start(GLOSSY_SEC_AES_LEN_LEN,
+                               GLOSSY_SEC_KEY_AREA,
+                               &g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET +
+                                                     g_cntxt.g_pkt_len + GLOSSY_SEC_MAC_LEN],
+                               &g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET],
+                               CIPHER_ADATA_LEN,
+                               &g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET + header_len],
+                               g_cntxt.g_pkt_len - header_len,
+                               &g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET + header_len],
+                               GLOSSY_SEC_MAC_LEN,
+                               NULL);
+#else
   if(IS_INITIATOR()) {
     /* We are the initiator and we save the current tx_rx buffer before the encryption since
      * we may need to retransmit if we will not receive a packet in the next slot.
      */
     memcpy(g_cntxt.saved_buffer, g_cntxt.tx_rx_buffer, g_cntxt.tx_rx_len);
   }
+  g_cntxt.aes_used = 1;
   /* Set the callback to be called on AES interrupt */
   crypto_set_isr_callback(encryption_done);
   /* Start encryption */
@@ -438,6 +922,7 @@ static glossy_status_t encryption_start(void)
                                &g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET],
                                GLOSSY_SEC_MAC_LEN,
                                NULL);
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
   if(ret != CRYPTO_SUCCESS) {
     /* Starting encryption failed */
     PRINTF("encryption_start() ccm_auth_encrypt_start(): error %u\n", ret);
@@ -450,6 +935,7 @@ static glossy_status_t encryption_start(void)
   return GLOSSY_STATUS_SUCCESS;
 }
 
+#if !GLOSSY_ENC_RELAY_CIPHER
 /* ---------------------------------------------------------------------------------------------- */
 static void decryption_done(void)
 {
@@ -478,7 +964,7 @@ static void decryption_done(void)
     return;
   }
   /* We are good to go. */
-  process_received_data();
+  GLOSSY_ISR_CALL(process_received_data);
 }
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -492,6 +978,7 @@ static glossy_status_t decryption_start(void)
   }
   /* Calculate the real glossy packet length */
   g_cntxt.g_pkt_len -= (GLOSSY_SEC_MAC_LEN + GLOSSY_SEC_NONCE_LEN);
+  g_cntxt.aes_used = 1;
   /* Set the callback to be called on AES interrupt */
   crypto_set_isr_callback(decryption_done);
   /* We use the same buffer to store decrypted data */
@@ -518,6 +1005,7 @@ static glossy_status_t decryption_start(void)
 
   return GLOSSY_STATUS_SUCCESS;
 }
+#endif /* !GLOSSY_ENC_RELAY_CIPHER */
 
 /* ---------------------------------------------------------------------------------------------- */
 glossy_status_t glossy_set_enc_key(uint8_t* key, glossy_aes_key_size_t key_size)
@@ -577,6 +1065,12 @@ static inline void radio_abort_tx(void)
   CC2538_RF_CSP_ISFLUSHTX();
   /* Aborts ongoing transmission and forces an RX calibration. */
   CC2538_RF_CSP_ISRXON();
+#if GLOSSY_CHANNEL_HOPPING
+  if (g_cntxt.hop_lock) {
+    /* Nothing valid received, keep following the relay steps */
+    hop_lock_schedule();
+  }
+#endif /* GLOSSY_CHANNEL_HOPPING */
 }
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -594,6 +1088,58 @@ static inline void radio_start_tx(void)
   ENERGEST_ON(ENERGEST_TYPE_LISTEN);
 }
 
+#if GLOSSY_CHANNEL_HOPPING
+/* ---------------------------------------------------------------------------------------------- */
+static inline uint32_t channel_to_freqctrl(uint8_t channel)
+{
+  return CC2538_RF_CHANNEL_MIN + (channel - CC2538_RF_CHANNEL_MIN) * CC2538_RF_CHANNEL_SPACING;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * @brief Precompute the FREQCTRL values of the relay steps for a base channel
+ */
+static void hop_set_base_channel(uint8_t channel)
+{
+  uint8_t r, k;
+  uint8_t valid = 1;
+
+  /* A node whose first transmission has relay counter r continues with r + 2, r + 4, ... It has to
+   * reach the base channel eventually for nodes that do not follow the relay steps.
+   */
+  for (r = 0; r < N_HOP_STEPS; r++) {
+    for (k = 0; k < N_HOP_STEPS && hop_offsets[(r + 2 * k) % N_HOP_STEPS] != 0; k++);
+    if (k == N_HOP_STEPS) {
+      valid = 0;
+    }
+  }
+  if (!valid) {
+    /* Floods would not reach nodes beyond the first hop. Stay on the base channel */
+    PRINTF("hop_set_base_channel(): invalid offsets\n");
+  }
+
+  g_cntxt.base_freqctrl = channel_to_freqctrl(channel);
+  for (r = 0; r < N_HOP_STEPS; r++) {
+    g_cntxt.hop_freqctrl[r] = valid ? channel_to_freqctrl(CC2538_RF_CHANNEL_MIN
+                                                          + (channel - CC2538_RF_CHANNEL_MIN
+                                                             + hop_offsets[r]) % N_RF_CHANNELS)
+                                    : g_cntxt.base_freqctrl;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * @brief Tune to the channel of a relay step
+ *
+ *        Only FREQCTRL is written. The synthesizer picks it up with the calibration that is done at
+ *        every RX/TX turnaround anyway, so retuning does not add to RF_TRUNAROUND_TIME.
+ */
+static inline void hop_retune(uint8_t relay_cnt)
+{
+  REG(RFCORE_XREG_FREQCTRL) = g_cntxt.hop_freqctrl[relay_cnt % N_HOP_STEPS];
+}
+#endif /* GLOSSY_CHANNEL_HOPPING */
+
 /* ---------------------------------------------------------------------------------------------- */
 /***
  * @brief Disable MAC timer and its events
@@ -724,7 +1270,7 @@ static inline void mt_schedule_tx_csp(uint64_t t_start)
  *        reception start and transmission start
  * @return
  */
-static inline void update_T_slot(uint64_t slot_time)
+static inline void update_T_slot(uint32_t slot_time)
 {
   g_cntxt.T_slot_sum += slot_time;
   g_cntxt.n_T_slots++;
@@ -737,7 +1283,191 @@ static inline void update_t_ref(uint64_t t_ref, uint8_t relay_cnt)
   g_cntxt.t_ref_mtt = t_ref;
   g_cntxt.t_ref_updated = 1;
   g_cntxt.relay_cnt_t_ref = relay_cnt;
+#if GLOSSY_SLOT_ESTIMATOR
+  g_cntxt.t_ref_len = g_cntxt.tx_rx_len;
+  g_cntxt.t_ref_enc = GET_IHEADER_ENC_FLAG(g_cntxt.id_header);
+#endif /* GLOSSY_SLOT_ESTIMATOR */
+}
+
+#if GLOSSY_T_REF_MULTI
+/* ---------------------------------------------------------------------------------------------- */
+static inline void add_t_ref_sample(uint64_t t, uint8_t relay_cnt)
+{
+  if (g_cntxt.n_t_ref_samples < 2 * GLOSSY_N_TX_MAX_GLOBAL) {
+    g_cntxt.t_ref_offset[g_cntxt.n_t_ref_samples] = (uint32_t)(t - g_cntxt.t_ref_mtt);
+    g_cntxt.t_ref_relay_cnt[g_cntxt.n_t_ref_samples] = relay_cnt;
+    g_cntxt.n_t_ref_samples++;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * @brief  Back-date all timestamps of the flood and average them
+ * @return Offset of the combined reference time from t_ref_mtt in MAC timer ticks
+ */
+static int32_t combine_t_ref_samples(uint32_t T_slot)
+{
+  int32_t sum = 0;
+  int32_t min = INT32_MAX;
+  int32_t max = INT32_MIN;
+  uint8_t i;
+
+  for (i = 0; i < g_cntxt.n_t_ref_samples; i++) {
+    int32_t t = (int32_t)g_cntxt.t_ref_offset[i] - (int32_t)(g_cntxt.t_ref_relay_cnt[i] * T_slot);
+    sum += t;
+    if (t < min) {
+      min = t;
+    }
+    if (t > max) {
+      max = t;
+    }
+  }
+  g_cntxt.t_ref_spread = (uint32_t)(max - min);
+
+  return sum / g_cntxt.n_t_ref_samples;
+}
+#endif /* GLOSSY_T_REF_MULTI */
+
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * @brief Estimate the slot length from the frame length
+ *        Note that FCS length is also included in tx_rx_len
+ */
+static inline uint32_t get_T_slot_formula(uint8_t tx_rx_len)
+{
+  return BYTES_TIME_TO_MT_TICKS(RF_DATA_LEN_FIELD_LEN + tx_rx_len)
+         + USECONDS_TO_MT_TICKS(GLOSSY_PROCESSING_TIME)
+         + USECONDS_TO_MT_TICKS(RF_TRUNAROUND_TIME) /* RF turn around time */
+         + USECONDS_TO_MT_TICKS(T_HOP_RETUNE_US)
+         + BYTES_TIME_TO_MT_TICKS(5); /* Time for preamble and SFD */
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * @brief Length of a frame with a relay counter (length field value, FCS included)
+ */
+static inline uint32_t get_frame_len(uint8_t payload_len, uint8_t enc)
+{
+  return FRAME_HEADER_LEN + sizeof(glossy_header_t) + payload_len + FOOTER_LEN
+         + (enc ? GLOSSY_SEC_MAC_LEN + GLOSSY_SEC_NONCE_LEN : 0) + FEC_PARITY_LEN;
+}
+
+/* Time from the start of a transmission to its SFD */
+#define T_TX_TO_SFD         (USECONDS_TO_MT_TICKS(RF_TRUNAROUND_TIME) + BYTES_TIME_TO_MT_TICKS(5))
+
+#if GLOSSY_CHANNEL_HOPPING
+/* ---------------------------------------------------------------------------------------------- */
+/* Receivers following the relay steps tune to a step this long before its SFD is expected */
+#define T_HOP_LEAD          (T_TX_TO_SFD + USECONDS_TO_MT_TICKS(GLOSSY_CHANNEL_HOPPING_GUARD))
+
+/**
+ * @brief Schedule the next retune of a receiver that follows the relay steps
+ *
+ *        The frame of relay step c is expected c slots after the reference time. Retuning restarts
+ *        RX with a calibration, so the radio has to be on the new channel RF_TRUNAROUND_TIME before
+ *        the preamble.
+ */
+static void hop_lock_schedule(void)
+{
+  uint32_t T_step = g_cntxt.hop_T_step;
+  uint64_t t_retune_0 = g_cntxt.hop_t_ref - T_HOP_LEAD;
+  /* Leave some time to program the MAC timer */
+  uint64_t t_now = cc2538_rf_get_mac_time_now() + USECONDS_TO_MT_TICKS(10);
+
+  if ((int64_t)(t_now - t_retune_0) < 0) {
+    g_cntxt.hop_step = 0;
+  } else {
+    /* A flood is much shorter than 2^32 MAC timer ticks */
+    g_cntxt.hop_step = (uint32_t)(t_now - t_retune_0) / T_step + 1;
+  }
+  mt_schedule(t_retune_0 + (uint64_t)g_cntxt.hop_step * T_step);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * @brief Tune to the channel of the next relay step, called from the MAC timer ISR
+ */
+static void hop_lock_step(void)
+{
+  uint32_t freqctrl = g_cntxt.hop_freqctrl[g_cntxt.hop_step % N_HOP_STEPS];
+
+  /* A frame being received is either valid or followed by radio_abort_tx() */
+  if (!(REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_SFD)
+      && REG(RFCORE_XREG_FREQCTRL) != freqctrl) {
+    REG(RFCORE_XREG_FREQCTRL) = freqctrl;
+    /* Only a calibration applies the new frequency in RX */
+    CC2538_RF_CSP_ISRXON();
+    g_cntxt.stats.hop_retunes++;
+  }
+  hop_lock_schedule();
+}
+#endif /* GLOSSY_CHANNEL_HOPPING */
+
+#if GLOSSY_SLOT_ESTIMATOR
+/* ---------------------------------------------------------------------------------------------- */
+static slot_estimate_t* slot_est_find(uint8_t len, uint8_t enc)
+{
+  uint8_t i;
+  for (i = 0; i < GLOSSY_SLOT_EST_N_ENTRIES; i++) {
+    if (slot_est[i].T_slot && slot_est[i].len == len && slot_est[i].enc == enc) {
+      return &slot_est[i];
+    }
+  }
+  return NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * @brief Add the mean slot length measured in a flood to the persistent estimate
+ */
+static void slot_est_update(uint8_t len, uint8_t enc, uint32_t T_slot)
+{
+  slot_estimate_t* est = slot_est_find(len, enc);
+  uint32_t T_slot_formula = get_T_slot_formula(len);
+  uint8_t i;
+
+  /* Measurements far away from the formula are not slot lengths, e.g. a missed relay step */
+  if (T_slot > T_slot_formula + (T_slot_formula >> 2) || T_slot < T_slot_formula - (T_slot_formula >> 2)) {
+    return;
+  }
+
+  for (i = 0; i < GLOSSY_SLOT_EST_N_ENTRIES; i++) {
+    if (slot_est[i].age < 0xff) {
+      slot_est[i].age++;
+    }
+  }
+
+  if (est == NULL) {
+    /* Replace the least recently updated entry */
+    est = &slot_est[0];
+    for (i = 1; i < GLOSSY_SLOT_EST_N_ENTRIES; i++) {
+      if (slot_est[i].age > est->age) {
+        est = &slot_est[i];
+      }
+    }
+    est->len = len;
+    est->enc = enc;
+    est->T_slot = T_slot;
+    est->n_outliers = 0;
+    est->age = 0;
+    return;
+  }
+
+  est->age = 0;
+  if ((T_slot > est->T_slot ? T_slot - est->T_slot : est->T_slot - T_slot)
+      > USECONDS_TO_MT_TICKS(GLOSSY_SLOT_EST_MAX_DEV)) {
+    if (++est->n_outliers < GLOSSY_SLOT_EST_N_OUTLIERS) {
+      return;
+    }
+    /* The slot length has changed, start over */
+    est->T_slot = T_slot;
+  } else {
+    est->T_slot = (uint32_t)((int32_t)est->T_slot
+                             + (((int32_t)T_slot - (int32_t)est->T_slot) >> GLOSSY_SLOT_EST_SHIFT));
+  }
+  est->n_outliers = 0;
 }
+#endif /* GLOSSY_SLOT_ESTIMATOR */
 
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -791,11 +1521,13 @@ static glossy_status_t validate_glossy_header(glossy_header_t* rcvd_hdr)
 }
 
 /* ---------------------------------------------------------------------------------------------- */
-static void process_received_data()
+ISR_TEMPLATE void process_received_data_tmpl(uint8_t enc, uint8_t init, uint8_t sync)
 {
   /* Glossy header is at the beginning of decrypted data */
   glossy_header_t * rcvd_header = (glossy_header_t*)(&g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET]);
 
+  GLOSSY_ISR_PROFILE_STACK();
+
   if (validate_glossy_header(rcvd_header) != GLOSSY_STATUS_SUCCESS) {
     /* Glossy header validation failed */
     radio_abort_tx();
@@ -808,34 +1540,59 @@ static void process_received_data()
     g_cntxt.t_first_rx = g_cntxt.t_rx_start;
     /* Copy the received header to current header */
     memcpy(&g_cntxt.crr_header, rcvd_header, GET_GLOSSY_HEADER_LEN(rcvd_header->config));
+    if (ISR_WITH_RELAY_CNT(sync)) {
+      g_cntxt.relay_cnt_first_rx = rcvd_header->relay_cnt;
+    }
+#if GLOSSY_CHANNEL_HOPPING
+    if (g_cntxt.hop_lock) {
+      /* The relay of this frame is scheduled from its own SFD */
+      g_cntxt.hop_lock = 0;
+      if (REG(RFCORE_XREG_FREQCTRL) != g_cntxt.base_freqctrl) {
+        g_cntxt.stats.hop_rx_off_base++;
+      }
+    }
+#endif /* GLOSSY_CHANNEL_HOPPING */
+#if GLOSSY_ISR_SPECIALIZE
+    if (sync == ISR_ANY) {
+      /* The mode of the flood is known now. Use the specialized handlers for the next packets */
+      select_isr();
+    }
+#endif /* GLOSSY_ISR_SPECIALIZE */
   }
 
   /* Save the current received relay counter value */
-  if (WITH_RELAY_CNT(g_cntxt.crr_header.config)) {
+  if (ISR_WITH_RELAY_CNT(sync)) {
     g_cntxt.relay_cnt_last_rx = rcvd_header->relay_cnt;
   }
 
-  if (WITH_SYNC(g_cntxt.crr_header.config)) {
+  /* Any flood with a relay counter gives a reference, the slot length is only measured in sync
+   * floods
+   */
+  if (ISR_WITH_RELAY_CNT(sync) && !g_cntxt.t_ref_updated) {
+    /* reference time has not been updated yet. So update it */
+    update_t_ref(g_cntxt.t_rx_start, g_cntxt.relay_cnt_last_rx);
+  }
+
+  if (ISR_WITH_SYNC(sync)) {
     /* Glossy time synchronization enabled */
-    if (!g_cntxt.t_ref_updated) {
-      /* reference time has not been updated yet. So update it */
-      update_t_ref(g_cntxt.t_rx_start, g_cntxt.relay_cnt_last_rx);
-    }
+#if GLOSSY_T_REF_MULTI
+    add_t_ref_sample(g_cntxt.t_rx_start, g_cntxt.relay_cnt_last_rx);
+#endif /* GLOSSY_T_REF_MULTI */
 
     if ((g_cntxt.relay_cnt_last_rx == g_cntxt.relay_cnt_last_tx + 1) && g_cntxt.tx_cnt > 0) {
       /* This reception is just after a transmission. So we update the slot time */
-      update_T_slot(g_cntxt.t_rx_start - g_cntxt.t_tx_start);
+      update_T_slot((uint32_t)(g_cntxt.t_rx_start - g_cntxt.t_tx_start));
     }
   }
 
   g_cntxt.rx_cnt++;
 
 #if GLOSSY_RX_MAJORITY_VOTE
-  if(!IS_INITIATOR() && g_cntxt.rx_cnt < GLOSSY_N_TX_MAX_GLOBAL) {
+  if(!ISR_INITIATOR(init) && g_cntxt.rx_cnt < GLOSSY_N_TX_MAX_GLOBAL) {
     /* Glossy payload is just after the Glossy header */
-    uint8_t app_data_len = g_cntxt.g_pkt_len - GET_GLOSSY_HEADER_LEN(g_cntxt.crr_header.config);
+    uint8_t app_data_len = g_cntxt.g_pkt_len - ISR_HEADER_LEN(sync);
     uint8_t* rx_app_data = &g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET +
-                                                 GET_GLOSSY_HEADER_LEN(g_cntxt.crr_header.config)];
+                                                 ISR_HEADER_LEN(sync)];
     uint8_t i;
     uint8_t found = 0;
     for (i = 0; i < g_cntxt.rx_payload_cnt; i++) {
@@ -857,12 +1614,19 @@ static void process_received_data()
     }
   }
 #else
-  if((!IS_INITIATOR()) && (g_cntxt.rx_cnt == 1)) {
-    uint8_t app_data_len = g_cntxt.g_pkt_len - GET_GLOSSY_HEADER_LEN(g_cntxt.crr_header.config);
+  if((!ISR_INITIATOR(init)) && (g_cntxt.rx_cnt == 1)) {
+    uint8_t app_data_len = g_cntxt.g_pkt_len - ISR_HEADER_LEN(sync);
     uint8_t* rx_app_data = &g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET +
-                                                 GET_GLOSSY_HEADER_LEN(g_cntxt.crr_header.config)];
+                                                 ISR_HEADER_LEN(sync)];
     memcpy(g_cntxt.payload, rx_app_data, app_data_len);
     g_cntxt.payload_len = app_data_len;
+#if GLOSSY_ENC_RELAY_CIPHER
+    if (ISR_ENC(enc)) {
+      /* The payload is still encrypted. Keep the frame to verify it in glossy_stop() */
+      memcpy(g_cntxt.verify_buffer, g_cntxt.tx_rx_buffer, g_cntxt.tx_rx_len);
+      g_cntxt.verify_len = g_cntxt.g_pkt_len;
+    }
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
   }
 #endif /* GLOSSY_RX_MAJORITY_VOTE */
 
@@ -875,28 +1639,71 @@ static void process_received_data()
     return;
   }
 
-  if (WITH_RELAY_CNT(g_cntxt.crr_header.config)) {
+  if (ISR_WITH_RELAY_CNT(sync)) {
     /* we need to increase the relay counter by one */
     rcvd_header->relay_cnt++;
     g_cntxt.relay_cnt_last_tx = rcvd_header->relay_cnt;
+#if GLOSSY_CHANNEL_HOPPING
+    /* Takes effect when the scheduled transmission starts */
+    hop_retune(g_cntxt.relay_cnt_last_tx);
+#endif /* GLOSSY_CHANNEL_HOPPING */
   }
 
-  if (GET_IHEADER_ENC_FLAG(g_cntxt.id_header) == IHEADER_ENC_FLAG) {
+  if (ISR_ENC(enc)) {
+#if GLOSSY_ENC_RELAY_CIPHER
+#if GLOSSY_FORGE_NODE
+    if (node_id == GLOSSY_FORGE_NODE && !ISR_INITIATOR(init)) {
+      g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET + g_cntxt.g_pkt_len - 1] ^= 0x01;
+    }
+#endif /* GLOSSY_FORGE_NODE */
+    /* Relay the ciphertext unchanged */
+    copy_to_rf_fifo();
+    g_cntxt.stats.cipher_relayed++;
+#else
     /* Need to encrypt the payload */
     if (encryption_start() != GLOSSY_STATUS_SUCCESS) {
       /* Starting encryption failed */
       radio_abort_tx();
       g_cntxt.stats.enc_dec_errs++;
     }
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
   } else {
     /* Just copy the data to the RF FIFO */
     copy_to_rf_fifo();
   }
 }
 
+#if GLOSSY_HW_FRAME_FILTER
+/* ---------------------------------------------------------------------------------------------- */
+/* The radio accepts or drops a frame once it has received the length byte and the MAC header */
+#define T_FRAME_FILTER      (BYTES_TIME_TO_MT_TICKS(RF_DATA_LEN_FIELD_LEN + MHR_LEN) \
+                             + USECONDS_TO_MT_TICKS(32))
+
+/**
+ * \brief Account for the pending frame once the radio has moved on without RXPKTDONE
+ * \param t_now MAC timer time of the event that ends the reception
+ *
+ * The radio does not signal the frames it drops. The frame was dropped if it was not accepted
+ * although the filter must have decided on it by then. Receptions cut short before, by an own
+ * transmission or the end of the flood, and receptions ended by an RF error are not counted.
+ */
+static inline void hw_filter_account(uint64_t t_now)
+{
+  if (g_cntxt.rx_pending && !g_cntxt.rx_accepted
+      && t_now - g_cntxt.t_rx_start >= T_FRAME_FILTER) {
+    g_cntxt.stats.hw_filtered++;
+  }
+  g_cntxt.rx_pending = 0;
+  g_cntxt.rx_accepted = 0;
+}
+#endif /* GLOSSY_HW_FRAME_FILTER */
+
 /* ---------------------------------------------------------------------------------------------- */
 static inline void glossy_tx_started(void)
 {
+#if GLOSSY_HW_FRAME_FILTER
+  hw_filter_account(g_cntxt.sfd_time);
+#endif /* GLOSSY_HW_FRAME_FILTER */
   g_cntxt.t_tx_start = g_cntxt.sfd_time;
 
   if (g_cntxt.tx_cnt == 0) {
@@ -904,29 +1711,39 @@ static inline void glossy_tx_started(void)
      * We estimate slot length based on the packet length
      * Note that FCS length is also included in tx_rx_len
      */
-    g_cntxt.T_slot_estimated = BYTES_TIME_TO_MT_TICKS(RF_DATA_LEN_FIELD_LEN + g_cntxt.tx_rx_len)
-                               + USECONDS_TO_MT_TICKS(GLOSSY_PROCESSING_TIME)
-                               + USECONDS_TO_MT_TICKS(RF_TRUNAROUND_TIME) /* RF turn around time */
-                               + BYTES_TIME_TO_MT_TICKS(5); /* Time for preamble and SFD */
+    g_cntxt.T_slot_estimated = get_T_slot_formula(g_cntxt.tx_rx_len);
 
   }
 
+#if GLOSSY_CHANNEL_HOPPING
+  if (WITH_RELAY_CNT(g_cntxt.crr_header.config)) {
+    /* Neighbours relay this frame with the next relay counter. Takes effect when the radio returns
+     * to RX after the transmission.
+     */
+    hop_retune(g_cntxt.relay_cnt_last_tx + 1);
+  }
+#endif /* GLOSSY_CHANNEL_HOPPING */
+
 }
 
 /* ---------------------------------------------------------------------------------------------- */
-static inline void glossy_tx_ended(void)
+ISR_TEMPLATE void glossy_tx_ended_tmpl(uint8_t init, uint8_t sync)
 {
   g_cntxt.tx_cnt++;
 
-  if (WITH_SYNC(g_cntxt.crr_header.config)) {
+  if (ISR_WITH_RELAY_CNT(sync) && !g_cntxt.t_ref_updated) {
+    update_t_ref(g_cntxt.t_tx_start, g_cntxt.relay_cnt_last_tx);
+  }
 
-    if (!g_cntxt.t_ref_updated) {
-      update_t_ref(g_cntxt.t_tx_start, g_cntxt.relay_cnt_last_tx);
-    }
+  if (ISR_WITH_SYNC(sync)) {
+
+#if GLOSSY_T_REF_MULTI
+    add_t_ref_sample(g_cntxt.t_tx_start, g_cntxt.relay_cnt_last_tx);
+#endif /* GLOSSY_T_REF_MULTI */
 
     if ((g_cntxt.relay_cnt_last_tx == g_cntxt.relay_cnt_last_rx + 1) && g_cntxt.rx_cnt > 0) {
       /* This transmission is just after a reception. So we update the slot time */
-      update_T_slot(g_cntxt.t_tx_start - g_cntxt.t_rx_start);
+      update_T_slot((uint32_t)(g_cntxt.t_tx_start - g_cntxt.t_rx_start));
     }
   }
 
@@ -938,7 +1755,7 @@ static inline void glossy_tx_ended(void)
 
   } else {
     /* We need more transmissions */
-    if (IS_INITIATOR() && g_cntxt.rx_cnt == 0) {
+    if (ISR_INITIATOR(init) && g_cntxt.rx_cnt == 0) {
       /* Initiator hasn't received any packet yet.
        * Therefore, we are going to see if we will receive a packet in the next time slot.
        * We add 10 us to compensate any jitter.
@@ -959,20 +1776,56 @@ static inline void glossy_tx_ended(void)
 }
 
 /* ---------------------------------------------------------------------------------------------- */
-static inline void glossy_rx_ended(void)
+/**
+ * \brief Check the identification header of the frame being received
+ * \return Non-zero if it is a Glossy frame of the current flood
+ */
+static inline uint8_t check_id_header(void)
+{
+  if ((GET_IHEADER_MAGIC(g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET])) != IHEADER_MAGIC) {
+    g_cntxt.stats.bad_i_header++;
+    return 0;
+  }
+
+  /* Check if all packets we receive are with the same ID header */
+  if (g_cntxt.rx_cnt > 0 && g_cntxt.id_header != g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET]) {
+    g_cntxt.stats.bad_i_header++;
+    return 0;
+  }
+
+  g_cntxt.id_header = g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET];
+  return 1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+ISR_TEMPLATE void glossy_rx_ended_tmpl(uint8_t enc, uint8_t init, uint8_t sync)
 {
   uint64_t t_tx_start_new;
 
+#if GLOSSY_HW_FRAME_FILTER
+  g_cntxt.rx_pending = 0;
+  g_cntxt.rx_accepted = 0;
+#endif /* GLOSSY_HW_FRAME_FILTER */
+
   /* Disable MAC timer events as we've received a complete packet */
   //mt_disable_cmp_events();
 
+#if GLOSSY_CHANNEL_HOPPING
+  if (g_cntxt.hop_lock) {
+    /* The MAC timer is needed for the transmission. Resumed by radio_abort_tx() if the frame is
+     * not valid
+     */
+    REG(RFCORE_SFR_MTIRQM) &= ~RFCORE_SFR_MTIRQM_MACTIMER_OVF_COMPARE1M;
+    REG(RFCORE_SFR_MTIRQM) &= ~RFCORE_SFR_MTIRQM_MACTIMER_COMPARE1M;
+  }
+#endif /* GLOSSY_CHANNEL_HOPPING */
+
   /* Schedule the next transmission first.
    * We use the time when SFD received as the reference to schedule the next packet transmission.
    * If we don't need retransmissions further, we have to reset and disable CSP events later
    */
   t_tx_start_new = g_cntxt.t_rx_start;
-  t_tx_start_new += BYTES_TIME_TO_MT_TICKS(RF_DATA_LEN_FIELD_LEN + g_cntxt.tx_rx_len);
-  t_tx_start_new += USECONDS_TO_MT_TICKS(GLOSSY_PROCESSING_TIME);
+  t_tx_start_new += get_T_slot_formula(g_cntxt.tx_rx_len) - T_TX_TO_SFD;
   /* Schedule next transmission using MAC timer events and CSP */
   mt_schedule_tx_csp(t_tx_start_new);
 
@@ -985,13 +1838,42 @@ static inline void glossy_rx_ended(void)
   if (!(FOOTER1_CRC_FIELD & FOOTER1_CRC_OK)) {
     radio_abort_tx();
     g_cntxt.stats.bad_crc++;
+#if GLOSSY_FEC
+    /* Keep it for glossy_stop() in case nothing valid is received in this flood */
+    if (g_cntxt.rx_cnt == 0 && g_cntxt.fec_len == 0
+        && GET_IHEADER_FEC_FLAG(g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET])) {
+      memcpy(g_cntxt.fec_buffer, g_cntxt.tx_rx_buffer, g_cntxt.tx_rx_len);
+      g_cntxt.fec_len = g_cntxt.tx_rx_len;
+    }
+#endif /* GLOSSY_FEC */
     return;
   }
 
-  /* Calculate the new Glossy packet length */
-  g_cntxt.g_pkt_len = g_cntxt.tx_rx_len - IHEADER_LEN - FOOTER_LEN;
+#if GLOSSY_HW_FRAME_FILTER
+  /* The ID header has not been checked in glossy_rx_started() */
+  if (!check_id_header()) {
+    radio_abort_tx();
+    return;
+  }
+#endif /* GLOSSY_HW_FRAME_FILTER */
 
-  if (GET_IHEADER_ENC_FLAG(g_cntxt.id_header) == IHEADER_ENC_FLAG) {
+  /* Calculate the new Glossy packet length */
+  g_cntxt.g_pkt_len = g_cntxt.tx_rx_len - FRAME_HEADER_LEN - FEC_LEN(g_cntxt.id_header)
+                      - FOOTER_LEN;
+
+  if (ISR_ENC(enc)) {
+#if GLOSSY_ENC_RELAY_CIPHER
+    /* The Glossy header is in the clear, the payload is decrypted in glossy_stop() only */
+    if (g_cntxt.g_pkt_len < GET_GLOSSY_HEADER_LEN(g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET
+                                                     + offsetof(glossy_header_t, config)])
+                            + GLOSSY_SEC_MAC_LEN + GLOSSY_SEC_NONCE_LEN) {
+      radio_abort_tx();
+      g_cntxt.stats.bad_length++;
+      return;
+    }
+    g_cntxt.g_pkt_len -= (GLOSSY_SEC_MAC_LEN + GLOSSY_SEC_NONCE_LEN);
+    process_received_data_tmpl(enc, init, sync);
+#else
     /* We have to decrypt the data */
     if (decryption_start() != GLOSSY_STATUS_SUCCESS) {
       /* Starting decryption failed */
@@ -1000,21 +1882,26 @@ static inline void glossy_rx_ended(void)
       return;
     }
     /* process_received_data() is called in decryption_done() */
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
   } else {
     /* Data is not encrypted */
-    process_received_data();
+    process_received_data_tmpl(enc, init, sync);
   }
 }
 
 /* ---------------------------------------------------------------------------------------------- */
-static inline void glossy_rx_started(void)
+ISR_TEMPLATE void glossy_rx_started_tmpl(uint8_t init)
 {
   uint64_t t_rx_timeout;
   uint8_t tx_rx_len_tmp;
 
+#if GLOSSY_HW_FRAME_FILTER
+  /* The previous frame has ended */
+  hw_filter_account(g_cntxt.sfd_time);
+#endif /* GLOSSY_HW_FRAME_FILTER */
   g_cntxt.t_rx_start = g_cntxt.sfd_time;
 
-  if(IS_INITIATOR()) {
+  if(ISR_INITIATOR(init)) {
     cc2538_rf_csp_reset();
     mt_disable_cmp_events();
   }
@@ -1044,7 +1931,7 @@ static inline void glossy_rx_started(void)
   /* We receive a mismatched payload and take majority vote later when glossy is stopped.
    * Only the initiator expects the correct length all the time.
    */
-  if (IS_INITIATOR() && g_cntxt.tx_rx_len != tx_rx_len_tmp) {
+  if (ISR_INITIATOR(init) && g_cntxt.tx_rx_len != tx_rx_len_tmp) {
     radio_abort_rx();
     g_cntxt.stats.payload_mismatch++;
     return;
@@ -1061,6 +1948,14 @@ static inline void glossy_rx_started(void)
   g_cntxt.tx_rx_len = tx_rx_len_tmp;
 
   g_cntxt.bytes_read = 0;
+
+#if GLOSSY_HW_FRAME_FILTER
+  /* The ID header follows the MAC header, which the radio checks for us. Foreign frames are dropped
+   * before FIFOP is raised, so we neither wait for the ID header here nor copy them. It is checked
+   * in glossy_rx_ended() instead.
+   */
+  g_cntxt.rx_pending = 1;
+#else
   /* Wait until the at least one more byte time in order to proceed */
   while(!CC2538_RF_RXFIFO_HAS_DATA()) {
     if (cc2538_rf_get_mac_time_now() > t_rx_timeout) {
@@ -1076,22 +1971,12 @@ static inline void glossy_rx_started(void)
   g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET] = REG(RFCORE_SFR_RFDATA);
   g_cntxt.bytes_read++;
   /* We keep receiving only if it has the right header */
-  if ((GET_IHEADER_MAGIC(g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET])) != IHEADER_MAGIC) {
-    /* Wrong header: abort packet reception */
-    radio_abort_rx();
-    g_cntxt.stats.bad_i_header++;
-    return;
-  }
-
-  /* Check if all packets we receive are with the same ID header */
-  if (g_cntxt.rx_cnt > 0 && g_cntxt.id_header != g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET]) {
+  if (!check_id_header()) {
     /* Wrong header: abort packet reception */
     radio_abort_rx();
-    g_cntxt.stats.bad_i_header++;
     return;
   }
-
-  g_cntxt.id_header = g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET];
+#endif /* GLOSSY_HW_FRAME_FILTER */
 
   /* We expect rest of the reception will continue without any problem even if we will receive a
    * corrupted packet. Therefore, we don't use any timeout for receiving of rest of the packet.
@@ -1100,6 +1985,77 @@ static inline void glossy_rx_started(void)
    */
 }
 
+/* ---------------------------------------------------------------------------------------------- */
+/*
+ * Handler variants. The generic one checks the mode at runtime and is used while it is not known,
+ * i.e. by receivers without a sync option until the first packet of the flood has been processed.
+ */
+#define GLOSSY_ISR_VARIANT(name, enc, init, sync) \
+  static void glossy_rx_started_##name(void) { glossy_rx_started_tmpl(init); } \
+  static void glossy_rx_ended_##name(void) { glossy_rx_ended_tmpl(enc, init, sync); } \
+  static void glossy_tx_ended_##name(void) { glossy_tx_ended_tmpl(init, sync); } \
+  static void glossy_process_received_data_##name(void) \
+  { \
+    process_received_data_tmpl(enc, init, sync); \
+  } \
+  static const glossy_isr_t glossy_isr_##name __attribute__((unused)) = { \
+    glossy_rx_started_##name, \
+    glossy_rx_ended_##name, \
+    glossy_tx_ended_##name, \
+    glossy_process_received_data_##name \
+  };
+
+GLOSSY_ISR_VARIANT(generic, ISR_ANY, ISR_ANY, ISR_ANY)
+
+#if GLOSSY_ISR_SPECIALIZE
+GLOSSY_ISR_VARIANT(plain_init_sync,        0, 1, GLOSSY_WITH_SYNC)
+GLOSSY_ISR_VARIANT(plain_init_nosync,      0, 1, GLOSSY_WITHOUT_SYNC)
+GLOSSY_ISR_VARIANT(plain_init_relay_cnt,   0, 1, GLOSSY_ONLY_RELAY_CNT)
+GLOSSY_ISR_VARIANT(plain_relay_sync,       0, 0, GLOSSY_WITH_SYNC)
+GLOSSY_ISR_VARIANT(plain_relay_nosync,     0, 0, GLOSSY_WITHOUT_SYNC)
+GLOSSY_ISR_VARIANT(plain_relay_relay_cnt,  0, 0, GLOSSY_ONLY_RELAY_CNT)
+GLOSSY_ISR_VARIANT(enc_init_sync,          1, 1, GLOSSY_WITH_SYNC)
+GLOSSY_ISR_VARIANT(enc_init_nosync,        1, 1, GLOSSY_WITHOUT_SYNC)
+GLOSSY_ISR_VARIANT(enc_init_relay_cnt,     1, 1, GLOSSY_ONLY_RELAY_CNT)
+GLOSSY_ISR_VARIANT(enc_relay_sync,         1, 0, GLOSSY_WITH_SYNC)
+GLOSSY_ISR_VARIANT(enc_relay_nosync,       1, 0, GLOSSY_WITHOUT_SYNC)
+GLOSSY_ISR_VARIANT(enc_relay_relay_cnt,    1, 0, GLOSSY_ONLY_RELAY_CNT)
+
+/* Indexed by encryption, initiator and (sync option >> 4) - 1 */
+static const glossy_isr_t* const isr_table[2][2][3] = {
+  {
+    { &glossy_isr_plain_relay_sync,
+      &glossy_isr_plain_relay_nosync,
+      &glossy_isr_plain_relay_relay_cnt },
+    { &glossy_isr_plain_init_sync,
+      &glossy_isr_plain_init_nosync,
+      &glossy_isr_plain_init_relay_cnt }
+  },
+  {
+    { &glossy_isr_enc_relay_sync,
+      &glossy_isr_enc_relay_nosync,
+      &glossy_isr_enc_relay_relay_cnt },
+    { &glossy_isr_enc_init_sync,
+      &glossy_isr_enc_init_nosync,
+      &glossy_isr_enc_init_relay_cnt }
+  }
+};
+
+/* ---------------------------------------------------------------------------------------------- */
+static void select_isr(void)
+{
+  uint8_t sync = GET_GLOSSY_HEADER_SYNC_OPT(g_cntxt.crr_header.config);
+
+  if (sync == GLOSSY_UNKNOWN_SYNC) {
+    g_cntxt.isr = &glossy_isr_generic;
+    return;
+  }
+  g_cntxt.isr = isr_table[GET_IHEADER_ENC_FLAG(g_cntxt.id_header) == IHEADER_ENC_FLAG]
+                         [IS_INITIATOR()]
+                         [(sync >> 4) - 1];
+}
+#endif /* GLOSSY_ISR_SPECIALIZE */
+
 /* ---------------------------------------------------------------------------------------------- */
 /**
  * @brief The MAC Timer ISR
@@ -1121,6 +2077,15 @@ void cc2538_rf_mt_isr(void)
   } else if((REG(RFCORE_SFR_MTIRQF) & RFCORE_SFR_MTIRQF_MACTIMER_COMPARE1F)) {
     REG(RFCORE_SFR_MTIRQM) &= ~RFCORE_SFR_MTIRQM_MACTIMER_COMPARE1M;
     /* This is where we should add what to do when the time elapsed */
+#if GLOSSY_CHANNEL_HOPPING
+    if (g_cntxt.hop_lock) {
+      /* A receiver following the relay steps, not the initiator */
+      hop_lock_step();
+      REG(RFCORE_SFR_MTIRQF) = 0;
+      ENERGEST_OFF(ENERGEST_TYPE_IRQ);
+      return;
+    }
+#endif /* GLOSSY_CHANNEL_HOPPING */
 
     if (REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_SFD) {
      /* We are receiving something. So we avoid scheduling initiator retransmission */
@@ -1144,16 +2109,18 @@ void cc2538_rf_mt_isr(void)
     if (WITH_RELAY_CNT(g_cntxt.crr_header.config)) {
       rcvd_header->relay_cnt += 2;
       g_cntxt.relay_cnt_last_tx = rcvd_header->relay_cnt;
+#if GLOSSY_CHANNEL_HOPPING
+      hop_retune(g_cntxt.relay_cnt_last_tx);
+#endif /* GLOSSY_CHANNEL_HOPPING */
     }
 
     uint64_t t_tx_start_new = g_cntxt.t_tx_start;
     t_tx_start_new += g_cntxt.T_slot_estimated;
-    t_tx_start_new += BYTES_TIME_TO_MT_TICKS(RF_DATA_LEN_FIELD_LEN + g_cntxt.tx_rx_len);
-    t_tx_start_new += USECONDS_TO_MT_TICKS(GLOSSY_PROCESSING_TIME);
+    t_tx_start_new += get_T_slot_formula(g_cntxt.tx_rx_len) - T_TX_TO_SFD;
 
     mt_schedule_tx_csp(t_tx_start_new);
 
-    if (GET_IHEADER_ENC_FLAG(g_cntxt.id_header) == IHEADER_ENC_FLAG) {
+    if (GET_IHEADER_ENC_FLAG(g_cntxt.id_header) == IHEADER_ENC_FLAG && !GLOSSY_ENC_RELAY_CIPHER) {
       /* Need to encrypt the payload */
       if (encryption_start() != GLOSSY_STATUS_SUCCESS) {
         /* Starting encryption failed */
@@ -1161,7 +2128,7 @@ void cc2538_rf_mt_isr(void)
         g_cntxt.stats.enc_dec_errs++;
       }
     } else {
-      /* Just copy to the RF FIFO */
+      /* Just copy to the RF FIFO. With GLOSSY_ENC_RELAY_CIPHER, the saved frame is encrypted */
       copy_to_rf_fifo();
     }
 
@@ -1182,8 +2149,21 @@ void cc2538_rf_mt_isr(void)
 
 void cc2538_rf_rx_tx_isr(void)
 {
+#if GLOSSY_ISR_PROFILE
+  uint32_t isr_cycles = REG(DWT_CYCCNT);
+  __asm volatile ("mov %0, sp" : "=r" (g_cntxt.isr_sp_entry));
+  g_cntxt.isr_sp_min = g_cntxt.isr_sp_entry;
+#endif /* GLOSSY_ISR_PROFILE */
+
   ENERGEST_ON(ENERGEST_TYPE_IRQ);
 
+#if GLOSSY_HW_FRAME_FILTER
+  /* The flag is cleared below, remember it for the pending frame */
+  if (REG(RFCORE_SFR_RFIRQF0) & RFCORE_SFR_RFIRQF0_FRAME_ACCEPTED) {
+    g_cntxt.rx_accepted = 1;
+  }
+#endif /* GLOSSY_HW_FRAME_FILTER */
+
   /* Check for SFD to see if SFD is sent or received. Note that this interrupt is not fired
    * when SFD goes low.
    */
@@ -1201,7 +2181,7 @@ void cc2538_rf_rx_tx_isr(void)
     g_cntxt.sfd_time = cc2538_rf_get_sfd_timestamp();
 
     if (REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_RX_ACTIVE) {
-      glossy_rx_started();
+      GLOSSY_ISR_CALL(rx_started);
     } else if (REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_TX_ACTIVE) {
       glossy_tx_started();
     } else {
@@ -1223,7 +2203,7 @@ void cc2538_rf_rx_tx_isr(void)
 
       GLOSSY_DEBUG_GPIO_UNSET_PIN_SFD_RX();
 
-      glossy_rx_ended();
+      GLOSSY_ISR_CALL(rx_ended);
     } else {
       /* ERROR */
     }
@@ -1234,7 +2214,7 @@ void cc2538_rf_rx_tx_isr(void)
 #if GLOSSY_DEBUG_GPIO
       GLOSSY_DEBUG_GPIO_UNSET_PIN_SFD_TX();
 #endif /* GLOSSY_DEBUG_GPIO */
-      glossy_tx_ended();
+      GLOSSY_ISR_CALL(tx_ended);
     } else {
       /* ERROR */
     }
@@ -1245,6 +2225,18 @@ void cc2538_rf_rx_tx_isr(void)
   REG(RFCORE_SFR_RFIRQF1) = 0;
 
   ENERGEST_OFF(ENERGEST_TYPE_IRQ);
+
+#if GLOSSY_ISR_PROFILE
+  isr_cycles = REG(DWT_CYCCNT) - isr_cycles;
+  g_cntxt.isr_profile.n_isr++;
+  g_cntxt.isr_profile.cycles_sum += isr_cycles;
+  if (isr_cycles > g_cntxt.isr_profile.cycles_max) {
+    g_cntxt.isr_profile.cycles_max = isr_cycles;
+  }
+  if (g_cntxt.isr_sp_entry - g_cntxt.isr_sp_min > g_cntxt.isr_profile.stack_max) {
+    g_cntxt.isr_profile.stack_max = g_cntxt.isr_sp_entry - g_cntxt.isr_sp_min;
+  }
+#endif /* GLOSSY_ISR_PROFILE */
 }
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -1263,6 +2255,11 @@ cc2538_rf_err_isr(void)
 
   g_cntxt.stats.rf_errs++;
   g_cntxt.rf_err_reg_last = REG(RFCORE_SFR_RFERRF);
+#if GLOSSY_HW_FRAME_FILTER
+  /* Whatever was being received is lost, but not dropped by the frame filter */
+  g_cntxt.rx_pending = 0;
+  g_cntxt.rx_accepted = 0;
+#endif /* GLOSSY_HW_FRAME_FILTER */
 
   /* Clear pending interrupts */
   REG(RFCORE_SFR_RFERRF) = 0;
@@ -1327,6 +2324,18 @@ static inline void glossy_restore_irq_priorities(void)
   NVIC_SetPriority(UART1_IRQn, g_cntxt.irq_priorities[IRQ_PRIORITY_IDX_UART1_IRQ]);
 }
 
+/* ---------------------------------------------------------------------------------------------- */
+void glossy_hold_irq_priorities(uint8_t hold)
+{
+  if (hold && !g_cntxt.irq_priorities_held) {
+    glossy_set_irq_priorities();
+    g_cntxt.irq_priorities_held = 1;
+  } else if (!hold && g_cntxt.irq_priorities_held) {
+    glossy_restore_irq_priorities();
+    g_cntxt.irq_priorities_held = 0;
+  }
+}
+
 /* ---------------------------------------------------------------------------------------------- */
 glossy_status_t glossy_init(void)
 {
@@ -1334,6 +2343,12 @@ glossy_status_t glossy_init(void)
 
   cc2538_rf_set_tx_power(CC2538_RF_TX_POWER);
   cc2538_rf_set_channel(CC2538_RF_CHANNEL);
+#if GLOSSY_CHANNEL_HOPPING
+  hop_set_base_channel(CC2538_RF_CHANNEL);
+#endif /* GLOSSY_CHANNEL_HOPPING */
+#if GLOSSY_HW_FRAME_FILTER
+  cc2538_rf_set_frame_filter(1, GLOSSY_PAN_ID, node_id);
+#endif /* GLOSSY_HW_FRAME_FILTER */
   /* Initialize id_header */
   g_cntxt.id_header = IHEADER_MAGIC;
   /* Disable encryption by default */
@@ -1344,6 +2359,26 @@ glossy_status_t glossy_init(void)
 
   crypto_init();
 
+#if GLOSSY_FEC
+  glossy_fec_init();
+#endif /* GLOSSY_FEC */
+
+  /* Precompute the conversion from MAC timer ticks to rtimer ticks to avoid a 64-bit division in
+   * every glossy_stop(). CLOCK_PHI is not an integer (976.5625 at 32 MHz).
+   */
+  g_cntxt.mtt_to_rt = (uint32_t)(((uint64_t)RTIMER_SECOND << 32) / sys_ctrl_get_sys_clock());
+#if GLOSSY_CHANNEL_HOPPING
+  /* And the other way round for glossy_set_next_t_ref(), exact at 16 and 32 MHz */
+  g_cntxt.rt_to_mtt = (uint32_t)(((uint64_t)sys_ctrl_get_sys_clock() << 16) / RTIMER_SECOND);
+#endif /* GLOSSY_CHANNEL_HOPPING */
+  g_cntxt.irq_priorities_held = 0;
+
+#if GLOSSY_ISR_PROFILE
+  REG(CORE_DEMCR) |= CORE_DEMCR_TRCENA;
+  REG(DWT_CTRL) |= DWT_CTRL_CYCCNTENA;
+  glossy_reset_isr_profile();
+#endif /* GLOSSY_ISR_PROFILE */
+
   GLOSSY_DEBUG_GPIO_PIN_RF_ON_INIT();
   GLOSSY_DEBUG_GPIO_PIN_SFD_RX_INIT();
   GLOSSY_DEBUG_GPIO_PIN_SFD_TX_INIT();
@@ -1378,6 +2413,13 @@ glossy_status_t glossy_start(uint16_t initiator_id, uint8_t* payload, uint8_t pa
 
   g_cntxt.tx_cnt = 0;
   g_cntxt.rx_cnt = 0;
+#if GLOSSY_HW_FRAME_FILTER
+  g_cntxt.rx_pending = 0;
+  g_cntxt.rx_accepted = 0;
+#endif /* GLOSSY_HW_FRAME_FILTER */
+#if GLOSSY_FEC
+  g_cntxt.fec_len = 0;
+#endif /* GLOSSY_FEC */
 
   g_cntxt.t_ref_mtt = 0;
   g_cntxt.t_ref_updated = 0;
@@ -1386,6 +2428,13 @@ glossy_status_t glossy_start(uint16_t initiator_id, uint8_t* payload, uint8_t pa
   g_cntxt.T_slot_estimated = 0;
   g_cntxt.T_slot_sum = 0;
   g_cntxt.n_T_slots = 0;
+#if GLOSSY_SLOT_ESTIMATOR
+  g_cntxt.T_slot_persistent = 0;
+#endif /* GLOSSY_SLOT_ESTIMATOR */
+#if GLOSSY_T_REF_MULTI
+  g_cntxt.n_t_ref_samples = 0;
+  g_cntxt.t_ref_spread = 0;
+#endif /* GLOSSY_T_REF_MULTI */
 
 #if GLOSSY_RX_MAJORITY_VOTE
   g_cntxt.rx_payload_cnt = 0;
@@ -1393,15 +2442,29 @@ glossy_status_t glossy_start(uint16_t initiator_id, uint8_t* payload, uint8_t pa
 
   g_cntxt.relay_cnt_last_rx = 0;
   g_cntxt.relay_cnt_last_tx = 0;
+  g_cntxt.relay_cnt_first_rx = 0;
 
   g_cntxt.rf_err_reg_last = 0;
+  g_cntxt.aes_used = 0;
+#if GLOSSY_ENC_RELAY_CIPHER
+  g_cntxt.verify_len = 0;
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
 
   g_cntxt.crr_header.initiator_id = initiator_id;
   SET_GLOSSY_HEADER_SYNC_OPT(g_cntxt.crr_header.config, sync);
   SET_GLOSSY_HEADER_N_MAX_TX(g_cntxt.crr_header.config, n_tx_max);
   g_cntxt.crr_header.relay_cnt = 0;
 
-  glossy_set_irq_priorities();
+  if (!g_cntxt.irq_priorities_held) {
+    glossy_set_irq_priorities();
+  }
+
+#if GLOSSY_ISR_SPECIALIZE
+  /* Receivers that pass the sync option get their variant now, the others (GLOSSY_UNKNOWN_SYNC)
+   * learn the mode of the flood from the first packet they receive
+   */
+  select_isr();
+#endif /* GLOSSY_ISR_SPECIALIZE */
 
   if (IS_INITIATOR()) {
     /* If it is the initiator it has to know whether to use time synchronization or not */
@@ -1409,17 +2472,28 @@ glossy_status_t glossy_start(uint16_t initiator_id, uint8_t* payload, uint8_t pa
       PRINTF("Invalid sync option\n");
       return GLOSSY_STATUS_FAIL;
     }
+#if GLOSSY_SHORT_INITIATOR
+    if (initiator_id > 0xff) {
+      PRINTF("Initiator ID too large\n");
+      return GLOSSY_STATUS_FAIL;
+    }
+#endif /* GLOSSY_SHORT_INITIATOR */
 
     /* Calculate Glossy packet length */
     g_cntxt.g_pkt_len = payload_len + GET_GLOSSY_HEADER_LEN(g_cntxt.crr_header.config);
+#if GLOSSY_FEC
+    /* The MIC detects corrupted frames but cannot repair them, so encrypted floods get parity too */
+    SET_IHEADER_FEC_FLAG(g_cntxt.id_header);
+#endif /* GLOSSY_FEC */
     /* Calculate TX RX length */
     if (GET_IHEADER_ENC_FLAG(g_cntxt.id_header) == IHEADER_ENC_FLAG) {
       /* Encryption enabled */
-      g_cntxt.tx_rx_len = IHEADER_LEN + g_cntxt.g_pkt_len + GLOSSY_SEC_MAC_LEN
-                          + GLOSSY_SEC_NONCE_LEN + FOOTER_LEN;
+      g_cntxt.tx_rx_len = FRAME_HEADER_LEN + g_cntxt.g_pkt_len + GLOSSY_SEC_MAC_LEN
+                          + GLOSSY_SEC_NONCE_LEN + FEC_LEN(g_cntxt.id_header) + FOOTER_LEN;
     } else {
       /* Encryption is disabled */
-      g_cntxt.tx_rx_len = IHEADER_LEN + g_cntxt.g_pkt_len + FOOTER_LEN;
+      g_cntxt.tx_rx_len = FRAME_HEADER_LEN + g_cntxt.g_pkt_len + FEC_LEN(g_cntxt.id_header)
+                          + FOOTER_LEN;
     }
 
     if (g_cntxt.tx_rx_len > CC2538_RF_MAX_PACKET_LEN) {
@@ -1428,6 +2502,16 @@ glossy_status_t glossy_start(uint16_t initiator_id, uint8_t* payload, uint8_t pa
       return GLOSSY_STATUS_FAIL;
     }
 
+#if GLOSSY_HW_FRAME_FILTER
+    /* Copy MAC header to tx_rx_buffer. Receivers relay it unchanged */
+    g_cntxt.tx_rx_buffer[0] = MHR_FCF0;
+    g_cntxt.tx_rx_buffer[1] = MHR_FCF1;
+    g_cntxt.tx_rx_buffer[2] = 0;
+    g_cntxt.tx_rx_buffer[3] = GLOSSY_PAN_ID & 0xff;
+    g_cntxt.tx_rx_buffer[4] = GLOSSY_PAN_ID >> 8;
+    g_cntxt.tx_rx_buffer[5] = MHR_BROADCAST_ADDR & 0xff;
+    g_cntxt.tx_rx_buffer[6] = MHR_BROADCAST_ADDR >> 8;
+#endif /* GLOSSY_HW_FRAME_FILTER */
     /* Copy identification header to tx_rx_buffer */
     g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET] = g_cntxt.id_header;
     /* Copy Glossy header to tx_rx_buffer */
@@ -1436,6 +2520,15 @@ glossy_status_t glossy_start(uint16_t initiator_id, uint8_t* payload, uint8_t pa
     /* Copy payload to tx_rx_buffer buffer */
     memcpy(&g_cntxt.tx_rx_buffer[BUF_TXRX_G_PAYLOAD_OFFSET(g_cntxt.crr_header.config)], payload,
            payload_len);
+#if GLOSSY_FEC
+    if (GET_IHEADER_FEC_FLAG(g_cntxt.id_header)
+        && GET_IHEADER_ENC_FLAG(g_cntxt.id_header) != IHEADER_ENC_FLAG) {
+      /* The parity covers the ID header and the Glossy packet with a zero relay counter. Encrypted
+       * frames get theirs in encryption_done()
+       */
+      fec_add_parity(0);
+    }
+#endif /* GLOSSY_FEC */
 
     if (GET_IHEADER_ENC_FLAG(g_cntxt.id_header) == IHEADER_ENC_FLAG) {
       /* Increment NONCE */
@@ -1461,20 +2554,146 @@ glossy_status_t glossy_start(uint16_t initiator_id, uint8_t* payload, uint8_t pa
       copy_to_rf_fifo();
     }
 
+#if GLOSSY_CHANNEL_HOPPING
+    if (WITH_RELAY_CNT(g_cntxt.crr_header.config)) {
+      hop_retune(0);
+    }
+#endif /* GLOSSY_CHANNEL_HOPPING */
     g_cntxt.state = GLOSSY_STATE_ACTIVE;
-    /* Start transmission. Actual transmission starts after 192 us */
-    radio_start_tx();
+#if GLOSSY_CHANNEL_HOPPING
+    /* Receivers follow the relay steps from the reference time, send the first SFD then. Leave some
+     * time to program the MAC timer
+     */
+    if (g_cntxt.hop_t_ref_set && WITH_RELAY_CNT(g_cntxt.crr_header.config)
+        && (int64_t)(g_cntxt.hop_t_ref - T_TX_TO_SFD - cc2538_rf_get_mac_time_now())
+           > (int64_t)USECONDS_TO_MT_TICKS(10)) {
+      mt_disable_cmp_events();
+      mt_schedule_tx_csp(g_cntxt.hop_t_ref - T_TX_TO_SFD);
+      GLOSSY_DEBUG_GPIO_SET_PIN_RF_ON();
+      ENERGEST_ON(ENERGEST_TYPE_LISTEN);
+    } else
+#endif /* GLOSSY_CHANNEL_HOPPING */
+    {
+      /* Start transmission. Actual transmission starts after 192 us */
+      radio_start_tx();
+    }
 
   } else {
     /* Not the initiator */
     g_cntxt.state = GLOSSY_STATE_ACTIVE;
     /* Receiver nodes just turn on the radio and listen */
     radio_on();
+#if GLOSSY_CHANNEL_HOPPING
+    if (g_cntxt.hop_t_ref_set && g_cntxt.hop_T_step > 0
+        && WITH_RELAY_CNT(g_cntxt.crr_header.config)) {
+      /* Follow the relay steps until the first reception */
+      g_cntxt.hop_lock = 1;
+      hop_lock_schedule();
+    }
+#endif /* GLOSSY_CHANNEL_HOPPING */
   }
 
   return GLOSSY_STATUS_SUCCESS;
 }
 
+#if GLOSSY_FEC
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * \brief Decode the kept frame into tx_rx_buffer
+ * \param with_relay_cnt Non-zero to assume a Glossy header with a relay counter
+ * \return Non-zero if the frame has been corrected and the assumption holds
+ *
+ * The initiator computes the parity with a zero relay counter, so the relay counter has to be
+ * cleared before decoding. Its presence depends on the sync option, which may be corrupted too.
+ * Without GLOSSY_ENC_RELAY_CIPHER, the relay counter of encrypted frames is part of the ciphertext
+ * and every transmitter computes the parity of the frame as sent, so nothing is cleared.
+ */
+static uint8_t fec_decode_frame(uint8_t with_relay_cnt)
+{
+  glossy_header_t* hdr = (glossy_header_t*)&g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET];
+
+  memcpy(g_cntxt.tx_rx_buffer, g_cntxt.fec_buffer, g_cntxt.fec_len);
+  if (with_relay_cnt) {
+    g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET + offsetof(glossy_header_t, relay_cnt)] = 0;
+  }
+
+  if (glossy_fec_decode(&g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET],
+                        g_cntxt.fec_len - MHR_LEN - FOOTER_LEN) < 0) {
+    return 0;
+  }
+
+#if !GLOSSY_ENC_RELAY_CIPHER
+  if (GET_IHEADER_ENC_FLAG(g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET])) {
+    return !with_relay_cnt;
+  }
+#endif /* !GLOSSY_ENC_RELAY_CIPHER */
+  return (GET_GLOSSY_HEADER_LEN(hdr->config) == sizeof(glossy_header_t)) == (with_relay_cnt != 0);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/**
+ * \brief Try to recover the payload from the kept frame after a flood without valid receptions
+ * \return Non-zero if the payload has been recovered
+ *
+ * Encrypted frames are corrected first and then decrypted, so the MIC checks the corrected frame.
+ */
+static uint8_t fec_recover(void)
+{
+  glossy_header_t* hdr = (glossy_header_t*)&g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET];
+  uint8_t id_header;
+  uint8_t header_len;
+  uint8_t sec_len;
+
+  if (g_cntxt.fec_len < GLOSSY_MIN_PKT_LEN_PLAIN + GLOSSY_FEC_N_PARITY) {
+    return 0;
+  }
+
+  if (!fec_decode_frame(1) && !fec_decode_frame(0)) {
+    return 0;
+  }
+
+  id_header = g_cntxt.tx_rx_buffer[BUF_TXRX_IHEADER_OFFSET];
+  if (GET_IHEADER_MAGIC(id_header) != IHEADER_MAGIC || !GET_IHEADER_FEC_FLAG(id_header)) {
+    return 0;
+  }
+
+  sec_len = GET_IHEADER_ENC_FLAG(id_header) ? GLOSSY_SEC_MAC_LEN + GLOSSY_SEC_NONCE_LEN : 0;
+  if (g_cntxt.fec_len < FRAME_HEADER_LEN + sec_len + GLOSSY_FEC_N_PARITY + FOOTER_LEN) {
+    return 0;
+  }
+  g_cntxt.tx_rx_len = g_cntxt.fec_len;
+  g_cntxt.g_pkt_len = g_cntxt.fec_len - FRAME_HEADER_LEN - sec_len - GLOSSY_FEC_N_PARITY
+                      - FOOTER_LEN;
+
+  if (sec_len) {
+#if GLOSSY_ENC_RELAY_CIPHER
+    if (g_cntxt.g_pkt_len < GET_GLOSSY_HEADER_LEN(hdr->config)
+        || !cipher_verify(g_cntxt.tx_rx_buffer, g_cntxt.g_pkt_len)) {
+      return 0;
+    }
+#else
+    if (!auth_decrypt_poll(NULL, 0, &g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET],
+                           g_cntxt.g_pkt_len)) {
+      return 0;
+    }
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
+  }
+
+  header_len = GET_GLOSSY_HEADER_LEN(hdr->config);
+  if (g_cntxt.g_pkt_len < header_len || validate_glossy_header(hdr) != GLOSSY_STATUS_SUCCESS) {
+    return 0;
+  }
+
+  g_cntxt.id_header = id_header;
+  memcpy(&g_cntxt.crr_header, hdr, header_len);
+  g_cntxt.payload_len = g_cntxt.g_pkt_len - header_len;
+  memcpy(g_cntxt.payload, &g_cntxt.tx_rx_buffer[BUF_TXRX_G_PKT_OFFSET + header_len],
+         g_cntxt.payload_len);
+
+  return 1;
+}
+#endif /* GLOSSY_FEC */
+
 /* ---------------------------------------------------------------------------------------------- */
 uint8_t glossy_stop(void)
 {
@@ -1486,42 +2705,100 @@ uint8_t glossy_stop(void)
   }
 
   g_cntxt.state = GLOSSY_STATE_OFF;
+#if GLOSSY_HW_FRAME_FILTER
+  /* A frame dropped after the last interrupt of the flood */
+  if (REG(RFCORE_SFR_RFIRQF0) & RFCORE_SFR_RFIRQF0_FRAME_ACCEPTED) {
+    g_cntxt.rx_accepted = 1;
+  }
+  hw_filter_account(cc2538_rf_get_mac_time_now());
+#endif /* GLOSSY_HW_FRAME_FILTER */
   radio_off();
+#if GLOSSY_CHANNEL_HOPPING
+  if (g_cntxt.hop_lock) {
+    /* Nothing received while following the relay steps */
+    g_cntxt.hop_lock = 0;
+    mt_disable_cmp_events();
+  }
+  /* The reference time applies to a single flood */
+  g_cntxt.hop_t_ref_set = 0;
+  /* Receivers of the next flood listen on the base channel */
+  REG(RFCORE_XREG_FREQCTRL) = g_cntxt.base_freqctrl;
+#endif /* GLOSSY_CHANNEL_HOPPING */
+
+  /* The FIFOs are not flushed here. The RX FIFO is flushed when the radio is turned on and the TX
+   * FIFO before a frame is copied into it.
+   */
 
-  /* Wait until rtimer captures the next tick */
-  t_now_rt = RTIMER_NOW();
-  do {
-    watchdog_periodic();
-  } while (t_now_rt == (t_next_rt = RTIMER_NOW()));
-  t_now_mtt = cc2538_rf_get_mac_time_now();
-
-  CC2538_RF_CSP_ISFLUSHRX();
-  CC2538_RF_CSP_ISFLUSHTX();
+#if GLOSSY_ENC_RELAY_CIPHER
+  if (g_cntxt.verify_len && !cipher_verify(g_cntxt.verify_buffer, g_cntxt.verify_len)) {
+    /* Forged or corrupted flood. Neither its payload nor its timing is used */
+    g_cntxt.rx_cnt = 0;
+    g_cntxt.payload_len = 0;
+    g_cntxt.t_ref_updated = 0;
+  }
+  g_cntxt.verify_len = 0;
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
 
   if (g_cntxt.t_ref_updated) {
 
+    /* Wait until rtimer captures the next tick */
+    t_now_rt = RTIMER_NOW();
+    do {
+      watchdog_periodic();
+    } while (t_now_rt == (t_next_rt = RTIMER_NOW()));
+    t_now_mtt = cc2538_rf_get_mac_time_now();
+
+    /* A flood is much shorter than 2^32 MAC timer ticks (134 s), so 32-bit arithmetic is enough */
     if (g_cntxt.n_T_slots > 0) {
-      g_cntxt.t_ref_mtt -= (g_cntxt.relay_cnt_t_ref * g_cntxt.T_slot_sum) / g_cntxt.n_T_slots;
+#if GLOSSY_T_REF_MULTI
+      g_cntxt.t_ref_mtt += (int64_t)combine_t_ref_samples(g_cntxt.T_slot_sum / g_cntxt.n_T_slots);
+#else
+      g_cntxt.t_ref_mtt -= (uint64_t)g_cntxt.relay_cnt_t_ref
+                           * (g_cntxt.T_slot_sum / g_cntxt.n_T_slots);
+#endif /* GLOSSY_T_REF_MULTI */
+#if GLOSSY_SLOT_ESTIMATOR
+      slot_est_update(g_cntxt.t_ref_len, g_cntxt.t_ref_enc, g_cntxt.T_slot_sum / g_cntxt.n_T_slots);
+#endif /* GLOSSY_SLOT_ESTIMATOR */
     } else {
-      g_cntxt.t_ref_mtt -= g_cntxt.relay_cnt_t_ref * g_cntxt.T_slot_estimated;
+#if GLOSSY_SLOT_ESTIMATOR
+      /* No slot measured in this flood. Nodes that have only received have no formula estimate
+       * either, so take the one of the frame length
+       */
+      slot_estimate_t* est = slot_est_find(g_cntxt.t_ref_len, g_cntxt.t_ref_enc);
+      if (est != NULL) {
+        g_cntxt.T_slot_persistent = est->T_slot;
+        g_cntxt.t_ref_mtt -= (uint64_t)g_cntxt.relay_cnt_t_ref * est->T_slot;
+      } else {
+        g_cntxt.t_ref_mtt -= (uint64_t)g_cntxt.relay_cnt_t_ref * get_T_slot_formula(g_cntxt.t_ref_len);
+      }
+#else
+      /* Receivers have no estimate of the transmission, take the one of the received length */
+      g_cntxt.t_ref_mtt -= (uint64_t)g_cntxt.relay_cnt_t_ref
+                           * (g_cntxt.T_slot_estimated ? g_cntxt.T_slot_estimated
+                                                       : get_T_slot_formula(g_cntxt.tx_rx_len));
+#endif /* GLOSSY_SLOT_ESTIMATOR */
     }
 
-    uint64_t t_ref_to_now_mtt = t_now_mtt - g_cntxt.t_ref_mtt;
-    rtimer_clock_t t_ref_to_mt_now_rt = 1 + (rtimer_clock_t)(t_ref_to_now_mtt / CLOCK_PHI);
+    uint32_t t_ref_to_now_mtt = (uint32_t)(t_now_mtt - g_cntxt.t_ref_mtt);
+    rtimer_clock_t t_ref_to_mt_now_rt = 1 + glossy_mac_ticks_to_rtimer(t_ref_to_now_mtt);
     g_cntxt.t_ref_rt = t_next_rt - t_ref_to_mt_now_rt;
   }
 
-  glossy_restore_irq_priorities();
+  if (!g_cntxt.irq_priorities_held) {
+    glossy_restore_irq_priorities();
+  }
 
-  NVIC_DisableIRQ(AES_IRQn);
-  NVIC_ClearPendingIRQ(AES_IRQn);
-  crypto_set_isr_callback(NULL);
-  if(REG(AES_CTRL_ALG_SEL) != 0x00000000) {
-    /* glossy_stop() is called before AES is done. So we cancel all DMA transfers and
-     * reset the algorithm selection of the cryptoprocessor
-     */
-    REG(AES_DMAC_SWRES) = 0x00000001;
-    REG(AES_CTRL_ALG_SEL) = 0x00000000;
+  if (g_cntxt.aes_used) {
+    NVIC_DisableIRQ(AES_IRQn);
+    NVIC_ClearPendingIRQ(AES_IRQn);
+    crypto_set_isr_callback(NULL);
+    if(REG(AES_CTRL_ALG_SEL) != 0x00000000) {
+      /* glossy_stop() is called before AES is done. So we cancel all DMA transfers and
+       * reset the algorithm selection of the cryptoprocessor
+       */
+      REG(AES_DMAC_SWRES) = 0x00000001;
+      REG(AES_CTRL_ALG_SEL) = 0x00000000;
+    }
   }
 
 #if GLOSSY_RX_MAJORITY_VOTE
@@ -1540,6 +2817,14 @@ uint8_t glossy_stop(void)
   }
 #endif
 
+#if GLOSSY_FEC
+  if (!IS_INITIATOR() && g_cntxt.rx_cnt == 0 && g_cntxt.fec_len > 0 && fec_recover()) {
+    /* A corrupted frame has been corrected. Report it as a reception without synchronization */
+    g_cntxt.rx_cnt = 1;
+    g_cntxt.stats.fec_corrected++;
+  }
+#endif /* GLOSSY_FEC */
+
   g_cntxt.stats.rx_cnt += g_cntxt.rx_cnt;
   g_cntxt.stats.tx_cnt += g_cntxt.tx_cnt;
 
@@ -1555,9 +2840,16 @@ void glossy_debug_print(void) {
            ", T_slot_estimated %"PRIu64"\n",
             g_cntxt.n_T_slots,
             g_cntxt.relay_cnt_t_ref,
-            (g_cntxt.n_T_slots > 0) ? (g_cntxt.T_slot_sum / g_cntxt.n_T_slots) : 0,
+            (uint64_t)((g_cntxt.n_T_slots > 0) ? (g_cntxt.T_slot_sum / g_cntxt.n_T_slots) : 0),
             g_cntxt.t_ref_mtt,
             g_cntxt.T_slot_estimated);
+#if GLOSSY_T_REF_MULTI
+    PRINTF("[GLOSSY_FLOOD_DEBUG]\tn_tref_samples %"PRIu8", tref_spread %"PRIu32"\n",
+           g_cntxt.n_t_ref_samples, g_cntxt.t_ref_spread);
+#endif /* GLOSSY_T_REF_MULTI */
+#if GLOSSY_SLOT_ESTIMATOR
+    PRINTF("[GLOSSY_FLOOD_DEBUG]\tT_slot_persistent %"PRIu32"\n", g_cntxt.T_slot_persistent);
+#endif /* GLOSSY_SLOT_ESTIMATOR */
 
   }
 
@@ -1586,10 +2878,56 @@ void glossy_stats_print()
     printf("[GLOSSY_STATS_5]\t"
             "rf_err %"      PRIu16", bad_crc %"       PRIu16"\n",
             g_cntxt.stats.rf_errs, g_cntxt.stats.bad_crc);
+    printf("[GLOSSY_STATS_7]\t"
+            "n_bad_i_header %"PRIu16", n_hw_filtered %"PRIu16"\n",
+            g_cntxt.stats.bad_i_header, g_cntxt.stats.hw_filtered);
+#if GLOSSY_FEC
+    printf("[GLOSSY_STATS_8]\t"
+            "n_fec_corrected %"PRIu16"\n",
+            g_cntxt.stats.fec_corrected);
+#endif /* GLOSSY_FEC */
+#if GLOSSY_ENC_RELAY_CIPHER
+    printf("[GLOSSY_STATS_9]\t"
+            "n_cipher_relayed %"PRIu16", n_bad_mac %"PRIu16"\n",
+            g_cntxt.stats.cipher_relayed, g_cntxt.stats.bad_mac);
+#endif /* GLOSSY_ENC_RELAY_CIPHER */
+#if GLOSSY_CHANNEL_HOPPING
+    printf("[GLOSSY_STATS_10]\t"
+            "n_hop_retunes %"PRIu16", n_hop_rx_off_base %"PRIu16"\n",
+            g_cntxt.stats.hop_retunes, g_cntxt.stats.hop_rx_off_base);
+#endif /* GLOSSY_CHANNEL_HOPPING */
+#if GLOSSY_ISR_PROFILE
+    printf("[GLOSSY_STATS_6]\t"
+            "isr_n %"       PRIu32", isr_cycles_avg %"PRIu32", isr_cycles_max %"PRIu32", "
+            "isr_stack_max %"PRIu16"\n",
+            g_cntxt.isr_profile.n_isr,
+            g_cntxt.isr_profile.n_isr > 0
+              ? g_cntxt.isr_profile.cycles_sum / g_cntxt.isr_profile.n_isr : 0,
+            g_cntxt.isr_profile.cycles_max,
+            g_cntxt.isr_profile.stack_max);
+#endif /* GLOSSY_ISR_PROFILE */
 
 #endif /* GLOSSY_DEBUG */
 }
 
+/* ---------------------------------------------------------------------------------------------- */
+void glossy_get_isr_profile(glossy_isr_profile_t* profile)
+{
+#if GLOSSY_ISR_PROFILE
+  memcpy(profile, &g_cntxt.isr_profile, sizeof(glossy_isr_profile_t));
+#else
+  memset(profile, 0, sizeof(glossy_isr_profile_t));
+#endif /* GLOSSY_ISR_PROFILE */
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+void glossy_reset_isr_profile(void)
+{
+#if GLOSSY_ISR_PROFILE
+  memset(&g_cntxt.isr_profile, 0, sizeof(glossy_isr_profile_t));
+#endif /* GLOSSY_ISR_PROFILE */
+}
+
 /* ---------------------------------------------------------------------------------------------- */
 uint8_t glossy_is_t_ref_updated(void)
 {
@@ -1602,6 +2940,60 @@ rtimer_clock_t glossy_get_t_ref(void)
   return g_cntxt.t_ref_rt;
 }
 
+/* ---------------------------------------------------------------------------------------------- */
+rtimer_clock_t glossy_mac_time_to_rtimer(uint64_t t_mt)
+{
+  rtimer_clock_t t_now_rt;
+  rtimer_clock_t t_next_rt;
+  uint64_t t_now_mtt;
+  int32_t t_mt_to_now;
+
+  /* Wait until rtimer captures the next tick, as in glossy_stop() */
+  t_now_rt = RTIMER_NOW();
+  do {
+  } while (t_now_rt == (t_next_rt = RTIMER_NOW()));
+  t_now_mtt = cc2538_rf_get_mac_time_now();
+
+  t_mt_to_now = (int32_t)(t_now_mtt - t_mt);
+  if (t_mt_to_now >= 0) {
+    return t_next_rt - (1 + glossy_mac_ticks_to_rtimer(t_mt_to_now));
+  }
+  return t_next_rt + glossy_mac_ticks_to_rtimer(-t_mt_to_now);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+rtimer_clock_t glossy_mac_ticks_to_rtimer(uint32_t d_mt)
+{
+  return (rtimer_clock_t)(((uint64_t)d_mt * g_cntxt.mtt_to_rt) >> 32);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+void glossy_set_next_t_ref(rtimer_clock_t t_ref, uint8_t payload_len)
+{
+#if GLOSSY_CHANNEL_HOPPING
+  rtimer_clock_t t_now_rt;
+  rtimer_clock_t t_next_rt;
+  uint64_t t_now_mtt;
+  uint32_t frame_len;
+
+  /* Wait until rtimer captures the next tick, as in glossy_mac_time_to_rtimer() */
+  t_now_rt = RTIMER_NOW();
+  do {
+  } while (t_now_rt == (t_next_rt = RTIMER_NOW()));
+  t_now_mtt = cc2538_rf_get_mac_time_now();
+
+  g_cntxt.hop_t_ref = t_now_mtt + (uint64_t)(((int64_t)(int32_t)(t_ref - t_next_rt)
+                                              * g_cntxt.rt_to_mtt) >> 16);
+  g_cntxt.hop_t_ref_set = 1;
+
+  /* Relay steps last as long as the slots of the frame, which receivers have to predict */
+  frame_len = get_frame_len(payload_len,
+                            GET_IHEADER_ENC_FLAG(g_cntxt.id_header) == IHEADER_ENC_FLAG);
+  g_cntxt.hop_T_step = (payload_len == GLOSSY_UNKNOWN_PAYLOAD_LEN
+                        || frame_len > CC2538_RF_MAX_PACKET_LEN) ? 0 : get_T_slot_formula(frame_len);
+#endif /* GLOSSY_CHANNEL_HOPPING */
+}
+
 /* ---------------------------------------------------------------------------------------------- */
 uint8_t glossy_get_n_rx(void)
 {
@@ -1629,12 +3021,70 @@ void glossy_set_enc(glossy_enc_t enc) {
   }
 }
 
+/* ---------------------------------------------------------------------------------------------- */
+glossy_status_t glossy_set_channel(uint8_t channel)
+{
+  if (g_cntxt.state != GLOSSY_STATE_OFF) {
+    return GLOSSY_STATUS_FAIL;
+  }
+  if (cc2538_rf_set_channel(channel) == CC2538_RF_CHANNEL_SET_ERROR) {
+    PRINTF("glossy_set_channel(): invalid channel %u\n", channel);
+    return GLOSSY_STATUS_FAIL;
+  }
+#if GLOSSY_CHANNEL_HOPPING
+  hop_set_base_channel(channel);
+#endif /* GLOSSY_CHANNEL_HOPPING */
+  return GLOSSY_STATUS_SUCCESS;
+}
+
 /* ---------------------------------------------------------------------------------------------- */
 uint8_t glossy_get_relay_cnt_first_rx(void)
 {
   return g_cntxt.relay_cnt_t_ref;
 }
 
+/* ---------------------------------------------------------------------------------------------- */
+uint32_t glossy_get_t_ref_spread(void)
+{
+#if GLOSSY_T_REF_MULTI
+  return g_cntxt.t_ref_spread;
+#else
+  return 0;
+#endif /* GLOSSY_T_REF_MULTI */
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+uint8_t glossy_get_n_hops(void)
+{
+  if (g_cntxt.rx_cnt == 0 || !WITH_RELAY_CNT(g_cntxt.crr_header.config)) {
+    return 0;
+  }
+  return g_cntxt.relay_cnt_first_rx + 1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+rtimer_clock_t glossy_get_flood_duration(uint8_t payload_len, uint8_t n_hops, uint8_t n_tx_max,
+                                         glossy_enc_t enc)
+{
+  uint32_t frame_len = get_frame_len(payload_len, enc == GLOSSY_ENC_ON);
+  uint32_t T_slot_us;
+  uint32_t n_slots;
+
+  /* Same estimation as the one done at the first transmission. See glossy_tx_started() */
+  T_slot_us = BYTES_TO_USECONDS(RF_DATA_LEN_FIELD_LEN + frame_len)
+              + GLOSSY_PROCESSING_TIME
+              + RF_TRUNAROUND_TIME
+              + T_HOP_RETUNE_US
+              + BYTES_TO_USECONDS(5);
+
+  /* The farthest node receives the packet after n_hops slots and then alternates between
+   * receptions and transmissions until it has sent n_tx_max times.
+   */
+  n_slots = n_hops + 2 * n_tx_max;
+
+  return (rtimer_clock_t)(((uint64_t)n_slots * T_slot_us * RTIMER_SECOND) / 1000000) + 1;
+}
+
 /* ---------------------------------------------------------------------------------------------- */
 uint16_t glossy_get_initiator_id(void)
 {
@@ -1653,11 +3103,12 @@ uint8_t glossy_get_max_payload_len(glossy_enc_t enc)
   if (enc == GLOSSY_ENC_ON) {
     /* Encryption enabled */
     return CC2538_RF_MAX_PACKET_LEN
-        - (IHEADER_LEN + sizeof(glossy_header_t) + GLOSSY_SEC_MAC_LEN + GLOSSY_SEC_NONCE_LEN
-           + FOOTER_LEN);
+        - (FRAME_HEADER_LEN + sizeof(glossy_header_t) + GLOSSY_SEC_MAC_LEN + GLOSSY_SEC_NONCE_LEN
+           + FEC_PARITY_LEN + FOOTER_LEN);
   } else {
     /* Encryption is disabled */
-    return CC2538_RF_MAX_PACKET_LEN - (IHEADER_LEN + sizeof(glossy_header_t) + FOOTER_LEN);
+    return CC2538_RF_MAX_PACKET_LEN - (FRAME_HEADER_LEN + sizeof(glossy_header_t) + FEC_PARITY_LEN
+                                       + FOOTER_LEN);
   }
 
   return 0;
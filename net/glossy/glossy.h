@@ -109,8 +109,27 @@ typedef struct {
   uint16_t rf_errs;
   uint16_t rx_cnt;
   uint16_t tx_cnt;
+  uint16_t hw_filtered;     /**< Frames with a valid length dropped by the frame filter of the radio,
+                                 GLOSSY_CONF_HW_FRAME_FILTER only */
+  uint16_t fec_corrected;   /**< Floods recovered from a corrupted frame, GLOSSY_CONF_FEC only */
+  uint16_t cipher_relayed;  /**< Encrypted frames relayed without decrypting them,
+                                 GLOSSY_CONF_ENC_RELAY_CIPHER only */
+  uint16_t hop_retunes;     /**< Channel changes of receivers following the relay steps,
+                                 GLOSSY_CONF_CHANNEL_HOPPING only */
+  uint16_t hop_rx_off_base; /**< Floods first received on another channel than the base channel,
+                                 GLOSSY_CONF_CHANNEL_HOPPING only */
 } glossy_stats_t;
 
+/**
+ * CPU cycles and stack use of the RF RX/TX interrupt, measured with GLOSSY_CONF_ISR_PROFILE
+ */
+typedef struct {
+  uint32_t n_isr;           /**< Number of measured interrupts */
+  uint32_t cycles_sum;      /**< Sum of CPU cycles spent in the interrupt */
+  uint32_t cycles_max;      /**< Largest number of CPU cycles spent in one interrupt */
+  uint16_t stack_max;       /**< Deepest stack use below the interrupt entry, in bytes */
+} glossy_isr_profile_t;
+
 extern volatile uint16_t node_id;
 
 /***
@@ -129,6 +148,7 @@ glossy_status_t glossy_init(void);
  * @param[in]   n_tx_max maximum number of retransmissions
  * @param[in]   sync synchronization mode
  * @note        n_tx_max must be at most 15!
+ * @note        initiator_id must be below 256 with GLOSSY_CONF_SHORT_INITIATOR!
  *
  * start Glossy, i.e. initiate a flood (if node is initiator) or switch to RX
  * mode (receive/relay packets)
@@ -148,6 +168,16 @@ glossy_status_t glossy_start(uint16_t initiator_id,
  */
 uint8_t glossy_stop(void);
 
+/**
+ * @brief Keep the interrupt priorities used by Glossy between floods
+ * @param hold Non-zero to apply them until released, zero to restore the ones saved before
+ *
+ * By default every glossy_start() saves and reprograms the priorities of 12 interrupts and every
+ * glossy_stop() restores them. Protocols running back-to-back floods hold them instead.
+ * @note Must not be called while a flood is running.
+ */
+void glossy_hold_irq_priorities(uint8_t hold);
+
 /**
  * @brief Enable/Disable encryption
  * @param enc Specifies if the encryption should be enabled. Use GLOSSY_ENC_ON to enable and
@@ -163,6 +193,14 @@ void glossy_set_enc(glossy_enc_t enc);
  */
 glossy_status_t glossy_set_enc_key(uint8_t* key, glossy_aes_key_size_t key_size);
 
+/**
+ * @brief Retune the radio to another IEEE 802.15.4 channel
+ * @param channel Channel number, CC2538_RF_CHANNEL_MIN to CC2538_RF_CHANNEL_MAX
+ * @return GLOSSY_STATUS_SUCCESS if successful. GLOSSY_STATUS_FAIL if the channel is invalid or a
+ *         flood is running.
+ */
+glossy_status_t glossy_set_channel(uint8_t channel);
+
 /**
  * @brief  Query activity of glossy
  * @return The number of received bytes since glossy_start was called
@@ -188,7 +226,8 @@ uint8_t glossy_get_n_tx(void);
 uint8_t glossy_get_payload_len(void);
 
 /**
- * @brief  Indicates if the reference time has been updated in the last flood
+ * @brief  Indicates if the reference time has been updated in the last flood. Every flood with a
+ *         relay counter updates it, only floods with synchronization measure the slot length.
  * @return non-zero if reference time has been updated. Otherwise zero.
  * 
  */
@@ -200,6 +239,37 @@ uint8_t glossy_is_t_ref_updated(void);
  */
 rtimer_clock_t glossy_get_t_ref(void);
 
+/**
+ * @brief  Convert a MAC timer timestamp to rtimer time
+ * @param  t_mt MAC timer value, at most 67 s away from now
+ * @return rtimer time of t_mt
+ * @note   Waits for the next rtimer tick (up to 31 us) to capture both clocks at the same time.
+ */
+rtimer_clock_t glossy_mac_time_to_rtimer(uint64_t t_mt);
+
+/**
+ * @brief  Convert a duration in MAC timer ticks to rtimer ticks, rounded down
+ * @param  d_mt Duration in MAC timer ticks
+ * @return Duration in rtimer ticks
+ * @note   Uses the exact clock ratio. CLOCK_PHI truncates it, e.g. to 976 instead of 976.5625 at
+ *         32 MHz.
+ */
+rtimer_clock_t glossy_mac_ticks_to_rtimer(uint32_t d_mt);
+
+/**
+ * @brief  Announce the reference time of the next flood
+ * @param  t_ref rtimer time of the first SFD of the flood, a few ms from now at most
+ * @param  payload_len Expected payload length of the flood. The relay steps last as long as the
+ *         slots of its frames. GLOSSY_UNKNOWN_PAYLOAD_LEN if unknown. Ignored by the initiator.
+ * @note   With GLOSSY_CONF_CHANNEL_HOPPING, the initiator sends its first frame at t_ref and
+ *         receivers that know the payload length follow the channels of the relay steps from it
+ *         until their first reception. Others listen on the base channel. Must be called by all
+ *         nodes before glossy_start() of a flood with a relay counter, whose receivers pass its sync
+ *         option. Applies to that flood only. Does nothing otherwise. Waits for the next rtimer
+ *         tick (up to 31 us).
+ */
+void glossy_set_next_t_ref(rtimer_clock_t t_ref, uint8_t payload_len);
+
 /**
  * @brief  Get the ID of the initiator
  * @return the ID of the initiator which started the last flood.
@@ -218,6 +288,32 @@ glossy_sync_t glossy_get_sync_opt(void);
  */
 uint8_t glossy_get_relay_cnt_first_rx(void);
 
+/**
+ * @brief Get the spread of the reference time estimates of the last flood
+ * @return Difference between the latest and the earliest timestamp of the flood, each back-dated by
+ *         its relay count, in MAC timer ticks (31.25 ns). Zero unless GLOSSY_CONF_T_REF_MULTI is set
+ *         and the flood measured its slot length.
+ */
+uint32_t glossy_get_t_ref_spread(void);
+
+/**
+ * @brief Get the hop distance to the initiator of the last flood
+ * @return the relay count of the first reception plus one, or zero if nothing was received or
+ *         the flood does not carry a relay counter.
+ */
+uint8_t glossy_get_n_hops(void);
+
+/**
+ * @brief Estimate the time a flood needs to complete in the whole network
+ * @param payload_len Length of the payload
+ * @param n_hops      Number of hops the flood has to travel (network diameter)
+ * @param n_tx_max    Maximum number of transmissions of each node
+ * @param enc         Encryption state
+ * @return Duration of the flood in rtimer ticks
+ */
+rtimer_clock_t glossy_get_flood_duration(uint8_t payload_len, uint8_t n_hops, uint8_t n_tx_max,
+                                         glossy_enc_t enc);
+
 /**
  * @brief Get maximum length of payload
  * @param  enc Encryption state
@@ -237,6 +333,17 @@ void glossy_get_stats(glossy_stats_t* stats);
  */
 uint32_t glossy_get_last_rf_error(void);
 
+/**
+ * @brief Get the RF RX/TX interrupt profile. All zero unless GLOSSY_CONF_ISR_PROFILE is set.
+ * @param profile A pointer to the profile structure.
+ */
+void glossy_get_isr_profile(glossy_isr_profile_t* profile);
+
+/**
+ * @brief Reset the RF RX/TX interrupt profile.
+ */
+void glossy_reset_isr_profile(void);
+
 /**
  * @brief Print Glossy debug information.
  */
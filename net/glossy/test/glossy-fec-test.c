@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2026, Uppsala University, Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file   glossy-fec-test.c
+ *
+ * Host test of the Reed-Solomon codec of glossy-fec.c. Random codewords of random length get random
+ * bit errors, scattered or in bursts, up to and beyond the correction capacity. Codewords with at
+ * most GLOSSY_FEC_N_PARITY / 2 corrupted bytes must be restored exactly. Beyond that, the decoder
+ * has to report a failure or return a valid codeword of another message (a miscorrection, which no
+ * code can rule out); both are counted.
+ *
+ * Build and run from this directory, once per parity length of interest:
+ *
+ *   gcc -Wall -Wextra -I.. -o glossy-fec-test glossy-fec-test.c ../glossy-fec.c
+ *   ./glossy-fec-test [n_words [seed]]
+ *
+ * Add -DGLOSSY_FEC_CONF_N_PARITY=2 (or 16, ...) for other parity lengths. The exit status is
+ * non-zero if any check failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glossy-fec.h"
+
+#define N_WORDS_DEFAULT     100000
+#define T_MAX               (GLOSSY_FEC_N_PARITY / 2)
+/* Corrupted bytes beyond the capacity that are reported separately */
+#define N_BEYOND            4
+#define N_ROWS              (T_MAX + N_BEYOND + 2)
+
+typedef struct {
+  unsigned long words;
+  unsigned long corrected;
+  unsigned long detected;
+  unsigned long miscorrected;
+  unsigned long failed;
+} row_t;
+
+static uint32_t rng_state;
+
+/* ---------------------------------------------------------------------------------------------- */
+/* xorshift32, so that runs are reproducible on any host */
+static uint32_t rng(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Flip bits of the codeword, scattered or as a burst. Returns the number of corrupted bytes */
+static uint8_t inject_bit_errors(uint8_t* cw, const uint8_t* ref, uint8_t cw_len)
+{
+  uint16_t n_bits_cw = (uint16_t)cw_len * 8;
+  uint16_t n_flips, i, bit;
+  uint8_t n_bytes = 0;
+
+  if (rng() & 1) {
+    /* Scattered: up to two bit errors per byte the code can correct, plus some beyond */
+    n_flips = rng() % (2 * (T_MAX + N_BEYOND) + 1);
+    for (i = 0; i < n_flips; i++) {
+      bit = rng() % n_bits_cw;
+      cw[bit / 8] ^= 1 << (bit % 8);
+    }
+  } else {
+    /* Burst: consecutive bits, spanning up to T_MAX + N_BEYOND bytes */
+    n_flips = 1 + rng() % (8 * (T_MAX + N_BEYOND));
+    bit = rng() % n_bits_cw;
+    for (i = 0; i < n_flips && bit < n_bits_cw; i++, bit++) {
+      /* Not every bit of a burst is wrong */
+      if (i == 0 || i == n_flips - 1 || (rng() & 1)) {
+        cw[bit / 8] ^= 1 << (bit % 8);
+      }
+    }
+  }
+
+  for (i = 0; i < cw_len; i++) {
+    n_bytes += cw[i] != ref[i];
+  }
+  return n_bytes;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Check one codeword. Returns non-zero if the decoder misbehaved */
+static int check_word(row_t* rows)
+{
+  uint8_t ref[255];
+  uint8_t cw[255];
+  uint8_t check[255];
+  uint8_t msg_len = 1 + rng() % (255 - GLOSSY_FEC_N_PARITY);
+  uint8_t cw_len = msg_len + GLOSSY_FEC_N_PARITY;
+  uint8_t n_bytes, i;
+  row_t* row;
+  int8_t ret;
+
+  for (i = 0; i < msg_len; i++) {
+    ref[i] = rng();
+  }
+  glossy_fec_encode(ref, msg_len, &ref[msg_len]);
+  memcpy(cw, ref, cw_len);
+
+  n_bytes = inject_bit_errors(cw, ref, cw_len);
+  row = &rows[n_bytes < N_ROWS - 1 ? n_bytes : N_ROWS - 1];
+  row->words++;
+
+  ret = glossy_fec_decode(cw, cw_len);
+
+  if (n_bytes <= T_MAX) {
+    if (ret == n_bytes && memcmp(cw, ref, cw_len) == 0) {
+      row->corrected++;
+      return 0;
+    }
+    printf("FAIL: %u corrupted bytes of %u, decode returned %d%s\n", n_bytes, cw_len, ret,
+           ret >= 0 ? " with a wrong codeword" : "");
+    row->failed++;
+    return 1;
+  }
+
+  if (ret < 0) {
+    row->detected++;
+    return 0;
+  }
+  /* Accepted although beyond the capacity. It must be a valid codeword within reach */
+  glossy_fec_encode(cw, msg_len, check);
+  if (ret <= T_MAX && memcmp(cw, ref, cw_len) != 0
+      && memcmp(check, &cw[msg_len], GLOSSY_FEC_N_PARITY) == 0) {
+    row->miscorrected++;
+    return 0;
+  }
+  printf("FAIL: %u corrupted bytes of %u, decode returned %d with an invalid codeword\n",
+         n_bytes, cw_len, ret);
+  row->failed++;
+  return 1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+int main(int argc, char** argv)
+{
+  unsigned long n_words = argc > 1 ? strtoul(argv[1], NULL, 0) : N_WORDS_DEFAULT;
+  unsigned long n, n_failed = 0;
+  row_t rows[N_ROWS];
+  row_t total;
+  uint8_t i;
+
+  rng_state = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+  if (rng_state == 0) {
+    rng_state = 1;
+  }
+  memset(rows, 0, sizeof(rows));
+  memset(&total, 0, sizeof(total));
+
+  glossy_fec_init();
+  for (n = 0; n < n_words; n++) {
+    n_failed += check_word(rows);
+  }
+
+  printf("GLOSSY_FEC_N_PARITY %u, %lu codewords, seed %s\n", GLOSSY_FEC_N_PARITY, n_words,
+         argc > 2 ? argv[2] : "1");
+  printf("%8s %10s %10s %10s %12s %8s\n",
+         "bytes", "words", "corrected", "detected", "miscorrected", "failed");
+  for (i = 0; i < N_ROWS; i++) {
+    printf("%7u%s %10lu %10lu %10lu %12lu %8lu\n", i, i == N_ROWS - 1 ? "+" : " ",
+           rows[i].words, rows[i].corrected, rows[i].detected, rows[i].miscorrected,
+           rows[i].failed);
+    total.words += rows[i].words;
+    total.corrected += rows[i].corrected;
+    total.detected += rows[i].detected;
+    total.miscorrected += rows[i].miscorrected;
+    total.failed += rows[i].failed;
+  }
+  printf("%8s %10lu %10lu %10lu %12lu %8lu\n", "total", total.words, total.corrected,
+         total.detected, total.miscorrected, total.failed);
+
+  if (n_failed > 0) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("PASSED\n");
+  return 0;
+}
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2026, Uppsala University, Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// @file lwb-channel.c
+/// @brief Channel selection by the host based on the link quality reported by the nodes.
+///
+/// Every node estimates the share of frames it received corrupted or only partially (CRC and length
+/// errors, receive timeouts, RF errors and foreign frames) from the Glossy statistics of each round
+/// and reports it in the header of its data packets. The host averages the reports of a round with
+/// its own estimate. After LWB_CHANNEL_SELECT_N_BAD_ROUNDS consecutive rounds above
+/// LWB_CHANNEL_SELECT_THRESHOLD it blacklists the channel for LWB_CHANNEL_BLACKLIST_ROUNDS rounds
+/// and announces the best other channel of LWB_CHANNELS in LWB_CHANNEL_SWITCH_N_ROUNDS consecutive
+/// schedules, so that nodes missing some of them still learn about it. The best channel is the one
+/// with the lowest quality average the host measured on it the last time; channels not tried yet,
+/// or whose blacklisting has expired, count as just good enough. All nodes retune at the end of the round whose schedule counts down to 1.
+/// Sources that lose synchronization nonetheless go through the channels while bootstrapping.
+
+#include <string.h>
+
+#include "contiki.h"
+#include "glossy.h"
+#include "lwb-common.h"
+#include "lwb-macros.h"
+#include "lwb-channel.h"
+
+#if LWB_CHANNEL_SELECT_ON
+
+#if LWB_DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#define N_CHANNELS    (sizeof(channels) / sizeof(channels[0]))
+
+extern lwb_context_t lwb_context;
+
+static const uint8_t channels[] = LWB_CHANNELS;
+static uint8_t channel_idx;
+
+/// @brief Glossy statistics at the end of the last round
+static glossy_stats_t last_stats;
+/// @brief Own quality estimate on the current channel
+static uint8_t quality;
+
+/// @brief Reports of the current round (host only)
+static uint16_t report_sum;
+static uint16_t n_reports;
+/// @brief Number of consecutive rounds above the threshold (host only)
+static uint8_t n_bad_rounds;
+/// @brief Number of rounds left before another switch may be decided (host only)
+static uint8_t n_holdoff_rounds;
+/// @brief Average of the reports of the network on each channel, LWB_CHANNEL_QUALITY_UNKNOWN if
+///        not known (host only)
+static uint8_t ch_quality[N_CHANNELS];
+/// @brief Number of rounds each channel stays blacklisted (host only)
+static uint16_t ch_blacklist[N_CHANNELS];
+/// @brief Number of schedules left to announce the pending switch in and its channel (host only)
+static uint8_t switch_countdown;
+static uint8_t switch_idx;
+
+/// @brief Time the current channel has been tuned to while bootstrapping (source only)
+static rtimer_clock_t t_scan;
+
+/*------------------------------------------------------------------------------------------------*/
+static void set_channel(uint8_t idx)
+{
+  channel_idx = idx;
+  quality = LWB_CHANNEL_QUALITY_UNKNOWN;
+  if (glossy_set_channel(channels[idx]) != GLOSSY_STATUS_SUCCESS) {
+    PRINTF("cannot set channel %u\r\n", channels[idx]);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Add a sample to a quality average over the last rounds
+static uint8_t smooth(uint8_t avg, uint8_t q)
+{
+  if (avg == LWB_CHANNEL_QUALITY_UNKNOWN) {
+    return q;
+  }
+  return (uint8_t)((3 * (uint16_t)avg + q) / 4);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void update_quality()
+{
+  glossy_stats_t stats;
+  uint16_t n_errs;
+  uint16_t n_rx;
+  uint8_t q;
+
+  glossy_get_stats(&stats);
+  /* The counters are cumulative and wrap around */
+  n_errs = (uint16_t)(stats.bad_crc - last_stats.bad_crc)
+           + (uint16_t)(stats.bad_length - last_stats.bad_length)
+           + (uint16_t)(stats.bad_i_header - last_stats.bad_i_header)
+           + (uint16_t)(stats.rx_timeout - last_stats.rx_timeout)
+           + (uint16_t)(stats.rf_errs - last_stats.rf_errs)
+           + (uint16_t)(stats.hw_filtered - last_stats.hw_filtered);
+  n_rx = stats.rx_cnt - last_stats.rx_cnt;
+  memcpy(&last_stats, &stats, sizeof(glossy_stats_t));
+
+  if (n_errs + n_rx == 0) {
+    return;
+  }
+
+  q = (uint8_t)((100UL * n_errs) / ((uint32_t)n_errs + n_rx));
+  quality = smooth(quality, q);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Pick the channel to switch to, the one with the best known quality among the channels
+///        that are not blacklisted, the first one after the current channel on a tie
+/// @return Index into channels, or channel_idx if all others are blacklisted
+static uint8_t select_channel()
+{
+  uint8_t best = channel_idx;
+  uint8_t best_q = 0xff;
+  uint8_t idx;
+  uint8_t q;
+  uint8_t i;
+
+  for (i = 1; i < N_CHANNELS; i++) {
+    idx = (channel_idx + i) % N_CHANNELS;
+    if (ch_blacklist[idx] > 0) {
+      continue;
+    }
+    q = (ch_quality[idx] == LWB_CHANNEL_QUALITY_UNKNOWN) ? LWB_CHANNEL_SELECT_THRESHOLD
+                                                         : ch_quality[idx];
+    if (q < best_q) {
+      best_q = q;
+      best = idx;
+    }
+  }
+  return best;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_channel_init()
+{
+  set_channel(0);
+  glossy_get_stats(&last_stats);
+  report_sum = 0;
+  n_reports = 0;
+  n_bad_rounds = 0;
+  n_holdoff_rounds = 0;
+  switch_countdown = 0;
+  switch_idx = 0;
+  memset(ch_quality, LWB_CHANNEL_QUALITY_UNKNOWN, sizeof(ch_quality));
+  memset(ch_blacklist, 0, sizeof(ch_blacklist));
+  t_scan = RTIMER_NOW();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_channel_get_quality()
+{
+  return quality;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_channel_add_report(uint8_t q)
+{
+  if (q == LWB_CHANNEL_QUALITY_UNKNOWN) {
+    return;
+  }
+  report_sum += q;
+  n_reports++;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_channel_compute_switch()
+{
+  uint16_t sum = report_sum;
+  uint16_t n = n_reports;
+  uint8_t i;
+
+  report_sum = 0;
+  n_reports = 0;
+
+  for (i = 0; i < N_CHANNELS; i++) {
+    if (ch_blacklist[i] > 0 && --ch_blacklist[i] == 0) {
+      /* The interference may be gone. Try the channel again when needed */
+      ch_quality[i] = LWB_CHANNEL_QUALITY_UNKNOWN;
+    }
+  }
+
+  if (switch_countdown > 0) {
+    return LWB_CHANNEL_SWITCH(switch_countdown--, switch_idx);
+  }
+
+  if (quality != LWB_CHANNEL_QUALITY_UNKNOWN) {
+    sum += quality;
+    n++;
+  }
+
+  if (n == 0) {
+    /* Nothing heard in this round */
+    return 0;
+  }
+
+  ch_quality[channel_idx] = smooth(ch_quality[channel_idx], sum / n);
+
+  if (n_holdoff_rounds > 0) {
+    n_holdoff_rounds--;
+    return 0;
+  }
+
+  if (sum / n > LWB_CHANNEL_SELECT_THRESHOLD) {
+    n_bad_rounds++;
+  } else {
+    n_bad_rounds = 0;
+  }
+
+  if (n_bad_rounds < LWB_CHANNEL_SELECT_N_BAD_ROUNDS || N_CHANNELS < 2) {
+    return 0;
+  }
+
+  n_bad_rounds = 0;
+  ch_blacklist[channel_idx] = LWB_CHANNEL_BLACKLIST_ROUNDS;
+  switch_idx = select_channel();
+  if (switch_idx == channel_idx) {
+    PRINTF("quality %u, all other channels blacklisted\r\n", sum / n);
+    return 0;
+  }
+  switch_countdown = LWB_CHANNEL_SWITCH_N_ROUNDS;
+  PRINTF("quality %u, switching to channel %u\r\n", sum / n, channels[switch_idx]);
+
+  return LWB_CHANNEL_SWITCH(switch_countdown--, switch_idx);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_channel_round_end(lwb_sched_info_t* sched_info)
+{
+  uint8_t idx = LWB_CHANNEL_SWITCH_GET_IDX(sched_info->channel_switch);
+
+  update_quality();
+
+  if (LWB_CHANNEL_SWITCH_GET_COUNTDOWN(sched_info->channel_switch) != 1
+      || idx >= N_CHANNELS || idx == channel_idx) {
+    return;
+  }
+
+  set_channel(idx);
+  n_bad_rounds = 0;
+  n_holdoff_rounds = LWB_CHANNEL_SELECT_HOLDOFF;
+  LWB_STATS_SCHED(n_channel_switches)++;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_channel_skip_round(lwb_sched_info_t* sched_info)
+{
+  uint8_t countdown = LWB_CHANNEL_SWITCH_GET_COUNTDOWN(sched_info->channel_switch);
+
+  if (countdown > 1) {
+    sched_info->channel_switch = LWB_CHANNEL_SWITCH(countdown - 1,
+                                                    LWB_CHANNEL_SWITCH_GET_IDX(sched_info->channel_switch));
+  } else {
+    /* Either nothing is pending or the switch has already been done in the last round */
+    sched_info->channel_switch = 0;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_channel_scan_start()
+{
+  t_scan = RTIMER_NOW();
+  glossy_get_stats(&last_stats);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_channel_scan()
+{
+  /* Nothing received while bootstrapping says little about the channel */
+  glossy_get_stats(&last_stats);
+
+  if (RTIMER_NOW() - t_scan < T_CHANNEL_SCAN_DWELL || N_CHANNELS < 2) {
+    return;
+  }
+
+  set_channel((channel_idx + 1) % N_CHANNELS);
+  t_scan = RTIMER_NOW();
+  PRINTF("scanning channel %u\r\n", channels[channel_idx]);
+}
+
+#endif /* LWB_CHANNEL_SELECT_ON */
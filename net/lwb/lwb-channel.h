@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026, Uppsala University, Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __LWB_CHANNEL_H__
+#define __LWB_CHANNEL_H__
+
+/// @file lwb-channel.h
+/// @brief Channel selection by the host based on the link quality reported by the nodes.
+
+#include "contiki.h"
+#include "lwb-common.h"
+
+#if LWB_CHANNEL_SELECT_ON
+
+/// @brief Tune to the first channel of LWB_CHANNELS and reset the quality estimates.
+void lwb_channel_init();
+
+/// @brief Get the own link quality estimate to be reported to the host.
+/// @return Share of corrupted or missed receptions in percent, smoothed over the last rounds.
+///         LWB_CHANNEL_QUALITY_UNKNOWN if nothing has been received on the current channel yet.
+uint8_t lwb_channel_get_quality();
+
+/// @brief Record the link quality reported in a data packet of the current round (host only).
+/// @param quality Reported quality. LWB_CHANNEL_QUALITY_UNKNOWN is ignored.
+void lwb_channel_add_report(uint8_t quality);
+
+/// @brief Close the reports of the current round and get the channel switch to be announced in
+///        the next schedule (host only).
+/// @return Channel switch field of the schedule. @see LWB_CHANNEL_SWITCH
+uint8_t lwb_channel_compute_switch();
+
+/// @brief Update the own quality estimate and retune if the schedule of the round that just ended
+///        announced a switch for its end.
+/// @param sched_info Schedule information of the round that just ended
+void lwb_channel_round_end(lwb_sched_info_t* sched_info);
+
+/// @brief Count down an announced switch in a schedule that was missed and is reconstructed from
+///        the previous one (source only).
+/// @param sched_info Reconstructed schedule information
+void lwb_channel_skip_round(lwb_sched_info_t* sched_info);
+
+/// @brief Start searching the host on all channels after synchronization has been lost (source only).
+void lwb_channel_scan_start();
+
+/// @brief Move on to the next channel if no schedule has been received on the current one for
+///        T_CHANNEL_SCAN_DWELL (source only). To be called after each unsuccessful bootstrap attempt.
+void lwb_channel_scan();
+
+#endif /* LWB_CHANNEL_SELECT_ON */
+
+#endif /* __LWB_CHANNEL_H__ */
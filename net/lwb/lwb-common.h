@@ -70,13 +70,23 @@ typedef enum {
     LWB_STREAM_TYPE_MOD          ///< Stream modify request.
 } stream_req_types_t;
 
+/// @brief Outcome of a stream request at the host
+typedef enum {
+    LWB_STREAM_ADMITTED = 0,     ///< The stream is scheduled (or deleted).
+    LWB_STREAM_REJECTED,         ///< The stream does not fit and is dropped.
+    LWB_STREAM_WAITLISTED        ///< The stream is scheduled once enough bandwidth is free.
+} lwb_stream_result_t;
+
 /// @brief LWB packet types
 typedef enum {
     LWB_PKT_TYPE_NO_DATA,       ///< No Type
     LWB_PKT_TYPE_STREAM_REQ,    ///< Stream requests
     LWB_PKT_TYPE_STREAM_ACK,    ///< Stream acknowledgements
     LWB_PKT_TYPE_DATA,          ///< Data packets
-    LWB_PKT_TYPE_SCHED          ///< Schedule packets
+    LWB_PKT_TYPE_SCHED,         ///< Schedule packets
+    LWB_PKT_TYPE_EVENT,         ///< Event packets sent in the event slot
+    LWB_PKT_TYPE_EVENT_ACK,     ///< Event acknowledgement sent by the host
+    LWB_PKT_TYPE_ONESHOT        ///< Streamless message sent in a contention slot
 } pkt_types_t;
 
 /// @brief Synchronization states
@@ -119,8 +129,27 @@ typedef struct __attribute__ ((__packed__)) {
   uint8_t  data_len;  ///< Data options
   uint8_t  in_queue;  ///< Number of packets in queue that are ready to be sent
   uint8_t  options;   ///< Data options
+#if LWB_CHANNEL_SELECT_ON
+  uint8_t  ch_quality; ///< Share of corrupted or missed receptions of the sender in percent.
+                       ///  LWB_CHANNEL_QUALITY_UNKNOWN if not known yet.
+#endif
 } data_header_t;
 
+#if LWB_COMPACT_HDR_ON
+/// @brief Header of data and event packets on air in the compact profile. The number of packets in
+///        queue travels in the upper bits of the LWB packet header and the data length is given by
+///        the length of the flood. Piggybacked stream requests therefore end with their number.
+typedef struct __attribute__ ((__packed__)) {
+  uint8_t  to_id;     ///< To node ID
+  uint8_t  options;   ///< Data options
+#if LWB_CHANNEL_SELECT_ON
+  uint8_t  ch_quality; ///< Share of corrupted or missed receptions of the sender in percent.
+#endif
+} data_air_header_t;
+#else
+typedef data_header_t data_air_header_t;
+#endif /* LWB_COMPACT_HDR_ON */
+
 
 /// @brief This header is used when sending stream requests as separate messages.
 typedef struct __attribute__ ((__packed__)) {
@@ -139,32 +168,66 @@ typedef struct __attribute__ ((__packed__)) lwb_stream_req {
   uint8_t  req_type;      ///< Request type. Least significant 2 bits represent stream request type.
                          ///  Most significant 6 bits represent request ID.
                          ///  @see stream_req_types_t and GET_STREAM_ID and SET_STREAM_ID
+#if LWB_SLOT_CLASSES_ON
+  uint8_t  max_len;       ///< Maximum application payload of the stream. Zero if unknown.
+#endif
 } lwb_stream_req_t;
 
+#if LWB_SCHED_PHASE_ON
+/// @brief time_info of a stream request leaving the phase of the stream to the host
+#define LWB_STREAM_PHASE_ANY    0xffff
+#endif
+
 /// @brief Structure for the header of a schedule
 typedef struct __attribute__ ((__packed__)) {
   uint32_t time;          ///< The current time at the host.
   uint16_t round_period; ///< Round period (duration between beginning of two rounds) in seconds
   uint8_t  n_slots;       ///< Number of slots in the round.
                           ///  Most significant 2 bits represent free slots and least significant 6 bits represent data slots.
+#if LWB_EVENT_SLOT_ON
+  uint8_t  n_event_slots; ///< Number of event slots in the round. The first one precedes the data
+                          ///  slots, the others are fast event slots following the contention slots.
+                          ///  Every round spends T_EVENT_SLOT_LEN on the event slot, which is taken
+                          ///  from the data bandwidth of all rounds. Fast event slots are only added
+                          ///  while events are pending and cost T_EVENT_FAST_PERIOD each, taken from
+                          ///  the data slots of that round.
+#endif
+#if LWB_DYN_SLOT_LEN_ON
+  uint8_t  n_hops;        ///< Network diameter the schedule and data floods of the round are sized for.
+                          ///  Zero means the maximum durations T_SYNC_ON and T_RR_ON.
+#endif
+#if LWB_CHANNEL_SELECT_ON
+  uint8_t  channel_switch; ///< Announced channel switch. Zero if none. @see LWB_CHANNEL_SWITCH
+#endif
 } lwb_sched_info_t;
 
 /// @brief LWB schedule
 typedef struct __attribute__ ((__packed__)) {
   lwb_sched_info_t    sched_info;                    ///< schedule information
-  uint16_t            slots[LWB_SCHED_MAX_SLOTS];    ///< slots. The node ID will be stored.
+  uint16_t            slots[LWB_SCHED_MAX_SLOTS];    ///< slots. The node ID (short address with
+                                                     ///  LWB_CONF_SHORT_ADDR) will be stored.
+#if LWB_SLOT_CLASSES_ON
+  uint8_t             slot_cfgs[LWB_SCHED_MAX_SLOTS]; ///< Duration class and N_TX of each data slot.
+                                                      ///  @see LWB_SLOT_CFG
+#endif
 } lwb_schedule_t;
 
 typedef struct lwb_stream_info {
   struct lwb_stream_info *next;
   uint16_t node_id;             ///< Node ID
+#if LWB_SHORT_ADDR_ON
+  uint8_t  short_addr;          ///< Short address of the node
+#endif
   uint16_t ipi;                 ///< Inter-packet interval in seconds
   uint32_t last_assigned;
-  uint32_t next_ready;
+  uint32_t next_ready;          ///< Time of the next slot with LWB_CONF_SCHED_PHASE
   uint8_t  stream_id;           ///< Stream ID
   uint8_t  n_cons_missed;       ///< Number of consecutive slot misses for the stream
   uint8_t  n_used;        ///< Number of slots used in a round
   uint8_t  n_allocated;   ///< Number of allocated slots for the stream in a round
+#if LWB_SLOT_CLASSES_ON
+  uint8_t  max_len;       ///< Maximum application payload of the stream. Zero if unknown.
+#endif
 
   uint8_t  avg_max_qlen;
   uint8_t  max_qlen;            ///< Maximum length of the queue at the source node
@@ -174,10 +237,19 @@ typedef struct lwb_stream_info {
 
 } lwb_stream_info_t;
 
+/// @brief Network time: rtimer ticks of the host since it started
+typedef uint64_t lwb_net_time_t;
+
+/// @brief Error bound of the network time of a node that is not synchronized
+#define LWB_NET_TIME_UNSYNCED     ((rtimer_clock_t)-1)
+
 /// @brief LWB callbacks
 typedef struct lwb_callbacks {
   void (*p_on_data)(uint8_t*, uint8_t, uint16_t);
   void (*p_on_sched_end)(void);
+#if LWB_SCHED_ADMISSION_ON
+  void (*p_on_stream_ack)(uint8_t, lwb_stream_result_t); ///< Stream ID and outcome of its request
+#endif
 } lwb_callbacks_t;
 
 
@@ -188,7 +260,20 @@ typedef struct lwb_sched_stats {
   uint16_t n_no_space;       ///< Number of streams that are unable to add due to space unavailability
   uint16_t n_modified;       ///< Number of streams modified
   uint16_t n_duplicates;     ///< Number of duplicated stream requests
+#if LWB_SCHED_ADMISSION_ON
+  uint16_t n_waitlisted;     ///< Number of streams put on the waitlist
+  uint16_t n_rejected;       ///< Number of streams rejected for lack of bandwidth
+#endif
   uint16_t n_unused_slots;
+#if LWB_DYN_SLOT_LEN_ON
+  uint16_t n_slot_len_fallbacks; ///< Number of times the diameter estimate was too small
+#endif
+#if LWB_DYN_T_COMP_ON
+  uint16_t n_t_comp_overruns;    ///< Number of times the schedule computation exceeded its reserve
+#endif
+#if LWB_CHANNEL_SELECT_ON
+  uint16_t n_channel_switches;   ///< Number of channel switches
+#endif
 } lwb_sched_stats_t;
 
 /// @brief Glossy synchronization related statistics
@@ -197,6 +282,7 @@ typedef struct lwb_sync_stats {
   uint16_t n_sync_missed;      ///< Number of instances that the schedule is not received
   uint8_t n_rx;
   uint8_t relay_cnt_first_rx;
+  uint32_t t_ref_spread;       ///< Spread of the reference time estimates of the last schedule flood in MAC timer ticks
 } lwb_sync_stats_t;
 
 /// @brief Statistics related to data packets
@@ -206,6 +292,17 @@ typedef struct lwb_data_stats {
   uint16_t n_tx;             ///< Number of data packets transmitted
   uint16_t n_rx;             ///< Number of data packets received
   uint16_t n_rx_dropped;     ///< Number of data packets dropped
+#if LWB_EVENT_SLOT_ON
+  uint16_t n_event_tx;       ///< Number of event floods initiated
+  uint16_t n_event_acked;    ///< Number of events acknowledged by the host
+  uint16_t n_event_rx;       ///< Number of event packets received
+#endif
+#if LWB_ONESHOT_ON
+  uint16_t n_oneshot_tx;     ///< Number of one-shot messages sent in contention slots
+  uint16_t n_oneshot_acked;  ///< Number of one-shot messages acknowledged by the host
+  uint16_t n_oneshot_rx;     ///< Number of one-shot messages received
+  uint16_t n_oneshot_dup;    ///< Number of received one-shot messages dropped as duplicates
+#endif
 } lwb_data_stats_t;
 
 /// @brief Stream requests and acknowledgement related statistics
@@ -235,6 +332,9 @@ typedef struct {
   uint8_t          txrx_buf_len;                      /**< The length of the data in TX/RX buffer */
   uint8_t          poll_flags;                        /**< Flags that indicate why LWB main process is polled */
   uint8_t          n_my_slots;                        /**< Number of slots allocated for the node */
+#if LWB_SHORT_ADDR_ON
+  uint8_t          short_addr;                        /**< Short address assigned by the host. Zero if none yet */
+#endif
   glossy_enc_t     enc;
 
   // source node
@@ -245,6 +345,16 @@ typedef struct {
   // host
   uint16_t        stream_akcs[LWB_SCHED_MAX_SLOTS];   /**< IDs of the nodes which stream acknowledgements to be sent */
   uint8_t         n_stream_acks;                      /**< Number of stream acknowledgements */
+#if LWB_SHORT_ADDR_ON
+  uint8_t         stream_ack_addrs[LWB_SCHED_MAX_SLOTS]; /**< Short addresses of these nodes */
+#endif
+#if LWB_SCHED_ADMISSION_ON
+  uint8_t         stream_ack_results[LWB_SCHED_MAX_SLOTS]; /**< Stream IDs and outcomes, @see LWB_STREAM_ACK_RESULT */
+#endif
+#if LWB_ONESHOT_ON
+  uint16_t        oneshot_acks[LWB_ONESHOT_N_ACKS];   /**< IDs of the nodes whose one-shot messages are to be acknowledged */
+  uint8_t         n_oneshot_acks;                     /**< Number of one-shot acknowledgements */
+#endif
 
   // stats
   lwb_sync_stats_t            sync_stats;
@@ -283,13 +393,28 @@ typedef struct data_buf {
 typedef struct data_buf_lst_item {
   struct data_buf* next;
   uint16_t from_id;
+#if LWB_NET_TIME_ON
+  rtimer_clock_t t_rx;             ///< Scheduled start of the flood that delivered the packet
+#endif
   data_buf_t        buf;
 } data_buf_lst_item_t;
 
 
+#if LWB_STREAM_REQ_COALESCE_ON
+/// @brief Transmission state of a pending stream request
+typedef enum {
+  LWB_STREAM_REQ_NEW = 0,          ///< Not sent yet
+  LWB_STREAM_REQ_SENT,             ///< Sent, waiting for the acknowledgement
+  LWB_STREAM_REQ_CHANGED           ///< Sent, then merged with a later request of the same stream
+} lwb_stream_req_state_t;
+#endif /* LWB_STREAM_REQ_COALESCE_ON */
+
 typedef struct stream_req_lst_item {
   struct stream_req_lst_item* next;
   lwb_stream_req_t            req;
+#if LWB_STREAM_REQ_COALESCE_ON
+  uint8_t                     state;  ///< One of lwb_stream_req_state_t
+#endif
 } stream_req_lst_item_t;
 
 
@@ -299,12 +424,35 @@ typedef struct stream_req_lst_item {
 #define LWB_SET_STREAM_ID(req_opt, id)              (req_opt = (id << 2) | (req_opt & 0x03))
 #define LWB_SET_STREAM_TYPE(req_opt, type)          (req_opt = ((req_opt >> 2) << 2) | (type & 0x03))
 #define LWB_GET_STREAM_TYPE(req_opt)                (req_opt & 0x03)
+#define LWB_STREAM_ACK_RESULT(id, result)           ((id << 2) | (result & 0x03))
+#define LWB_GET_STREAM_RESULT(ack_res)              (ack_res & 0x03)
 #define LWB_GET_N_FREE_SLOTS(a)                     (a >> 6)
 #define LWB_SET_N_FREE_SLOTS(slots, free_slots)     (slots = (slots & 0x3f) | (free_slots << 6))
 #define LWB_GET_N_DATA_SLOTS(a)                     (a & 0x3f)
 #define LWB_SET_N_DATA_SLOTS(slots, data_slots)     (slots = (slots & 0xc0) | (data_slots & 0x3f))
 /// @}
 
+/// @defgroup Data slot configuration macros
+///           The least significant 2 bits represent the duration class and the next 2 bits N_TX - 1.
+/// @{
+#define LWB_SLOT_CLASS_MAX                          3
+#define LWB_SLOT_N_TX_MAX                           4
+#define LWB_SLOT_CFG(class, n_tx)                   ((((n_tx) - 1) << 2) | ((class) & 0x03))
+#define LWB_SLOT_CFG_GET_CLASS(cfg)                 ((cfg) & 0x03)
+#define LWB_SLOT_CFG_GET_N_TX(cfg)                  ((((cfg) >> 2) & 0x03) + 1)
+/// @}
+
+/// @defgroup Channel switch macros
+///           The most significant 4 bits count down the schedules left until the switch, which
+///           takes effect at the end of the round whose schedule carries 1. The least significant
+///           4 bits are the index of the new channel in LWB_CHANNELS.
+/// @{
+#define LWB_CHANNEL_SWITCH(countdown, idx)          ((((countdown) & 0x0f) << 4) | ((idx) & 0x0f))
+#define LWB_CHANNEL_SWITCH_GET_COUNTDOWN(sw)        ((sw) >> 4)
+#define LWB_CHANNEL_SWITCH_GET_IDX(sw)              ((sw) & 0x0f)
+#define LWB_CHANNEL_QUALITY_UNKNOWN                 0xff
+/// @}
+
 /// @addtogroup UI32 Macros
 ///           Unsign 32-bit integer lated macros to get/set low/high segments.
 /// @{
@@ -322,6 +470,9 @@ typedef struct stream_req_lst_item {
 #define GLOSSY_IS_SYNCED()          (glossy_is_t_ref_updated())
 /// @brief Set glossy's reference time not updated.
 #define GLOSSY_SET_UNSYNCED()       (set_t_ref_l_updated(0))
+/// @brief Announce to glossy the flood of the slot starting at time, carrying len bytes of payload
+///        (GLOSSY_UNKNOWN_PAYLOAD_LEN if not known). Call before glossy_start().
+#define GLOSSY_SET_SLOT_START(time, len) (glossy_set_next_t_ref((time) + T_FLOOD_REF, (len)))
 /// @}
 
 void lwb_save_energest();
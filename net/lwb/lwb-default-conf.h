@@ -154,6 +154,17 @@
 #else
 #define T_GUARD                     (RTIMER_SECOND / 1000)          // 1ms
 #endif
+
+/// @brief Time from the start of a slot to the first SFD of its flood. Announced to Glossy, so that
+///        synced receivers follow the channels of the relay steps. Has to cover the start of Glossy
+///        at the initiator. Zero without GLOSSY_CONF_CHANNEL_HOPPING.
+#ifdef LWB_CONF_T_FLOOD_REF
+#define T_FLOOD_REF                 LWB_CONF_T_FLOOD_REF
+#elif GLOSSY_CONF_CHANNEL_HOPPING
+#define T_FLOOD_REF                 (RTIMER_SECOND / 2048)          // ~0.5 ms
+#else
+#define T_FLOOD_REF                 0
+#endif
 /// @}
 
 /// @brief Scheduler configurations
@@ -212,6 +223,358 @@
 #define LWB_SLOT_ENERGEST_ON                  0
 #endif
 
+/// @brief Enable the event slot for urgent messages at the beginning of the data phase
+#ifdef LWB_CONF_EVENT_SLOT
+#define LWB_EVENT_SLOT_ON                     LWB_CONF_EVENT_SLOT
+#else
+#define LWB_EVENT_SLOT_ON                     0
+#endif
+
+/// @brief Number of Glossy retransmissions for event and event acknowledgement slots
+#ifdef LWB_CONF_N_EVENT
+#define N_EVENT                               LWB_CONF_N_EVENT
+#else
+#define N_EVENT                               N_RR
+#endif
+
+/// @brief Glossy duration for event slots
+#ifdef LWB_CONF_T_EVENT_ON
+#define T_EVENT_ON                            LWB_CONF_T_EVENT_ON
+#else
+#define T_EVENT_ON                            T_RR_ON
+#endif
+
+/// @brief Glossy duration for event acknowledgement slots
+#ifdef LWB_CONF_T_EVENT_ACK_ON
+#define T_EVENT_ACK_ON                        LWB_CONF_T_EVENT_ACK_ON
+#else
+#define T_EVENT_ACK_ON                        T_FREE_ON
+#endif
+
+/// @brief Number of fast event slots added after the contention slots while events are pending
+#ifdef LWB_CONF_EVENT_N_FAST_SLOTS
+#define LWB_EVENT_N_FAST_SLOTS                LWB_CONF_EVENT_N_FAST_SLOTS
+#else
+#define LWB_EVENT_N_FAST_SLOTS                3
+#endif
+
+/// @brief Interval between two fast event slots. Must fit an event and an ACK slot with gaps.
+#ifdef LWB_CONF_T_EVENT_FAST_PERIOD
+#define T_EVENT_FAST_PERIOD                   LWB_CONF_T_EVENT_FAST_PERIOD
+#else
+#define T_EVENT_FAST_PERIOD                   (RTIMER_SECOND / 4)           // 250 ms
+#endif
+
+/// @brief Upper bound of the backoff exponent used when an event is not acknowledged
+#ifdef LWB_CONF_EVENT_MAX_BACKOFF_EXP
+#define LWB_EVENT_MAX_BACKOFF_EXP             LWB_CONF_EVENT_MAX_BACKOFF_EXP
+#else
+#define LWB_EVENT_MAX_BACKOFF_EXP             2
+#endif
+
+/// @brief Size data slots and the schedule flood from the network diameter estimated by the host
+#ifdef LWB_CONF_DYN_SLOT_LEN
+#define LWB_DYN_SLOT_LEN_ON                   LWB_CONF_DYN_SLOT_LEN
+#else
+#define LWB_DYN_SLOT_LEN_ON                   0
+#endif
+
+/// @brief Number of rounds over which the host keeps the maximum diameter estimate
+#ifdef LWB_CONF_DYN_SLOT_LEN_WINDOW_SIZE
+#define LWB_DYN_SLOT_LEN_WINDOW_SIZE          LWB_CONF_DYN_SLOT_LEN_WINDOW_SIZE
+#else
+#define LWB_DYN_SLOT_LEN_WINDOW_SIZE          8
+#endif
+
+/// @brief Number of hops added to the diameter estimate before announcing it. Sources that have
+///        not finished the schedule flood within the last schedule duration listen for this many
+///        hops longer, which has to fit into LWB_CONF_T_S_R_GAP.
+#ifdef LWB_CONF_DYN_SLOT_LEN_HOP_MARGIN
+#define LWB_DYN_SLOT_LEN_HOP_MARGIN           LWB_CONF_DYN_SLOT_LEN_HOP_MARGIN
+#else
+#define LWB_DYN_SLOT_LEN_HOP_MARGIN           1
+#endif
+
+/// @brief Time added to the estimated flood duration
+#ifdef LWB_CONF_T_DYN_SLOT_LEN_MARGIN
+#define T_DYN_SLOT_LEN_MARGIN                 LWB_CONF_T_DYN_SLOT_LEN_MARGIN
+#else
+#define T_DYN_SLOT_LEN_MARGIN                 (RTIMER_SECOND / 1000)          // 1 ms
+#endif
+
+/// @brief Number of rounds with maximum slot lengths after the estimate turned out too small
+#ifdef LWB_CONF_DYN_SLOT_LEN_FALLBACK_ROUNDS
+#define LWB_DYN_SLOT_LEN_FALLBACK_ROUNDS      LWB_CONF_DYN_SLOT_LEN_FALLBACK_ROUNDS
+#else
+#define LWB_DYN_SLOT_LEN_FALLBACK_ROUNDS      4
+#endif
+
+/// @brief Largest LWB packet the dynamic slot lengths are sized for
+#ifdef LWB_CONF_DYN_SLOT_LEN_MAX_PAYLOAD
+#define LWB_DYN_SLOT_LEN_MAX_PAYLOAD          LWB_CONF_DYN_SLOT_LEN_MAX_PAYLOAD
+#else
+#define LWB_DYN_SLOT_LEN_MAX_PAYLOAD          LWB_MAX_TXRX_BUF_LEN
+#endif
+
+/// @brief Let streams declare their maximum payload and size each data slot and its N_TX accordingly
+#ifdef LWB_CONF_SLOT_CLASSES
+#define LWB_SLOT_CLASSES_ON                   LWB_CONF_SLOT_CLASSES
+#else
+#define LWB_SLOT_CLASSES_ON                   0
+#endif
+
+/// @brief Largest application payload of the three short slot classes. The fourth class fits any packet.
+#ifdef LWB_CONF_SLOT_CLASS_0_LEN
+#define LWB_SLOT_CLASS_0_LEN                  LWB_CONF_SLOT_CLASS_0_LEN
+#else
+#define LWB_SLOT_CLASS_0_LEN                  8
+#endif
+
+#ifdef LWB_CONF_SLOT_CLASS_1_LEN
+#define LWB_SLOT_CLASS_1_LEN                  LWB_CONF_SLOT_CLASS_1_LEN
+#else
+#define LWB_SLOT_CLASS_1_LEN                  24
+#endif
+
+#ifdef LWB_CONF_SLOT_CLASS_2_LEN
+#define LWB_SLOT_CLASS_2_LEN                  LWB_CONF_SLOT_CLASS_2_LEN
+#else
+#define LWB_SLOT_CLASS_2_LEN                  56
+#endif
+
+/// @brief Receive floods into a ring of buffers and process them while the next flood is running.
+///        Only the Glossy restart is left between slots, so LWB_CONF_T_GAP can be reduced after
+///        measuring it. Keep LWB_CONF_T_S_R_GAP large enough for handling the schedule.
+#ifdef LWB_CONF_DEFERRED_RX
+#define LWB_DEFERRED_RX_ON                    LWB_CONF_DEFERRED_RX
+#else
+#define LWB_DEFERRED_RX_ON                    0
+#endif
+
+/// @brief Number of receive buffers used for deferred processing
+#ifdef LWB_CONF_DEFERRED_RX_N_BUFS
+#define LWB_DEFERRED_RX_N_BUFS                LWB_CONF_DEFERRED_RX_N_BUFS
+#else
+#define LWB_DEFERRED_RX_N_BUFS                2
+#endif
+
+/// @brief Size the time reserved for schedule computation (T_COMP) from measurements on the host
+#ifdef LWB_CONF_DYN_T_COMP
+#define LWB_DYN_T_COMP_ON                     LWB_CONF_DYN_T_COMP
+#else
+#define LWB_DYN_T_COMP_ON                     0
+#endif
+
+/// @brief Number of rounds the computation time is measured over. T_COMP is used until it is full.
+#ifdef LWB_CONF_DYN_T_COMP_WINDOW_SIZE
+#define LWB_DYN_T_COMP_WINDOW_SIZE            LWB_CONF_DYN_T_COMP_WINDOW_SIZE
+#else
+#define LWB_DYN_T_COMP_WINDOW_SIZE            16
+#endif
+
+/// @brief Number of largest measurements ignored, i.e. 1 out of 16 gives the 94th percentile
+#ifdef LWB_CONF_DYN_T_COMP_N_OUTLIERS
+#define LWB_DYN_T_COMP_N_OUTLIERS             LWB_CONF_DYN_T_COMP_N_OUTLIERS
+#else
+#define LWB_DYN_T_COMP_N_OUTLIERS             1
+#endif
+
+/// @brief Factor applied to the measured bound
+#ifdef LWB_CONF_DYN_T_COMP_FACTOR
+#define LWB_DYN_T_COMP_FACTOR                 LWB_CONF_DYN_T_COMP_FACTOR
+#else
+#define LWB_DYN_T_COMP_FACTOR                 2
+#endif
+
+/// @brief Time added to the scaled bound
+#ifdef LWB_CONF_T_DYN_T_COMP_MARGIN
+#define T_DYN_T_COMP_MARGIN                   LWB_CONF_T_DYN_T_COMP_MARGIN
+#else
+#define T_DYN_T_COMP_MARGIN                   (RTIMER_SECOND / 500)           // 2 ms
+#endif
+
+/// @brief Let the host move the network to another channel when the reported link quality is poor
+#ifdef LWB_CONF_CHANNEL_SELECT
+#define LWB_CHANNEL_SELECT_ON                 LWB_CONF_CHANNEL_SELECT
+#else
+#define LWB_CHANNEL_SELECT_ON                 0
+#endif
+
+/// @brief Channels the network may use, in the order they are tried. The first one is used at boot.
+///        The default avoids the centre frequencies of the usual Wi-Fi channels 1, 6 and 11.
+#ifdef LWB_CONF_CHANNELS
+#define LWB_CHANNELS                          LWB_CONF_CHANNELS
+#else
+#define LWB_CHANNELS                          { 26, 15, 20, 25 }
+#endif
+
+/// @brief Share of corrupted or missed receptions, in percent, above which a round counts as bad
+#ifdef LWB_CONF_CHANNEL_SELECT_THRESHOLD
+#define LWB_CHANNEL_SELECT_THRESHOLD          LWB_CONF_CHANNEL_SELECT_THRESHOLD
+#else
+#define LWB_CHANNEL_SELECT_THRESHOLD          30
+#endif
+
+/// @brief Number of consecutive bad rounds before the host decides to switch
+#ifdef LWB_CONF_CHANNEL_SELECT_N_BAD_ROUNDS
+#define LWB_CHANNEL_SELECT_N_BAD_ROUNDS       LWB_CONF_CHANNEL_SELECT_N_BAD_ROUNDS
+#else
+#define LWB_CHANNEL_SELECT_N_BAD_ROUNDS       8
+#endif
+
+/// @brief Number of schedules announcing a switch before it takes effect (1 - 15)
+#ifdef LWB_CONF_CHANNEL_SWITCH_N_ROUNDS
+#define LWB_CHANNEL_SWITCH_N_ROUNDS           LWB_CONF_CHANNEL_SWITCH_N_ROUNDS
+#else
+#define LWB_CHANNEL_SWITCH_N_ROUNDS           3
+#endif
+
+/// @brief Number of rounds after a switch during which no other switch is decided
+#ifdef LWB_CONF_CHANNEL_SELECT_HOLDOFF
+#define LWB_CHANNEL_SELECT_HOLDOFF            LWB_CONF_CHANNEL_SELECT_HOLDOFF
+#else
+#define LWB_CHANNEL_SELECT_HOLDOFF            16
+#endif
+
+/// @brief Number of rounds the host avoids a channel it has left because of its quality. After
+///        that, its quality is considered unknown again.
+#ifdef LWB_CONF_CHANNEL_BLACKLIST_ROUNDS
+#define LWB_CHANNEL_BLACKLIST_ROUNDS          LWB_CONF_CHANNEL_BLACKLIST_ROUNDS
+#else
+#define LWB_CHANNEL_BLACKLIST_ROUNDS          256
+#endif
+
+/// @brief Time a bootstrapping source listens on a channel before trying the next one. Covers the
+///        longest round period so that at least one schedule is sent in the meantime.
+#ifdef LWB_CONF_T_CHANNEL_SCAN_DWELL
+#define T_CHANNEL_SCAN_DWELL                  LWB_CONF_T_CHANNEL_SCAN_DWELL
+#else
+#define T_CHANNEL_SCAN_DWELL                  ((LWB_SCHED_PERIOD_MAX + 1) * RTIMER_SECOND)
+#endif
+
+/// @brief Network time service: the time of the host, packet timestamps and timed callbacks
+#ifdef LWB_CONF_NET_TIME
+#define LWB_NET_TIME_ON                       LWB_CONF_NET_TIME
+#else
+#define LWB_NET_TIME_ON                       0
+#endif
+
+/// @brief Time before its deadline at which a timed callback hands over from the clock to the rtimer
+#ifdef LWB_CONF_T_NET_TIME_RTIMER
+#define T_NET_TIME_RTIMER                     LWB_CONF_T_NET_TIME_RTIMER
+#else
+#define T_NET_TIME_RTIMER                     (2 * RTIMER_SECOND / CLOCK_SECOND)
+#endif
+
+/// @brief Compact header profile for networks with node IDs below 256: one-byte addresses and the
+///        data header merged into the LWB packet header. Requires GLOSSY_CONF_SHORT_INITIATOR.
+#ifdef LWB_CONF_COMPACT_HDR
+#define LWB_COMPACT_HDR_ON                    LWB_CONF_COMPACT_HDR
+#else
+#define LWB_COMPACT_HDR_ON                    0
+#endif
+
+#if LWB_COMPACT_HDR_ON && !GLOSSY_CONF_SHORT_INITIATOR
+#error "LWB_CONF_COMPACT_HDR requires GLOSSY_CONF_SHORT_INITIATOR"
+#endif
+
+/// @brief Schedules carry short addresses the host assigns to the nodes when their first stream is
+///        admitted instead of their node IDs. Nodes learn theirs from the stream acknowledgements.
+#ifdef LWB_CONF_SHORT_ADDR
+#define LWB_SHORT_ADDR_ON                     LWB_CONF_SHORT_ADDR
+#else
+#define LWB_SHORT_ADDR_ON                     0
+#endif
+
+/// @brief Number of short addresses the host can hand out at a time, at most 255. The address of a
+///        node without streams is reused if the node has been told.
+#ifdef LWB_CONF_SHORT_ADDR_MAX_NODES
+#define LWB_SHORT_ADDR_MAX_NODES              LWB_CONF_SHORT_ADDR_MAX_NODES
+#else
+#define LWB_SHORT_ADDR_MAX_NODES              64
+#endif
+
+/// @brief Send stream acknowledgements in the schedule packet when they fit into it, saving the
+///        data slot of the host
+#ifdef LWB_CONF_SCHED_ACKS
+#define LWB_SCHED_ACKS_ON                     LWB_CONF_SCHED_ACKS
+#else
+#define LWB_SCHED_ACKS_ON                     0
+#endif
+
+/// @brief Merge a stream request of a source into the pending one of the same stream, so that only
+///        the latest state of each stream is sent to the host
+#ifdef LWB_CONF_STREAM_REQ_COALESCE
+#define LWB_STREAM_REQ_COALESCE_ON            LWB_CONF_STREAM_REQ_COALESCE
+#else
+#define LWB_STREAM_REQ_COALESCE_ON            0
+#endif
+
+/// @brief Tell sources whether their streams have been admitted, rejected or waitlisted
+#ifdef LWB_CONF_SCHED_ADMISSION
+#define LWB_SCHED_ADMISSION_ON                LWB_CONF_SCHED_ADMISSION
+#else
+#define LWB_SCHED_ADMISSION_ON                0
+#endif
+
+/// @brief Number of streams the host keeps waiting for bandwidth. Zero rejects them right away.
+#ifdef LWB_CONF_SCHED_WAITLIST_LEN
+#define LWB_SCHED_WAITLIST_LEN                LWB_CONF_SCHED_WAITLIST_LEN
+#else
+#define LWB_SCHED_WAITLIST_LEN                4
+#endif
+
+/// @brief Let sources send single messages without a stream in the contention slot
+#ifdef LWB_CONF_ONESHOT
+#define LWB_ONESHOT_ON                        LWB_CONF_ONESHOT
+#else
+#define LWB_ONESHOT_ON                        0
+#endif
+
+/// @brief Number of one-shot messages the host can acknowledge per round
+#ifdef LWB_CONF_ONESHOT_N_ACKS
+#define LWB_ONESHOT_N_ACKS                    LWB_CONF_ONESHOT_N_ACKS
+#else
+#define LWB_ONESHOT_N_ACKS                    4
+#endif
+
+/// @brief Number of senders whose last one-shot message is remembered to drop duplicates
+#ifdef LWB_CONF_ONESHOT_N_SOURCES
+#define LWB_ONESHOT_N_SOURCES                 LWB_CONF_ONESHOT_N_SOURCES
+#else
+#define LWB_ONESHOT_N_SOURCES                 16
+#endif
+
+/// @brief Hand out the data slots in a fixed order, shortest IPI first, so that streams due in
+///        every round keep their position
+#ifdef LWB_CONF_SCHED_PIN_SLOTS
+#define LWB_SCHED_PIN_SLOTS_ON                LWB_CONF_SCHED_PIN_SLOTS
+#else
+#define LWB_SCHED_PIN_SLOTS_ON                0
+#endif
+
+/// @brief Schedule every stream in the rounds given by the time offset of its add request instead
+///        of the round of the request, and let the host spread streams with equal periods
+#ifdef LWB_CONF_SCHED_PHASE
+#define LWB_SCHED_PHASE_ON                    LWB_CONF_SCHED_PHASE
+#else
+#define LWB_SCHED_PHASE_ON                    0
+#endif
+
+/// @brief Give the host data slots of its own for the packets in its queue
+#ifdef LWB_CONF_HOST_SLOTS
+#define LWB_HOST_SLOTS_ON                     LWB_CONF_HOST_SLOTS
+#else
+#define LWB_HOST_SLOTS_ON                     0
+#endif
+
+/// @brief Largest share of the data slots of a round the host may take, in percent
+#ifdef LWB_CONF_HOST_SLOTS_SHARE
+#define LWB_HOST_SLOTS_SHARE                  LWB_CONF_HOST_SLOTS_SHARE
+#else
+#define LWB_HOST_SLOTS_SHARE                  25
+#endif
+
 /// @}
 
 /// @brief GPIO debug configurations
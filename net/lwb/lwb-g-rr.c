@@ -50,6 +50,9 @@
 #include "lwb-g-rr.h"
 #include "lwb-scheduler.h"
 #include "lwb-sched-compressor.h"
+#include "lwb-slot-len.h"
+#include "lwb-channel.h"
+#include "lwb-time.h"
 
 #if LWB_DEBUG
 #define PRINTF(...) printf(__VA_ARGS__)
@@ -88,6 +91,126 @@ static uint8_t n_trials;
 
 static uint8_t stream_id_next;
 
+/// @brief Offset of the current slot from the start of the data phase
+static rtimer_clock_t t_slot_ofs;
+
+/// @brief Glossy durations of the schedule flood of the current round and of the current data slot
+static rtimer_clock_t t_sync_len;
+static rtimer_clock_t t_rr_len;
+
+/// @brief Number of Glossy transmissions in the current data slot
+static uint8_t n_tx_slot;
+
+#if LWB_SLOT_CLASSES_ON
+/// @brief Largest application payload, including stream requests, that fits into the current slot
+#define SLOT_APP_DATA_LEN_MAX() \
+  lwb_slot_len_get_class_len(LWB_SLOT_CFG_GET_CLASS(CURRENT_SCHEDULE().slot_cfgs[slot_idx]))
+#else
+#define SLOT_APP_DATA_LEN_MAX() LWB_PKT_APP_DATA_LEN_MAX()
+#endif
+
+/// @brief Start time of the current data or contention slot
+#define T_SLOT_START()  (lwb_context.t_sync_ref + t_sync_len + T_S_R_GAP + t_slot_ofs)
+
+#if LWB_NET_TIME_ON
+/// @brief Start of the slot of the last flood as measured by Glossy, or the scheduled one
+#define T_SLOT_MEASURED(t_sched) (GLOSSY_IS_SYNCED() ? GLOSSY_T_REF - T_FLOOD_REF : (t_sched))
+#endif /* LWB_NET_TIME_ON */
+
+/// @brief How a received packet is processed
+typedef enum {
+  RX_HANDLER_DATA,          ///< Data packet, possibly with piggybacked stream requests
+  RX_HANDLER_FROM_HOST,     ///< Packet sent by the host in its own slot
+  RX_HANDLER_STREAM_REQ     ///< Stream requests received in a contention slot
+} rx_handler_t;
+
+/// @brief A received LWB packet and the information about the flood that delivered it
+typedef struct {
+  uint8_t* buf;             ///< LWB packet, starting with the LWB packet header
+  uint8_t  len;             ///< Length of the LWB packet
+  uint16_t initiator_id;    ///< Initiator of the flood
+  uint8_t  n_hops;          ///< Hop distance to the initiator
+  uint8_t  slot_idx;        ///< Slot in which the packet was received
+  uint8_t  handler;         ///< @see rx_handler_t
+#if LWB_NET_TIME_ON
+  rtimer_clock_t t_slot;    ///< Start of the slot of the flood that delivered the packet
+#endif /* LWB_NET_TIME_ON */
+} rx_pkt_t;
+
+#if LWB_COMPACT_HDR_ON
+#define RX_PKT_TYPE(pkt)            ((pkt)->buf[0] & LWB_PKT_TYPE_MASK)
+#else
+#define RX_PKT_TYPE(pkt)            ((pkt)->buf[0])
+#endif /* LWB_COMPACT_HDR_ON */
+#define RX_PKT_DATA_PTR(pkt)        ((pkt)->buf + sizeof(lwb_pkt_header_t))
+/// Node ID, short address with LWB_SHORT_ADDR_ON and stream ID and result with LWB_SCHED_ADMISSION_ON
+#define EVENT_ACK_LEN               (sizeof(lwb_pkt_header_t) + sizeof(uint16_t))
+#define STREAM_ACK_LEN              (sizeof(uint16_t) + LWB_SHORT_ADDR_ON + LWB_SCHED_ADMISSION_ON)
+#define RX_PKT_APP_DATA_PTR(pkt)    ((pkt)->buf + sizeof(lwb_pkt_header_t) + sizeof(data_air_header_t))
+
+#if LWB_DEFERRED_RX_ON
+/// @brief Floods are received straight into these buffers and processed later
+static uint8_t rx_bufs[LWB_DEFERRED_RX_N_BUFS][LWB_MAX_TXRX_BUF_LEN];
+/// @brief Ring of received packets waiting to be processed
+static rx_pkt_t rx_pkts[LWB_DEFERRED_RX_N_BUFS];
+static uint8_t rx_head;
+static uint8_t rx_n;
+
+/// @brief Buffer for receiving floods
+#define RX_BUF()                    get_rx_buf()
+/// @brief Process stashed packets while Glossy is running
+#define PROCESS_DEFERRED_RX()       process_deferred_rx_pkts()
+#else
+#define RX_BUF()                    lwb_context.txrx_buf
+#define PROCESS_DEFERRED_RX()
+#endif /* LWB_DEFERRED_RX_ON */
+
+#if LWB_EVENT_SLOT_ON
+/** @brief Event buffer element list. Elements are allocated from the data buffers */
+LIST(lst_event_queue);
+/** @brief Number of events to be sent over LWB */
+static uint8_t event_q_size;
+/** @brief Iterator for the fast event slots */
+static uint8_t event_idx;
+/** @brief Start time of the current event slot */
+static rtimer_clock_t t_event;
+/** @brief Number of event slots to skip before trying to send an event again */
+static uint8_t n_event_slots_to_wait;
+/** @brief Number of consecutive unacknowledged event transmissions */
+static uint8_t n_event_trials;
+/** @brief Indicates that we initiated the flood in the current event slot */
+static uint8_t event_sent;
+/** @brief Initiator of the event received in the current event slot (host only) */
+static uint16_t event_winner;
+/** @brief Indicates that more events are waiting to be sent (host only) */
+static uint8_t events_pending;
+/** @brief Glossy statistics used to detect contending events (host only) */
+static glossy_stats_t event_g_stats;
+static uint16_t event_n_rx_errs;
+
+static struct pt pt_event;
+static pt_state_t pt_state_event;
+#endif /* LWB_EVENT_SLOT_ON */
+
+#if LWB_ONESHOT_ON
+/** @brief One-shot message list. Elements are allocated from the data buffers */
+LIST(lst_oneshot_queue);
+/** @brief Number of one-shot messages to be sent in contention slots */
+static uint8_t oneshot_q_size;
+/** @brief Sequence number of the head of the one-shot queue, kept until the host acknowledges it */
+static uint8_t oneshot_seq;
+
+/** @brief Sequence number of the last one-shot message delivered from a sender */
+typedef struct {
+  uint16_t node_id;
+  uint8_t  seq;
+} oneshot_seen_t;
+
+static oneshot_seen_t oneshot_seen[LWB_ONESHOT_N_SOURCES];
+/** @brief Entry to be replaced by the next new sender */
+static uint8_t oneshot_seen_next;
+#endif /* LWB_ONESHOT_ON */
+
 
 /*------------------------------------------------------------------------------------------------*/
 void lwb_g_rr_init()
@@ -105,50 +228,118 @@ void lwb_g_rr_init()
   n_trials = 0;
   stream_id_next = 1;
 
+#if LWB_DEFERRED_RX_ON
+  uint8_t i;
+  for (i = 0; i < LWB_DEFERRED_RX_N_BUFS; i++) {
+    rx_pkts[i].buf = rx_bufs[i];
+  }
+  rx_head = 0;
+  rx_n = 0;
+#endif /* LWB_DEFERRED_RX_ON */
+
+#if LWB_EVENT_SLOT_ON
+  list_init(lst_event_queue);
+  event_q_size = 0;
+  n_event_slots_to_wait = 0;
+  n_event_trials = 0;
+  event_sent = 0;
+  events_pending = 0;
+  pt_state_event.pt = &pt_event;
+#endif /* LWB_EVENT_SLOT_ON */
+
+#if LWB_ONESHOT_ON
+  list_init(lst_oneshot_queue);
+  oneshot_q_size = 0;
+  /* A random start, so that the first message after a reboot is not taken for a duplicate */
+  oneshot_seq = (uint8_t)random_rand();
+  memset(oneshot_seen, 0, sizeof(oneshot_seen));
+  oneshot_seen_next = 0;
+#endif /* LWB_ONESHOT_ON */
 }
 
 /*------------------------------------------------------------------------------------------------*/
 static void prepare_stream_acks()
 {
   SET_LWB_PKT_TYPE(LWB_PKT_TYPE_STREAM_ACK);
+  lwb_context.txrx_buf_len = sizeof(lwb_pkt_header_t) + lwb_g_rr_write_stream_acks(LWB_PKT_DATA_PTR());
+}
 
-  lwb_stream_ack_header_t* ack_header = (lwb_stream_ack_header_t*) LWB_PKT_DATA_PTR();
-  ack_header->n_acks = lwb_context.n_stream_acks;
-
-  memcpy(LWB_PKT_DATA_PTR() + sizeof(lwb_stream_ack_header_t), lwb_context.stream_akcs,
-         2 * lwb_context.n_stream_acks);
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Write the header of a data or event packet into the TX buffer, after its packet type
+static void write_data_header(data_header_t* hdr)
+{
+#if LWB_COMPACT_HDR_ON
+  data_air_header_t air_hdr;
+
+  lwb_context.txrx_buf[0] = (lwb_context.txrx_buf[0] & LWB_PKT_TYPE_MASK)
+                            | (MIN(hdr->in_queue, LWB_PKT_IN_QUEUE_MAX) << LWB_PKT_IN_QUEUE_SHIFT);
+  air_hdr.to_id = hdr->to_id;
+  air_hdr.options = hdr->options;
+#if LWB_CHANNEL_SELECT_ON
+  air_hdr.ch_quality = hdr->ch_quality;
+#endif /* LWB_CHANNEL_SELECT_ON */
+  memcpy(LWB_PKT_DATA_PTR(), &air_hdr, sizeof(data_air_header_t));
+#else
+  memcpy(LWB_PKT_DATA_PTR(), hdr, sizeof(data_header_t));
+#endif /* LWB_COMPACT_HDR_ON */
+}
 
-  lwb_context.txrx_buf_len = sizeof(lwb_pkt_header_t) + sizeof(lwb_stream_ack_header_t)
-                             + 2 * lwb_context.n_stream_acks;
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Read the header of a received data or event packet
+/// @return LWB_STATUS_FAIL if the packet is too short
+static lwb_status_t read_data_header(uint8_t* buf, uint8_t len, data_header_t* hdr)
+{
+  if (len < sizeof(lwb_pkt_header_t) + sizeof(data_air_header_t)) {
+    return LWB_STATUS_FAIL;
+  }
 
-  LWB_STATS_STREAM_REQ_ACK(n_ack_tx) += lwb_context.n_stream_acks;
+#if LWB_COMPACT_HDR_ON
+  data_air_header_t air_hdr;
+  uint8_t data_len = len - sizeof(lwb_pkt_header_t) - sizeof(data_air_header_t);
+
+  memcpy(&air_hdr, buf + sizeof(lwb_pkt_header_t), sizeof(data_air_header_t));
+  hdr->to_id = air_hdr.to_id;
+  hdr->in_queue = buf[0] >> LWB_PKT_IN_QUEUE_SHIFT;
+  hdr->options = air_hdr.options;
+#if LWB_CHANNEL_SELECT_ON
+  hdr->ch_quality = air_hdr.ch_quality;
+#endif /* LWB_CHANNEL_SELECT_ON */
+
+  if (LWB_PKT_APP_DATA_HDR_OPT_GET_PKT_TYPE(hdr) == LWB_PKT_TYPE_STREAM_REQ) {
+    /* The number of piggybacked stream requests is the last byte */
+    uint16_t req_len = sizeof(lwb_stream_req_header_t)
+                       + (uint16_t)buf[len - 1] * sizeof(lwb_stream_req_t);
+    if (data_len < req_len) {
+      return LWB_STATUS_FAIL;
+    }
+    data_len -= req_len;
+  }
+  hdr->data_len = data_len;
+#else
+  memcpy(hdr, buf + sizeof(lwb_pkt_header_t), sizeof(data_header_t));
+#endif /* LWB_COMPACT_HDR_ON */
 
-  lwb_context.n_stream_acks = 0;
+  return LWB_STATUS_SUCCESS;
 }
 
 /*------------------------------------------------------------------------------------------------*/
-static void prepare_data_packet()
+/// @brief Append as many pending stream requests as fit behind the data in the TX buffer
+static void piggyback_stream_reqs(data_header_t* header, uint8_t app_len_max)
 {
-  data_buf_lst_item_t* buf_item = list_head(lst_tx_buf_queue);
   stream_req_lst_item_t* req_item;
   uint8_t n_possible;
   uint8_t n_available;
   uint8_t i;
 
-  SET_LWB_PKT_TYPE(LWB_PKT_TYPE_DATA);
-  /* Copy only the data now and we will copy the header at the end.
-   * This is to avoid possible alignment issues
-   */
-  memcpy(LWB_PKT_DATA_PTR() + sizeof(data_header_t), &buf_item->buf.data, buf_item->buf.header.data_len);
-  lwb_context.txrx_buf_len = sizeof(lwb_pkt_header_t) + sizeof(data_header_t)
-                             + buf_item->buf.header.data_len;
-
   /* Calculate possible number of stream requests that can be piggybacked with the application
    * data
    */
-  n_possible = (LWB_PKT_APP_DATA_LEN_MAX() - buf_item->buf.header.data_len
-                - sizeof(lwb_stream_req_header_t))
-               / sizeof(lwb_stream_req_t);
+  if (app_len_max < header->data_len + sizeof(lwb_stream_req_header_t)) {
+    n_possible = 0;
+  } else {
+    n_possible = (app_len_max - header->data_len - sizeof(lwb_stream_req_header_t))
+                 / sizeof(lwb_stream_req_t);
+  }
   n_available = MIN(n_possible, stream_reqs_lst_size);
 
   if (lwb_context.lwb_mode == LWB_MODE_SOURCE && stream_reqs_lst_size > 0 && n_available > 0) {
@@ -156,9 +347,11 @@ static void prepare_data_packet()
     lwb_stream_req_header_t str_req_hdr;
 
     str_req_hdr.n_reqs = n_available;
+#if !LWB_COMPACT_HDR_ON
     memcpy(lwb_context.txrx_buf + lwb_context.txrx_buf_len, &str_req_hdr,
            sizeof(lwb_stream_req_header_t));
     lwb_context.txrx_buf_len += sizeof(lwb_stream_req_header_t);
+#endif /* !LWB_COMPACT_HDR_ON */
 
     /* Iterate through all stream requests and try to include them into one packet.
      * Here, we do not remove any of the stream requests from the list as they may need to be resent
@@ -172,13 +365,48 @@ static void prepare_data_packet()
              sizeof(lwb_stream_req_t));
 
       lwb_context.txrx_buf_len += sizeof(lwb_stream_req_t);
+#if LWB_STREAM_REQ_COALESCE_ON
+      req_item->state = LWB_STREAM_REQ_SENT;
+#endif
     }
-    LWB_PKT_APP_DATA_HDR_OPT_SET_PKT_TYPE(&(buf_item->buf.header), LWB_PKT_TYPE_STREAM_REQ);
+#if LWB_COMPACT_HDR_ON
+    /* The data length is implicit, so the receiver finds the requests from the end */
+    memcpy(lwb_context.txrx_buf + lwb_context.txrx_buf_len, &str_req_hdr,
+           sizeof(lwb_stream_req_header_t));
+    lwb_context.txrx_buf_len += sizeof(lwb_stream_req_header_t);
+#endif /* LWB_COMPACT_HDR_ON */
+    LWB_PKT_APP_DATA_HDR_OPT_SET_PKT_TYPE(header, LWB_PKT_TYPE_STREAM_REQ);
   }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void prepare_data_packet(uint8_t app_len_max)
+{
+  data_buf_lst_item_t* buf_item = list_head(lst_tx_buf_queue);
+
+  SET_LWB_PKT_TYPE(LWB_PKT_TYPE_DATA);
+  /* Copy only the data now and we will copy the header at the end.
+   * This is to avoid possible alignment issues
+   */
+  memcpy(LWB_PKT_APP_DATA_PTR(), &buf_item->buf.data, buf_item->buf.header.data_len);
+  lwb_context.txrx_buf_len = sizeof(lwb_pkt_header_t) + sizeof(data_air_header_t)
+                             + buf_item->buf.header.data_len;
+
+  piggyback_stream_reqs(&(buf_item->buf.header), app_len_max);
 
   /* Set data header and copy to the buffer */
   buf_item->buf.header.in_queue = tx_buf_q_size - 1;
-  memcpy(LWB_PKT_DATA_PTR(), &(buf_item->buf.header), sizeof(data_header_t));
+#if LWB_DYN_SLOT_LEN_ON
+  if (lwb_context.lwb_mode == LWB_MODE_SOURCE) {
+    /* Report our distance to the host */
+    LWB_PKT_APP_DATA_HDR_OPT_SET_N_HOPS(&(buf_item->buf.header),
+                                        lwb_context.sync_stats.relay_cnt_first_rx + 1);
+  }
+#endif /* LWB_DYN_SLOT_LEN_ON */
+#if LWB_CHANNEL_SELECT_ON
+  buf_item->buf.header.ch_quality = lwb_channel_get_quality();
+#endif /* LWB_CHANNEL_SELECT_ON */
+  write_data_header(&(buf_item->buf.header));
 
   list_remove(lst_tx_buf_queue, buf_item);
   memb_free(&mmb_data_buf, buf_item);
@@ -215,65 +443,93 @@ static void prepare_stream_reqs()
            sizeof(lwb_stream_req_t));
 
     lwb_context.txrx_buf_len += sizeof(lwb_stream_req_t);
+#if LWB_STREAM_REQ_COALESCE_ON
+    req_item->state = LWB_STREAM_REQ_SENT;
+#endif
   }
 
   LWB_STATS_STREAM_REQ_ACK(n_req_tx) += i;
 
 }
 
+#if LWB_ONESHOT_ON
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Prepare the head of the one-shot queue for a contention slot. Pending stream requests
+///        go along if they fit. The message stays in the queue until the host acknowledges it.
+static void prepare_oneshot_packet()
+{
+  data_buf_lst_item_t* buf_item = list_head(lst_oneshot_queue);
+
+  SET_LWB_PKT_TYPE(LWB_PKT_TYPE_ONESHOT);
+  memcpy(LWB_PKT_APP_DATA_PTR(), buf_item->buf.data, buf_item->buf.header.data_len);
+  lwb_context.txrx_buf_len = sizeof(lwb_pkt_header_t) + sizeof(data_air_header_t)
+                             + buf_item->buf.header.data_len;
+
+  buf_item->buf.header.options = 0;
+  piggyback_stream_reqs(&(buf_item->buf.header), LWB_PKT_APP_DATA_LEN_MAX());
+  LWB_PKT_APP_DATA_HDR_OPT_SET_ONESHOT_SEQ(&(buf_item->buf.header), oneshot_seq);
+
+  buf_item->buf.header.in_queue = oneshot_q_size - 1;
+#if LWB_CHANNEL_SELECT_ON
+  buf_item->buf.header.ch_quality = lwb_channel_get_quality();
+#endif /* LWB_CHANNEL_SELECT_ON */
+  write_data_header(&(buf_item->buf.header));
+
+  LWB_STATS_DATA(n_oneshot_tx)++;
+}
+#endif /* LWB_ONESHOT_ON */
+
 /*------------------------------------------------------------------------------------------------*/
 static uint8_t prepare_packets_from_host(void)
 {
-  if (lwb_context.n_stream_acks > 0) {
+  if (LWB_N_HOST_ACKS() > 0) {
     prepare_stream_acks();
     return 1;
   }
+#if LWB_HOST_SLOTS_ON
+  /* The other slots of the host carry its own packets */
+  if (tx_buf_q_size > 0) {
+    prepare_data_packet(SLOT_APP_DATA_LEN_MAX());
+    return 1;
+  }
+#endif /* LWB_HOST_SLOTS_ON */
   return 0;
 }
 
 /*------------------------------------------------------------------------------------------------*/
-static void iterate_stream_reqs(lwb_stream_req_header_t* str_req_hdr)
+static void iterate_stream_reqs(rx_pkt_t* pkt, uint8_t n_reqs, uint8_t* reqs)
 {
   uint8_t i;
-  lwb_stream_req_t *stream_req = (lwb_stream_req_t*) ((uint8_t*) str_req_hdr
-                                                      + sizeof(lwb_stream_req_header_t));
+  lwb_stream_req_t *stream_req = (lwb_stream_req_t*) reqs;
   lwb_stream_req_t stream_req_tmp;
-  for (i = 0; i < str_req_hdr->n_reqs; i++) {
+  for (i = 0; i < n_reqs; i++) {
     memcpy(&stream_req_tmp, &stream_req[i], sizeof(lwb_stream_req_t));
-    lwb_sched_process_stream_req(glossy_get_initiator_id(), &stream_req_tmp);
+    lwb_sched_process_stream_req(pkt->initiator_id, &stream_req_tmp);
   }
 }
 
 /*------------------------------------------------------------------------------------------------*/
-static void process_data_packet(uint8_t slot_idx)
+static lwb_status_t deliver_data_packet(rx_pkt_t* pkt, data_header_t* data_hdr)
 {
-  if (GET_LWB_PKT_TYPE() != LWB_PKT_TYPE_DATA) {
-    return;
-  }
-
-  if (lwb_context.txrx_buf_len < sizeof(lwb_pkt_header_t) + sizeof(data_header_t)) {
-    return;
-  }
-
-  lwb_sched_update_data_slot_usage(slot_idx, 1);
-
-  data_header_t data_hdr;
-  memcpy(&data_hdr, LWB_PKT_DATA_PTR(), sizeof(data_header_t));
-  if (data_hdr.to_id != node_id && data_hdr.to_id != 0) {
+  if (data_hdr->to_id != node_id && data_hdr->to_id != 0) {
     // We drop this packet
     LWB_STATS_DATA(n_rx_dropped)++;
-    return;
+    return LWB_STATUS_FAIL;
   }
 
   data_buf_lst_item_t* buf_item = memb_alloc(&mmb_data_buf);
   if (!buf_item) {
     LWB_STATS_DATA(n_rx_nospace)++;
-    return;
+    return LWB_STATUS_FAIL;
   }
 
-  buf_item->from_id = glossy_get_initiator_id();
-  /* Copy the data including the header into the buffer and add to the queue */
-  memcpy(&(buf_item->buf), LWB_PKT_DATA_PTR(), sizeof(data_header_t) + data_hdr.data_len);
+  buf_item->from_id = pkt->initiator_id;
+#if LWB_NET_TIME_ON
+  buf_item->t_rx = pkt->t_slot;
+#endif /* LWB_NET_TIME_ON */
+  /* Copy the header and the data into the buffer and add to the queue */
+  memcpy(&(buf_item->buf.header), data_hdr, sizeof(data_header_t));
+  memcpy(buf_item->buf.data, RX_PKT_APP_DATA_PTR(pkt), data_hdr->data_len);
   list_add(lst_rx_buf_queue, buf_item);
   rx_buf_q_size++;
 
@@ -283,123 +539,507 @@ static void process_data_packet(uint8_t slot_idx)
   LWB_SET_POLL_FLAG(LWB_POLL_FLAGS_DATA);
   process_poll(&lwb_main_process);
 
+  return LWB_STATUS_SUCCESS;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void process_data_packet(rx_pkt_t* pkt)
+{
+  if (RX_PKT_TYPE(pkt) != LWB_PKT_TYPE_DATA) {
+    return;
+  }
+
+  data_header_t data_hdr;
+  if (read_data_header(pkt->buf, pkt->len, &data_hdr) != LWB_STATUS_SUCCESS) {
+    return;
+  }
+
+  lwb_sched_update_data_slot_usage(pkt->slot_idx, 1);
+
+#if LWB_DYN_SLOT_LEN_ON
+  if (lwb_context.lwb_mode == LWB_MODE_HOST) {
+    lwb_slot_len_add_n_hops(pkt->initiator_id, pkt->n_hops);
+    lwb_slot_len_add_n_hops(pkt->initiator_id, LWB_PKT_APP_DATA_HDR_OPT_GET_N_HOPS(&data_hdr));
+  }
+#endif /* LWB_DYN_SLOT_LEN_ON */
+#if LWB_CHANNEL_SELECT_ON
+  if (lwb_context.lwb_mode == LWB_MODE_HOST) {
+    lwb_channel_add_report(data_hdr.ch_quality);
+  }
+#endif /* LWB_CHANNEL_SELECT_ON */
+
+  if (deliver_data_packet(pkt, &data_hdr) != LWB_STATUS_SUCCESS) {
+    return;
+  }
+
   /* Only the host processes piggybacked stream requests */
   if (lwb_context.lwb_mode == LWB_MODE_HOST
       && LWB_PKT_APP_DATA_HDR_OPT_GET_PKT_TYPE(&data_hdr) == LWB_PKT_TYPE_STREAM_REQ) {
 
-    lwb_stream_req_header_t* str_req_hdr = (lwb_stream_req_header_t*)(LWB_PKT_APP_DATA_PTR()
+#if LWB_COMPACT_HDR_ON
+    iterate_stream_reqs(pkt, pkt->buf[pkt->len - 1], RX_PKT_APP_DATA_PTR(pkt) + data_hdr.data_len);
+#else
+    lwb_stream_req_header_t* str_req_hdr = (lwb_stream_req_header_t*)(RX_PKT_APP_DATA_PTR(pkt)
                                                                       + data_hdr.data_len);
-    iterate_stream_reqs(str_req_hdr);
+    iterate_stream_reqs(pkt, str_req_hdr->n_reqs,
+                        (uint8_t*)str_req_hdr + sizeof(lwb_stream_req_header_t));
+#endif /* LWB_COMPACT_HDR_ON */
   }
 
 }
 
 /*------------------------------------------------------------------------------------------------*/
-static void process_stream_acks()
+static void process_stream_acks(rx_pkt_t* pkt)
 {
-  if (GET_LWB_PKT_TYPE() != LWB_PKT_TYPE_STREAM_ACK) {
+  if (RX_PKT_TYPE(pkt) != LWB_PKT_TYPE_STREAM_ACK) {
     return;
   }
 
-  lwb_stream_ack_header_t* ack_hdr = (lwb_stream_ack_header_t*) LWB_PKT_DATA_PTR();
+  lwb_g_rr_read_stream_acks(RX_PKT_DATA_PTR(pkt), pkt->len - sizeof(lwb_pkt_header_t));
+}
 
-  if (lwb_context.txrx_buf_len < sizeof(lwb_pkt_header_t) + sizeof(lwb_stream_ack_header_t)
-                                 + ack_hdr->n_acks * sizeof(uint16_t)) {
+/*------------------------------------------------------------------------------------------------*/
+static void process_packets_from_host(rx_pkt_t* pkt)
+{
+  if (RX_PKT_TYPE(pkt) == LWB_PKT_TYPE_STREAM_ACK) {
+    process_stream_acks(pkt);
+  }
+#if LWB_HOST_SLOTS_ON
+  process_data_packet(pkt);
+#endif /* LWB_HOST_SLOTS_ON */
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void process_stream_reqs(rx_pkt_t* pkt)
+{
+  if (RX_PKT_TYPE(pkt) != LWB_PKT_TYPE_STREAM_REQ) {
     return;
   }
 
-  LWB_STATS_STREAM_REQ_ACK(n_ack_rx) += ack_hdr->n_acks;
+  if (pkt->len < sizeof(lwb_pkt_header_t) + sizeof(lwb_stream_req_header_t)) {
+    return;
+  }
+
+#if LWB_DYN_SLOT_LEN_ON
+  lwb_slot_len_add_n_hops(pkt->initiator_id, pkt->n_hops);
+#endif /* LWB_DYN_SLOT_LEN_ON */
 
-  uint8_t* acks_ptr = LWB_PKT_DATA_PTR() + sizeof(lwb_stream_ack_header_t);
+  lwb_stream_req_header_t* str_req_hdr = (lwb_stream_req_header_t*)RX_PKT_DATA_PTR(pkt);
+  iterate_stream_reqs(pkt, str_req_hdr->n_reqs,
+                      RX_PKT_DATA_PTR(pkt) + sizeof(lwb_stream_req_header_t));
+
+}
+
+#if LWB_ONESHOT_ON
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Remember the sequence number of a one-shot message
+/// @return 1 if the last message delivered from the sender had the same one, 0 otherwise
+static uint8_t is_oneshot_dup(uint16_t from_id, uint8_t seq)
+{
   uint8_t i;
-  uint16_t ack_node_id;
-  stream_req_lst_item_t* req_item;
-  for (i = 0; i < ack_hdr->n_acks; i++) {
-    ack_node_id = acks_ptr[i * 2] | acks_ptr[i * 2 + 1] << 8;
-    if (ack_node_id == node_id && (req_item = list_head(lst_stream_req))) {
-      list_remove(lst_stream_req, req_item);
-      memb_free(&mmb_stream_req, req_item);
-      stream_reqs_lst_size--;
+  for (i = 0; i < LWB_ONESHOT_N_SOURCES; i++) {
+    if (oneshot_seen[i].node_id == from_id) {
+      if (oneshot_seen[i].seq == seq) {
+        return 1;
+      }
+      oneshot_seen[i].seq = seq;
+      return 0;
     }
   }
 
-  if(stream_reqs_lst_size == 0) {
-    /* Hooray..! we are joined */
-    lwb_context.joining_state = LWB_JOINING_STATE_JOINED;
+  /* Replace the oldest sender */
+  oneshot_seen[oneshot_seen_next].node_id = from_id;
+  oneshot_seen[oneshot_seen_next].seq = seq;
+  oneshot_seen_next = (oneshot_seen_next + 1) % LWB_ONESHOT_N_SOURCES;
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void process_oneshot_packet(rx_pkt_t* pkt)
+{
+  if (RX_PKT_TYPE(pkt) != LWB_PKT_TYPE_ONESHOT) {
+    return;
+  }
+
+  data_header_t data_hdr;
+  if (read_data_header(pkt->buf, pkt->len, &data_hdr) != LWB_STATUS_SUCCESS) {
+    return;
+  }
+
+  LWB_STATS_DATA(n_oneshot_rx)++;
+  if (lwb_context.lwb_mode == LWB_MODE_HOST) {
+    /* Confirm the message with the next stream acknowledgements, whoever it is for */
+    uint8_t i;
+    for (i = 0; i < lwb_context.n_oneshot_acks
+                && lwb_context.oneshot_acks[i] != pkt->initiator_id; i++);
+    if (i == lwb_context.n_oneshot_acks && i < LWB_ONESHOT_N_ACKS) {
+      lwb_context.oneshot_acks[lwb_context.n_oneshot_acks++] = pkt->initiator_id;
+    }
+
+#if LWB_DYN_SLOT_LEN_ON
+    lwb_slot_len_add_n_hops(pkt->initiator_id, pkt->n_hops);
+#endif /* LWB_DYN_SLOT_LEN_ON */
+
+    if (LWB_PKT_APP_DATA_HDR_OPT_GET_PKT_TYPE(&data_hdr) == LWB_PKT_TYPE_STREAM_REQ) {
+#if LWB_COMPACT_HDR_ON
+      iterate_stream_reqs(pkt, pkt->buf[pkt->len - 1],
+                          RX_PKT_APP_DATA_PTR(pkt) + data_hdr.data_len);
+#else
+      lwb_stream_req_header_t* str_req_hdr = (lwb_stream_req_header_t*)(RX_PKT_APP_DATA_PTR(pkt)
+                                                                        + data_hdr.data_len);
+      iterate_stream_reqs(pkt, str_req_hdr->n_reqs,
+                          (uint8_t*)str_req_hdr + sizeof(lwb_stream_req_header_t));
+#endif /* LWB_COMPACT_HDR_ON */
+    }
+  }
+
+  /* The source sends the message again if it misses the acknowledgement. It has been confirmed
+   * above, but the application gets it only once.
+   */
+  if (is_oneshot_dup(pkt->initiator_id, LWB_PKT_APP_DATA_HDR_OPT_GET_ONESHOT_SEQ(&data_hdr))) {
+    LWB_STATS_DATA(n_oneshot_dup)++;
+    return;
+  }
+
+  deliver_data_packet(pkt, &data_hdr);
+}
+#endif /* LWB_ONESHOT_ON */
+
+/*------------------------------------------------------------------------------------------------*/
+static void process_rx_pkt(rx_pkt_t* pkt)
+{
+  switch (pkt->handler) {
+    case RX_HANDLER_DATA:
+      process_data_packet(pkt);
+      break;
+    case RX_HANDLER_FROM_HOST:
+      process_packets_from_host(pkt);
+      break;
+    case RX_HANDLER_STREAM_REQ:
+      if (lwb_context.lwb_mode == LWB_MODE_HOST) {
+        process_stream_reqs(pkt);
+      }
+#if LWB_ONESHOT_ON
+      process_oneshot_packet(pkt);
+#endif /* LWB_ONESHOT_ON */
+      break;
+    default:
+      break;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Take the packet received by the last flood in the current slot. It is processed right
+///        away or, with deferred processing, during the next flood or at the end of the round.
+static void handle_rx_pkt(uint8_t handler)
+{
+#if LWB_DEFERRED_RX_ON
+  rx_pkt_t* pkt = &rx_pkts[(rx_head + rx_n) % LWB_DEFERRED_RX_N_BUFS];
+  rx_n++;
+#else
+  rx_pkt_t rx_pkt;
+  rx_pkt_t* pkt = &rx_pkt;
+  pkt->buf = lwb_context.txrx_buf;
+  lwb_context.txrx_buf_len = glossy_get_payload_len();
+#endif /* LWB_DEFERRED_RX_ON */
+
+  pkt->len = glossy_get_payload_len();
+  pkt->initiator_id = glossy_get_initiator_id();
+  pkt->n_hops = glossy_get_n_hops();
+  pkt->slot_idx = slot_idx;
+  pkt->handler = handler;
+#if LWB_NET_TIME_ON
+  pkt->t_slot = T_SLOT_MEASURED(T_SLOT_START());
+#endif /* LWB_NET_TIME_ON */
+
+#if !LWB_DEFERRED_RX_ON
+  process_rx_pkt(pkt);
+#endif /* !LWB_DEFERRED_RX_ON */
+}
+
+#if LWB_DEFERRED_RX_ON
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Process the stashed packets. Called while Glossy is flooding or after the last slot.
+static void process_deferred_rx_pkts(void)
+{
+  while (rx_n > 0) {
+    process_rx_pkt(&rx_pkts[rx_head]);
+    rx_head = (rx_head + 1) % LWB_DEFERRED_RX_N_BUFS;
+    rx_n--;
   }
 }
 
 /*------------------------------------------------------------------------------------------------*/
-static void process_packets_from_host(void)
+/// @brief Get the buffer the next flood is received into. It is never one holding a stashed packet.
+static uint8_t* get_rx_buf(void)
 {
-  if (GET_LWB_PKT_TYPE() == LWB_PKT_TYPE_STREAM_ACK) {
-    process_stream_acks();
+  if (rx_n == LWB_DEFERRED_RX_N_BUFS) {
+    /* All buffers are in use. This only happens if less than two buffers are configured */
+    process_deferred_rx_pkts();
   }
+  return rx_pkts[(rx_head + rx_n) % LWB_DEFERRED_RX_N_BUFS].buf;
+}
+#endif /* LWB_DEFERRED_RX_ON */
+
+#if LWB_EVENT_SLOT_ON
+/*------------------------------------------------------------------------------------------------*/
+static void prepare_event_packet()
+{
+  data_buf_lst_item_t* buf_item = list_head(lst_event_queue);
+
+  SET_LWB_PKT_TYPE(LWB_PKT_TYPE_EVENT);
+  /* The event stays in the queue until the host acknowledges it */
+  buf_item->buf.header.in_queue = event_q_size - 1;
+#if LWB_CHANNEL_SELECT_ON
+  buf_item->buf.header.ch_quality = lwb_channel_get_quality();
+#endif /* LWB_CHANNEL_SELECT_ON */
+  write_data_header(&(buf_item->buf.header));
+  memcpy(LWB_PKT_APP_DATA_PTR(), buf_item->buf.data, buf_item->buf.header.data_len);
+  lwb_context.txrx_buf_len = sizeof(lwb_pkt_header_t) + sizeof(data_air_header_t)
+                             + buf_item->buf.header.data_len;
+
+  LWB_STATS_DATA(n_event_tx)++;
 }
 
 /*------------------------------------------------------------------------------------------------*/
-static void process_stream_reqs(uint8_t slot_idx)
+static void prepare_event_ack()
 {
-  if (GET_LWB_PKT_TYPE() != LWB_PKT_TYPE_STREAM_REQ) {
+  uint8_t* ack_ptr = LWB_PKT_DATA_PTR();
+
+  SET_LWB_PKT_TYPE(LWB_PKT_TYPE_EVENT_ACK);
+  ack_ptr[0] = event_winner & 0xff;
+  ack_ptr[1] = event_winner >> 8;
+  lwb_context.txrx_buf_len = EVENT_ACK_LEN;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void process_event_packet()
+{
+  rx_pkt_t pkt;
+
+  lwb_context.txrx_buf_len = glossy_get_payload_len();
+  if (GET_LWB_PKT_TYPE() != LWB_PKT_TYPE_EVENT) {
     return;
   }
 
-  if (lwb_context.txrx_buf_len < sizeof(lwb_pkt_header_t) + sizeof(lwb_stream_req_header_t)) {
+  data_header_t data_hdr;
+  if (read_data_header(lwb_context.txrx_buf, lwb_context.txrx_buf_len, &data_hdr)
+      != LWB_STATUS_SUCCESS) {
     return;
   }
 
-  lwb_stream_req_header_t* str_req_hdr = (lwb_stream_req_header_t*)LWB_PKT_DATA_PTR();
-  iterate_stream_reqs(str_req_hdr);
+  /* Events are processed right away as the host has to acknowledge them in the same slot */
+  pkt.buf = lwb_context.txrx_buf;
+  pkt.len = lwb_context.txrx_buf_len;
+  pkt.initiator_id = glossy_get_initiator_id();
+#if LWB_NET_TIME_ON
+  pkt.t_slot = T_SLOT_MEASURED(t_event);
+#endif /* LWB_NET_TIME_ON */
+
+  if (lwb_context.lwb_mode == LWB_MODE_HOST) {
+    /* The capture effect decided the winner of this slot. Acknowledge it and give the rest of the
+     * contenders more event slots if the winner tells us that it has more to send.
+     */
+    event_winner = pkt.initiator_id;
+    if (data_hdr.in_queue > 0) {
+      events_pending = 1;
+    }
+  }
+
+  LWB_STATS_DATA(n_event_rx)++;
+  deliver_data_packet(&pkt, &data_hdr);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static uint8_t process_event_ack()
+{
+  if (GET_LWB_PKT_TYPE() != LWB_PKT_TYPE_EVENT_ACK
+      || lwb_context.txrx_buf_len < sizeof(lwb_pkt_header_t) + sizeof(uint16_t)) {
+    return 0;
+  }
+
+  uint8_t* ack_ptr = LWB_PKT_DATA_PTR();
+  return (ack_ptr[0] | ack_ptr[1] << 8) == node_id;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static inline uint16_t get_n_rx_errs()
+{
+  glossy_get_stats(&event_g_stats);
+  return event_g_stats.bad_crc + event_g_stats.bad_g_header + event_g_stats.payload_mismatch;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static PT_THREAD(lwb_g_rr_event_host(struct rtimer *rt, pt_state_t* pt_state))
+{
+  PT_BEGIN(pt_state->pt);
+
+  event_winner = 0;
+  event_n_rx_errs = get_n_rx_errs();
+
+  /* Any node may initiate a flood in the event slot. Wake up early */
+  lwb_save_energest();
+  LWB_WAIT_UNTIL(t_event - T_GUARD);
+  GLOSSY_SET_SLOT_START(t_event, GLOSSY_UNKNOWN_PAYLOAD_LEN);
+  glossy_start(GLOSSY_UNKNOWN_INITIATOR, lwb_context.txrx_buf, GLOSSY_UNKNOWN_PAYLOAD_LEN, N_EVENT,
+               GLOSSY_ONLY_RELAY_CNT);
+  LWB_WAIT_UNTIL(t_event + T_EVENT_ON + T_GUARD);
+  glossy_stop();
+  lwb_update_ctrl_energest();
+
+  if (glossy_get_n_rx() > 0) {
+    process_event_packet();
+  }
+
+  if (get_n_rx_errs() != event_n_rx_errs) {
+    /* Corrupted receptions in the event slot indicate that several nodes contended for it */
+    events_pending = 1;
+  }
+
+  if (event_winner) {
+    prepare_event_ack();
+    lwb_save_energest();
+    LWB_WAIT_UNTIL(t_event + T_EVENT_ON + T_GAP);
+    GLOSSY_SET_SLOT_START(t_event + T_EVENT_ON + T_GAP, lwb_context.txrx_buf_len);
+    glossy_start(node_id, lwb_context.txrx_buf, lwb_context.txrx_buf_len, N_EVENT,
+                 GLOSSY_ONLY_RELAY_CNT);
+    LWB_WAIT_UNTIL(t_event + T_EVENT_ON + T_GAP + T_EVENT_ACK_ON);
+    glossy_stop();
+    lwb_update_ctrl_energest();
+  }
+
+  PT_END(pt_state->pt);
+  return PT_ENDED;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static PT_THREAD(lwb_g_rr_event_source(struct rtimer *rt, pt_state_t* pt_state))
+{
+  PT_BEGIN(pt_state->pt);
+
+  event_sent = 0;
+
+  lwb_save_energest();
+  if (event_q_size > 0 && n_event_slots_to_wait == 0) {
+    /* Contend for the slot. Other contenders are resolved by the capture effect */
+    LWB_WAIT_UNTIL(t_event);
+    prepare_event_packet();
+    event_sent = 1;
+    GLOSSY_SET_SLOT_START(t_event, lwb_context.txrx_buf_len);
+    glossy_start(node_id, lwb_context.txrx_buf, lwb_context.txrx_buf_len, N_EVENT,
+                 GLOSSY_ONLY_RELAY_CNT);
+    LWB_WAIT_UNTIL(t_event + T_EVENT_ON);
+    glossy_stop();
+  } else {
+    if (n_event_slots_to_wait > 0) {
+      n_event_slots_to_wait--;
+    }
+    /* Just participate to the flooding. Wake up early */
+    LWB_WAIT_UNTIL(t_event - T_GUARD);
+    GLOSSY_SET_SLOT_START(t_event, GLOSSY_UNKNOWN_PAYLOAD_LEN);
+    glossy_start(GLOSSY_UNKNOWN_INITIATOR, lwb_context.txrx_buf, GLOSSY_UNKNOWN_PAYLOAD_LEN, N_EVENT,
+                 GLOSSY_ONLY_RELAY_CNT);
+    LWB_WAIT_UNTIL(t_event + T_EVENT_ON + T_GUARD);
+    glossy_stop();
+  }
+  lwb_update_ctrl_energest();
+
+  /* The host only acknowledges when an event was received. Nodes that neither sent nor received an
+   * event in this slot skip the acknowledgement slot.
+   */
+  if (event_sent || glossy_get_n_rx() > 0) {
+
+    if (!event_sent) {
+      process_event_packet();
+    }
+
+    lwb_save_energest();
+    LWB_WAIT_UNTIL(t_event + T_EVENT_ON + T_GAP - T_GUARD);
+    GLOSSY_SET_SLOT_START(t_event + T_EVENT_ON + T_GAP, EVENT_ACK_LEN);
+    glossy_start(GLOSSY_UNKNOWN_INITIATOR, lwb_context.txrx_buf, GLOSSY_UNKNOWN_PAYLOAD_LEN, N_EVENT,
+                 GLOSSY_ONLY_RELAY_CNT);
+    LWB_WAIT_UNTIL(t_event + T_EVENT_ON + T_GAP + T_EVENT_ACK_ON + T_GUARD);
+    glossy_stop();
+    lwb_update_ctrl_energest();
+
+    if (event_sent) {
+      lwb_context.txrx_buf_len = glossy_get_payload_len();
+      if (glossy_get_n_rx() > 0 && process_event_ack()) {
+        data_buf_lst_item_t* buf_item = list_pop(lst_event_queue);
+        memb_free(&mmb_data_buf, buf_item);
+        event_q_size--;
+        n_event_trials = 0;
+        LWB_STATS_DATA(n_event_acked)++;
+      } else {
+        /* We lost the slot. Back off for a few event slots */
+        if (n_event_trials < LWB_EVENT_MAX_BACKOFF_EXP) {
+          n_event_trials++;
+        }
+        n_event_slots_to_wait = (uint8_t)random_rand() % (1 << n_event_trials);
+      }
+    }
+  }
 
+  PT_END(pt_state->pt);
+  return PT_ENDED;
 }
+#endif /* LWB_EVENT_SLOT_ON */
+
 /*------------------------------------------------------------------------------------------------*/
 PT_THREAD(lwb_g_rr_host(struct rtimer *rt, pt_state_t* pt_state, uint8_t idx_start))
 {
   PT_BEGIN(pt_state->pt);
 
+  t_sync_len = T_SYNC_LEN(CURRENT_SCHEDULE_INFO());
+  t_rr_len = T_RR_LEN(CURRENT_SCHEDULE_INFO());
+  t_slot_ofs = idx_start * (t_rr_len + T_GAP);
+
+#if LWB_EVENT_SLOT_ON
+  events_pending = 0;
+  pt_state_event.cb = pt_state->cb;
+  if (N_CURRENT_EVENT_SLOTS() > 0) {
+    /* The event slot precedes the data slots */
+    t_event = T_SLOT_START();
+    PT_SPAWN(pt_state->pt, pt_state_event.pt, lwb_g_rr_event_host(rt, &pt_state_event));
+    t_slot_ofs += T_EVENT_SLOT_LEN;
+  }
+#endif /* LWB_EVENT_SLOT_ON */
+
   lwb_reset_slot_energest();
   /* Loop for data and ACK slots */
   for (slot_idx = 0; slot_idx < N_CURRENT_DATA_SLOTS(); slot_idx++) {
 
+    t_rr_len = T_DATA_SLOT_LEN(CURRENT_SCHEDULE(), slot_idx);
+    n_tx_slot = N_TX_DATA_SLOT(CURRENT_SCHEDULE(), slot_idx);
     lwb_save_energest();
 
     if (CURRENT_SCHEDULE().slots[slot_idx] == 0) {
-      /* We have stream acknowledgement(s) to be sent. */
-      LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                     + T_SYNC_ON
-                     + T_S_R_GAP
-                     + (idx_start + slot_idx) * (T_RR_ON + T_GAP));
+      /* We have stream acknowledgement(s) or, with host slots, own packets to be sent. */
+      LWB_WAIT_UNTIL(T_SLOT_START());
 
       if (prepare_packets_from_host()) {
-        glossy_start(node_id, lwb_context.txrx_buf, lwb_context.txrx_buf_len, N_RR,
+        GLOSSY_SET_SLOT_START(T_SLOT_START(), lwb_context.txrx_buf_len);
+        glossy_start(node_id, lwb_context.txrx_buf, lwb_context.txrx_buf_len, n_tx_slot,
                      GLOSSY_ONLY_RELAY_CNT);
-        LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                       + T_SYNC_ON
-                       + T_S_R_GAP
-                       + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                       + T_RR_ON);
+        PROCESS_DEFERRED_RX();
+        LWB_WAIT_UNTIL(T_SLOT_START() + t_rr_len);
         glossy_stop();
         lwb_update_ctrl_energest();
       } else {
         /* No stream AKCs */
       }
 
-    } else if (CURRENT_SCHEDULE().slots[slot_idx] == node_id) {
+    } else if (LWB_IS_MY_SLOT(CURRENT_SCHEDULE().slots[slot_idx])) {
       /* This is our slot. Send data if we have */
-      LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                     + T_SYNC_ON
-                     + T_S_R_GAP
-                     + (idx_start + slot_idx) * (T_RR_ON + T_GAP));
+      LWB_WAIT_UNTIL(T_SLOT_START());
 
       if (tx_buf_q_size > 0) {
-        prepare_data_packet();
-        glossy_start(node_id, lwb_context.txrx_buf, lwb_context.txrx_buf_len, N_RR,
+        prepare_data_packet(SLOT_APP_DATA_LEN_MAX());
+        GLOSSY_SET_SLOT_START(T_SLOT_START(), lwb_context.txrx_buf_len);
+        glossy_start(node_id, lwb_context.txrx_buf, lwb_context.txrx_buf_len, n_tx_slot,
                      GLOSSY_ONLY_RELAY_CNT);
-        LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                       + T_SYNC_ON
-                       + T_S_R_GAP
-                       + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                       + T_RR_ON);
+        PROCESS_DEFERRED_RX();
+        LWB_WAIT_UNTIL(T_SLOT_START() + t_rr_len);
         glossy_stop();
       } else {
         /* We have nothing to send. Stay silent */
@@ -407,24 +1047,16 @@ PT_THREAD(lwb_g_rr_host(struct rtimer *rt, pt_state_t* pt_state, uint8_t idx_sta
 
     } else {
       /* Not our slot. Just participate to the flooding. Wake up early */
-      LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                     + T_SYNC_ON
-                     + T_S_R_GAP
-                     + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                     - T_GUARD);
-      glossy_start(GLOSSY_UNKNOWN_INITIATOR, lwb_context.txrx_buf, GLOSSY_UNKNOWN_PAYLOAD_LEN, N_RR,
+      LWB_WAIT_UNTIL(T_SLOT_START() - T_GUARD);
+      GLOSSY_SET_SLOT_START(T_SLOT_START(), GLOSSY_UNKNOWN_PAYLOAD_LEN);
+      glossy_start(GLOSSY_UNKNOWN_INITIATOR, RX_BUF(), GLOSSY_UNKNOWN_PAYLOAD_LEN, n_tx_slot,
                    GLOSSY_ONLY_RELAY_CNT);
-      LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                     + T_SYNC_ON
-                     + T_S_R_GAP
-                     + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                     + T_RR_ON
-                     + T_GUARD);
+      PROCESS_DEFERRED_RX();
+      LWB_WAIT_UNTIL(T_SLOT_START() + t_rr_len + T_GUARD);
       glossy_stop();
 
       if (glossy_get_n_rx() > 0) {
-        lwb_context.txrx_buf_len = glossy_get_payload_len();
-        process_data_packet(slot_idx);
+        handle_rx_pkt(RX_HANDLER_DATA);
       } else {
         /* Nothing received */
         lwb_sched_update_data_slot_usage(slot_idx, 0);
@@ -433,38 +1065,44 @@ PT_THREAD(lwb_g_rr_host(struct rtimer *rt, pt_state_t* pt_state, uint8_t idx_sta
     }
 
     lwb_update_slot_energest();
+    t_slot_ofs += t_rr_len + T_GAP;
   }
 
   lwb_save_energest();
-  /* Loop for contention slots */
+  /* Loop for contention slots. They always have the maximum length since joining nodes are not
+   * covered by the diameter estimate.
+   */
   for (;slot_idx < N_CURRENT_DATA_SLOTS() + N_CURRENT_FREE_SLOTS(); slot_idx++) {
 
     /* Wake up early */
-    LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                   + T_SYNC_ON
-                   + T_S_R_GAP
-                   + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                   - T_GUARD);
+    LWB_WAIT_UNTIL(T_SLOT_START() - T_GUARD);
 
-    glossy_start(GLOSSY_UNKNOWN_INITIATOR, lwb_context.txrx_buf, GLOSSY_UNKNOWN_PAYLOAD_LEN, N_RR,
+    GLOSSY_SET_SLOT_START(T_SLOT_START(), GLOSSY_UNKNOWN_PAYLOAD_LEN);
+    glossy_start(GLOSSY_UNKNOWN_INITIATOR, RX_BUF(), GLOSSY_UNKNOWN_PAYLOAD_LEN, N_RR,
                  GLOSSY_ONLY_RELAY_CNT);
-    LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                   + T_SYNC_ON
-                   + T_S_R_GAP
-                   + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                   + T_RR_ON
-                   + T_GUARD);
+    PROCESS_DEFERRED_RX();
+    LWB_WAIT_UNTIL(T_SLOT_START() + T_RR_ON + T_GUARD);
     glossy_stop();
 
     if (glossy_get_n_rx() > 0) {
-      lwb_context.txrx_buf_len = glossy_get_payload_len();
-      process_stream_reqs(slot_idx);
+      handle_rx_pkt(RX_HANDLER_STREAM_REQ);
     } else {
       /* Nothing received */
     }
+    t_slot_ofs += T_RR_ON + T_GAP;
   }
+  /* Whatever was received in the last slots is processed now */
+  PROCESS_DEFERRED_RX();
   lwb_update_ctrl_energest();
 
+#if LWB_EVENT_SLOT_ON
+  /* Fast event slots follow the contention slots while events are pending */
+  for (event_idx = 1; event_idx < N_CURRENT_EVENT_SLOTS(); event_idx++) {
+    t_event = T_SLOT_START() + (event_idx - 1) * T_EVENT_FAST_PERIOD;
+    PT_SPAWN(pt_state->pt, pt_state_event.pt, lwb_g_rr_event_host(rt, &pt_state_event));
+  }
+#endif /* LWB_EVENT_SLOT_ON */
+
   PT_END(pt_state->pt);
 
   return PT_ENDED;
@@ -475,51 +1113,54 @@ PT_THREAD(lwb_g_rr_source(struct rtimer *rt, pt_state_t* pt_state, uint8_t idx_s
 {
   PT_BEGIN(pt_state->pt);
 
+  t_sync_len = T_SYNC_LEN(CURRENT_SCHEDULE_INFO());
+  t_rr_len = T_RR_LEN(CURRENT_SCHEDULE_INFO());
+  t_slot_ofs = idx_start * (t_rr_len + T_GAP);
+
+#if LWB_EVENT_SLOT_ON
+  pt_state_event.cb = pt_state->cb;
+  if (N_CURRENT_EVENT_SLOTS() > 0) {
+    /* The event slot precedes the data slots */
+    t_event = T_SLOT_START();
+    PT_SPAWN(pt_state->pt, pt_state_event.pt, lwb_g_rr_event_source(rt, &pt_state_event));
+    t_slot_ofs += T_EVENT_SLOT_LEN;
+  }
+#endif /* LWB_EVENT_SLOT_ON */
+
   lwb_reset_slot_energest();
   /* Loop for data and ACK slots */
   for (slot_idx = 0; slot_idx < N_CURRENT_DATA_SLOTS(); slot_idx++) {
 
+    t_rr_len = T_DATA_SLOT_LEN(CURRENT_SCHEDULE(), slot_idx);
+    n_tx_slot = N_TX_DATA_SLOT(CURRENT_SCHEDULE(), slot_idx);
     lwb_save_energest();
 
     if (CURRENT_SCHEDULE().slots[slot_idx] == 0) {
-      /* We have stream acknowledgement(s) to be received. Wake up early */
-      LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                     + T_SYNC_ON
-                     + T_S_R_GAP
-                     + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                     - T_GUARD);
-      glossy_start(GLOSSY_UNKNOWN_INITIATOR, lwb_context.txrx_buf, GLOSSY_UNKNOWN_PAYLOAD_LEN, N_RR,
+      /* We have stream acknowledgement(s) or packets of the host to be received. Wake up early */
+      LWB_WAIT_UNTIL(T_SLOT_START() - T_GUARD);
+      GLOSSY_SET_SLOT_START(T_SLOT_START(), GLOSSY_UNKNOWN_PAYLOAD_LEN);
+      glossy_start(GLOSSY_UNKNOWN_INITIATOR, RX_BUF(), GLOSSY_UNKNOWN_PAYLOAD_LEN, n_tx_slot,
                    GLOSSY_ONLY_RELAY_CNT);
-      LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                     + T_SYNC_ON
-                     + T_S_R_GAP
-                     + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                     + T_RR_ON
-                     + T_GUARD);
+      PROCESS_DEFERRED_RX();
+      LWB_WAIT_UNTIL(T_SLOT_START() + t_rr_len + T_GUARD);
       glossy_stop();
       lwb_update_ctrl_energest();
 
       if (glossy_get_n_rx() > 0) {
-        lwb_context.txrx_buf_len = glossy_get_payload_len();
-        process_packets_from_host();
+        handle_rx_pkt(RX_HANDLER_FROM_HOST);
       }
 
-    } else if (CURRENT_SCHEDULE().slots[slot_idx] == node_id) {
+    } else if (LWB_IS_MY_SLOT(CURRENT_SCHEDULE().slots[slot_idx])) {
       /* This is our slot. Send data if we have */
-      LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                     + T_SYNC_ON
-                     + T_S_R_GAP
-                     + (idx_start + slot_idx) * (T_RR_ON + T_GAP));
+      LWB_WAIT_UNTIL(T_SLOT_START());
 
       if (tx_buf_q_size > 0) {
-        prepare_data_packet();
-        glossy_start(node_id, lwb_context.txrx_buf, lwb_context.txrx_buf_len, N_RR,
+        prepare_data_packet(SLOT_APP_DATA_LEN_MAX());
+        GLOSSY_SET_SLOT_START(T_SLOT_START(), lwb_context.txrx_buf_len);
+        glossy_start(node_id, lwb_context.txrx_buf, lwb_context.txrx_buf_len, n_tx_slot,
                      GLOSSY_ONLY_RELAY_CNT);
-        LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                       + T_SYNC_ON
-                       + T_S_R_GAP
-                       + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                       + T_RR_ON);
+        PROCESS_DEFERRED_RX();
+        LWB_WAIT_UNTIL(T_SLOT_START() + t_rr_len);
         glossy_stop();
       } else {
         /* We have nothing to send. Stay silent */
@@ -527,50 +1168,52 @@ PT_THREAD(lwb_g_rr_source(struct rtimer *rt, pt_state_t* pt_state, uint8_t idx_s
 
     } else {
       /* Not our slot. Just participate to the flooding. Wake up early. */
-      LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                     + T_SYNC_ON
-                     + T_S_R_GAP
-                     + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                     - T_GUARD);
-      glossy_start(GLOSSY_UNKNOWN_INITIATOR, lwb_context.txrx_buf, GLOSSY_UNKNOWN_PAYLOAD_LEN, N_RR,
+      LWB_WAIT_UNTIL(T_SLOT_START() - T_GUARD);
+      GLOSSY_SET_SLOT_START(T_SLOT_START(), GLOSSY_UNKNOWN_PAYLOAD_LEN);
+      glossy_start(GLOSSY_UNKNOWN_INITIATOR, RX_BUF(), GLOSSY_UNKNOWN_PAYLOAD_LEN, n_tx_slot,
                    GLOSSY_ONLY_RELAY_CNT);
-      LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                     + T_SYNC_ON
-                     + T_S_R_GAP
-                     + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                     + T_RR_ON
-                     + T_GUARD);
+      PROCESS_DEFERRED_RX();
+      LWB_WAIT_UNTIL(T_SLOT_START() + t_rr_len + T_GUARD);
       glossy_stop();
 
       if (glossy_get_n_rx() > 0) {
-        lwb_context.txrx_buf_len = glossy_get_payload_len();
-        process_data_packet(slot_idx);
+        handle_rx_pkt(RX_HANDLER_DATA);
       } else {
         /* Nothing received */
       }
     }
     lwb_update_slot_energest();
+    t_slot_ofs += t_rr_len + T_GAP;
   }
 
   lwb_save_energest();
-  /* Loop for contention slots */
+  /* Loop for contention slots. They always have the maximum length since joining nodes are not
+   * covered by the diameter estimate.
+   */
   for (;slot_idx < N_CURRENT_DATA_SLOTS() + N_CURRENT_FREE_SLOTS(); slot_idx++) {
 
-    LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                   + T_SYNC_ON
-                   + T_S_R_GAP
-                   + (idx_start + slot_idx) * (T_RR_ON + T_GAP));
+    LWB_WAIT_UNTIL(T_SLOT_START());
 
+#if LWB_ONESHOT_ON
+    if (stream_reqs_lst_size > 0 || oneshot_q_size > 0) {
+#else
     if (stream_reqs_lst_size > 0) {
+#endif /* LWB_ONESHOT_ON */
       if (n_rounds_to_wait == 0) {
+#if LWB_ONESHOT_ON
+        if (oneshot_q_size > 0) {
+          prepare_oneshot_packet();
+        } else {
+          prepare_stream_reqs();
+        }
+#else
         prepare_stream_reqs();
+#endif /* LWB_ONESHOT_ON */
+        GLOSSY_SET_SLOT_START(T_SLOT_START(), lwb_context.txrx_buf_len);
         glossy_start(node_id, lwb_context.txrx_buf, lwb_context.txrx_buf_len, N_RR,
                      GLOSSY_ONLY_RELAY_CNT);
-        LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                       + T_SYNC_ON
-                       + T_S_R_GAP
-                       + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                       + T_RR_ON);
+        PROCESS_DEFERRED_RX();
+        LWB_WAIT_UNTIL(T_SLOT_START() + T_RR_ON);
         glossy_stop();
         n_trials++;
         /* Calculate the number of trials to wait before trying again */
@@ -578,41 +1221,228 @@ PT_THREAD(lwb_g_rr_source(struct rtimer *rt, pt_state_t* pt_state, uint8_t idx_s
 
       } else {
         /* We just participate to the flooding */
-        glossy_start(GLOSSY_UNKNOWN_INITIATOR, lwb_context.txrx_buf, GLOSSY_UNKNOWN_PAYLOAD_LEN, N_RR,
+        GLOSSY_SET_SLOT_START(T_SLOT_START(), GLOSSY_UNKNOWN_PAYLOAD_LEN);
+        glossy_start(GLOSSY_UNKNOWN_INITIATOR, RX_BUF(), GLOSSY_UNKNOWN_PAYLOAD_LEN, N_RR,
                      GLOSSY_ONLY_RELAY_CNT);
-        LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                       + T_SYNC_ON
-                       + T_S_R_GAP
-                       + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                       + T_RR_ON);
+        PROCESS_DEFERRED_RX();
+        LWB_WAIT_UNTIL(T_SLOT_START() + T_RR_ON);
         glossy_stop();
         n_rounds_to_wait--;
+#if LWB_ONESHOT_ON
+        if (glossy_get_n_rx() > 0) {
+          /* It may be a one-shot message for us */
+          handle_rx_pkt(RX_HANDLER_STREAM_REQ);
+        }
+#endif /* LWB_ONESHOT_ON */
       }
 
     } else {
       /* We just participate to the flooding */
-      glossy_start(GLOSSY_UNKNOWN_INITIATOR, lwb_context.txrx_buf, GLOSSY_UNKNOWN_PAYLOAD_LEN, N_RR,
+      GLOSSY_SET_SLOT_START(T_SLOT_START(), GLOSSY_UNKNOWN_PAYLOAD_LEN);
+      glossy_start(GLOSSY_UNKNOWN_INITIATOR, RX_BUF(), GLOSSY_UNKNOWN_PAYLOAD_LEN, N_RR,
                    GLOSSY_ONLY_RELAY_CNT);
-      LWB_WAIT_UNTIL(lwb_context.t_sync_ref
-                     + T_SYNC_ON
-                     + T_S_R_GAP
-                     + (idx_start + slot_idx) * (T_RR_ON + T_GAP)
-                     + T_RR_ON);
+      PROCESS_DEFERRED_RX();
+      LWB_WAIT_UNTIL(T_SLOT_START() + T_RR_ON);
       glossy_stop();
+#if LWB_ONESHOT_ON
+      if (glossy_get_n_rx() > 0) {
+        /* It may be a one-shot message for us */
+        handle_rx_pkt(RX_HANDLER_STREAM_REQ);
+      }
+#endif /* LWB_ONESHOT_ON */
     }
+    t_slot_ofs += T_RR_ON + T_GAP;
   }
+  /* Whatever was received in the last slots is processed now */
+  PROCESS_DEFERRED_RX();
   lwb_update_ctrl_energest();
 
+#if LWB_EVENT_SLOT_ON
+  /* Fast event slots follow the contention slots while events are pending */
+  for (event_idx = 1; event_idx < N_CURRENT_EVENT_SLOTS(); event_idx++) {
+    t_event = T_SLOT_START() + (event_idx - 1) * T_EVENT_FAST_PERIOD;
+    PT_SPAWN(pt_state->pt, pt_state_event.pt, lwb_g_rr_event_source(rt, &pt_state_event));
+  }
+#endif /* LWB_EVENT_SLOT_ON */
+
   PT_END(pt_state->pt);
   return PT_ENDED;
 }
 
+#if LWB_HOST_SLOTS_ON
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_g_rr_get_tx_q_size()
+{
+  return tx_buf_q_size;
+}
+#endif /* LWB_HOST_SLOTS_ON */
+
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_g_rr_get_stream_acks_len()
+{
+#if LWB_ONESHOT_ON
+  /* The one-shot acknowledgements follow, preceded by their number */
+  return sizeof(lwb_stream_ack_header_t) + lwb_context.n_stream_acks * STREAM_ACK_LEN
+         + 1 + lwb_context.n_oneshot_acks * sizeof(uint16_t);
+#else
+  return sizeof(lwb_stream_ack_header_t) + lwb_context.n_stream_acks * STREAM_ACK_LEN;
+#endif /* LWB_ONESHOT_ON */
+}
+
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_g_rr_write_stream_acks(uint8_t* buf)
+{
+  uint8_t len = lwb_g_rr_get_stream_acks_len();
+  lwb_stream_ack_header_t* ack_header = (lwb_stream_ack_header_t*) buf;
+  ack_header->n_acks = lwb_context.n_stream_acks;
+
+  memcpy(buf + sizeof(lwb_stream_ack_header_t), lwb_context.stream_akcs,
+         2 * lwb_context.n_stream_acks);
+#if LWB_SHORT_ADDR_ON
+  /* The short addresses of the acknowledged nodes follow their IDs */
+  memcpy(buf + sizeof(lwb_stream_ack_header_t) + 2 * lwb_context.n_stream_acks,
+         lwb_context.stream_ack_addrs, lwb_context.n_stream_acks);
+#endif /* LWB_SHORT_ADDR_ON */
+#if LWB_SCHED_ADMISSION_ON
+  /* The stream IDs and results follow */
+  memcpy(buf + sizeof(lwb_stream_ack_header_t) + (STREAM_ACK_LEN - 1) * lwb_context.n_stream_acks,
+         lwb_context.stream_ack_results, lwb_context.n_stream_acks);
+#endif /* LWB_SCHED_ADMISSION_ON */
+#if LWB_ONESHOT_ON
+  uint8_t* oneshot_ptr = buf + sizeof(lwb_stream_ack_header_t)
+                         + STREAM_ACK_LEN * lwb_context.n_stream_acks;
+  oneshot_ptr[0] = lwb_context.n_oneshot_acks;
+  memcpy(oneshot_ptr + 1, lwb_context.oneshot_acks, sizeof(uint16_t) * lwb_context.n_oneshot_acks);
+  lwb_context.n_oneshot_acks = 0;
+#endif /* LWB_ONESHOT_ON */
+
+  LWB_STATS_STREAM_REQ_ACK(n_ack_tx) += lwb_context.n_stream_acks;
+
+  lwb_context.n_stream_acks = 0;
+  return len;
+}
+
+#if LWB_STREAM_REQ_COALESCE_ON || LWB_SCHED_ADMISSION_ON
+/*------------------------------------------------------------------------------------------------*/
+static stream_req_lst_item_t* find_stream_req(uint8_t id)
+{
+  stream_req_lst_item_t* p_req_item;
+  for (p_req_item = list_head(lst_stream_req); p_req_item != NULL; p_req_item = p_req_item->next) {
+    if (LWB_GET_STREAM_ID(p_req_item->req.req_type) == id) {
+      return p_req_item;
+    }
+  }
+  return NULL;
+}
+#endif /* LWB_STREAM_REQ_COALESCE_ON || LWB_SCHED_ADMISSION_ON */
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_g_rr_read_stream_acks(uint8_t* buf, uint8_t len)
+{
+  lwb_stream_ack_header_t* ack_hdr = (lwb_stream_ack_header_t*) buf;
+
+  if (len < sizeof(lwb_stream_ack_header_t)
+      || len < sizeof(lwb_stream_ack_header_t) + ack_hdr->n_acks * STREAM_ACK_LEN) {
+    return;
+  }
+
+  LWB_STATS_STREAM_REQ_ACK(n_ack_rx) += ack_hdr->n_acks;
+
+  uint8_t* acks_ptr = buf + sizeof(lwb_stream_ack_header_t);
+  uint8_t i;
+  uint16_t ack_node_id;
+  stream_req_lst_item_t* req_item;
+#if LWB_SCHED_ADMISSION_ON
+  uint8_t* results_ptr = acks_ptr + ack_hdr->n_acks * (STREAM_ACK_LEN - 1);
+#else
+  /* Acknowledgements come in the order the requests were sent, walk the list once per packet */
+  stream_req_lst_item_t* next_item = list_head(lst_stream_req);
+#endif
+  for (i = 0; i < ack_hdr->n_acks; i++) {
+    ack_node_id = acks_ptr[i * 2] | acks_ptr[i * 2 + 1] << 8;
+    if (ack_node_id != node_id) {
+      continue;
+    }
+#if LWB_SHORT_ADDR_ON
+    lwb_context.short_addr = acks_ptr[ack_hdr->n_acks * 2 + i];
+#endif /* LWB_SHORT_ADDR_ON */
+#if LWB_SCHED_ADMISSION_ON
+    /* The host also acknowledges streams it admits from the waitlist or drops, so match by ID */
+    req_item = find_stream_req(LWB_GET_STREAM_ID(results_ptr[i]));
+    if ((!req_item || (LWB_GET_STREAM_TYPE(req_item->req.req_type) != LWB_STREAM_TYPE_DEL
+#if LWB_STREAM_REQ_COALESCE_ON
+                       && req_item->state != LWB_STREAM_REQ_CHANGED
+#endif
+                      ))
+        && lwb_context.p_callbacks && lwb_context.p_callbacks->p_on_stream_ack) {
+      lwb_context.p_callbacks->p_on_stream_ack(LWB_GET_STREAM_ID(results_ptr[i]),
+                                               LWB_GET_STREAM_RESULT(results_ptr[i]));
+    }
+#else
+    req_item = next_item;
+#if LWB_STREAM_REQ_COALESCE_ON
+    /* Requests queued or merged since they were last sent cannot be acknowledged yet */
+    while (req_item && req_item->state == LWB_STREAM_REQ_NEW) {
+      req_item = req_item->next;
+    }
+#endif /* LWB_STREAM_REQ_COALESCE_ON */
+    if (req_item) {
+      next_item = req_item->next;
+    }
+#endif /* LWB_SCHED_ADMISSION_ON */
+    if (req_item) {
+#if LWB_STREAM_REQ_COALESCE_ON
+      if (req_item->state == LWB_STREAM_REQ_CHANGED) {
+        /* The acknowledgement is for the request as it was before the merge. Send it again */
+        req_item->state = LWB_STREAM_REQ_NEW;
+        continue;
+      }
+#endif /* LWB_STREAM_REQ_COALESCE_ON */
+      list_remove(lst_stream_req, req_item);
+      memb_free(&mmb_stream_req, req_item);
+      stream_reqs_lst_size--;
+    }
+  }
+
+  if(stream_reqs_lst_size == 0) {
+    /* Hooray..! we are joined */
+    lwb_context.joining_state = LWB_JOINING_STATE_JOINED;
+  }
+
+#if LWB_ONESHOT_ON
+  uint8_t oneshot_ofs = sizeof(lwb_stream_ack_header_t) + ack_hdr->n_acks * STREAM_ACK_LEN;
+  if (len <= oneshot_ofs || len < oneshot_ofs + 1 + buf[oneshot_ofs] * 2) {
+    return;
+  }
+  acks_ptr = buf + oneshot_ofs + 1;
+  for (i = 0; i < buf[oneshot_ofs] && oneshot_q_size > 0; i++) {
+    if ((acks_ptr[i * 2] | acks_ptr[i * 2 + 1] << 8) == node_id) {
+      /* The host got the one-shot message we sent last */
+      data_buf_lst_item_t* buf_item = list_pop(lst_oneshot_queue);
+      memb_free(&mmb_data_buf, buf_item);
+      oneshot_q_size--;
+      oneshot_seq++;
+      LWB_STATS_DATA(n_oneshot_acked)++;
+      /* The contention has been won. The next message starts over without backoff */
+      n_trials = 0;
+      n_rounds_to_wait = 0;
+      break;
+    }
+  }
+#endif /* LWB_ONESHOT_ON */
+}
+
 /*------------------------------------------------------------------------------------------------*/
 lwb_status_t lwb_g_rr_queue_packet(uint8_t* data, uint8_t data_len, uint16_t to_id)
 {
   if (LWB_PKT_APP_DATA_LEN_MAX() < data_len) {
     return LWB_STATUS_FAIL;
   }
+#if LWB_COMPACT_HDR_ON
+  if (to_id > 0xff) {
+    return LWB_STATUS_FAIL;
+  }
+#endif /* LWB_COMPACT_HDR_ON */
 
   data_buf_lst_item_t* p_item = memb_alloc(&mmb_data_buf);
 
@@ -632,8 +1462,136 @@ lwb_status_t lwb_g_rr_queue_packet(uint8_t* data, uint8_t data_len, uint16_t to_
   return LWB_STATUS_SUCCESS;
 }
 
+#if LWB_EVENT_SLOT_ON
 /*------------------------------------------------------------------------------------------------*/
-uint8_t lwb_g_rr_stream_add(uint16_t ipi, uint16_t time_offset)
+lwb_status_t lwb_g_rr_queue_event(uint8_t* data, uint8_t data_len, uint16_t to_id)
+{
+  if (lwb_context.lwb_mode != LWB_MODE_SOURCE || LWB_PKT_APP_DATA_LEN_MAX() < data_len) {
+    return LWB_STATUS_FAIL;
+  }
+#if LWB_COMPACT_HDR_ON
+  if (to_id > 0xff) {
+    return LWB_STATUS_FAIL;
+  }
+#endif /* LWB_COMPACT_HDR_ON */
+
+  data_buf_lst_item_t* p_item = memb_alloc(&mmb_data_buf);
+
+  if (!p_item) {
+    LWB_STATS_DATA(n_tx_nospace)++;
+    return LWB_STATUS_FAIL;
+  }
+
+  p_item->from_id = node_id;
+  p_item->buf.header.to_id = to_id;
+  p_item->buf.header.data_len = data_len;
+  p_item->buf.header.options = 0;
+  memcpy(p_item->buf.data, data, data_len);
+  list_add(lst_event_queue, p_item);
+  event_q_size++;
+
+  return LWB_STATUS_SUCCESS;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_g_rr_get_n_event_slots()
+{
+  return 1 + (events_pending ? LWB_EVENT_N_FAST_SLOTS : 0);
+}
+#endif /* LWB_EVENT_SLOT_ON */
+
+#if LWB_ONESHOT_ON
+/*------------------------------------------------------------------------------------------------*/
+lwb_status_t lwb_g_rr_queue_oneshot(uint8_t* data, uint8_t data_len, uint16_t to_id)
+{
+  if (lwb_context.lwb_mode != LWB_MODE_SOURCE || LWB_PKT_APP_DATA_LEN_MAX() < data_len) {
+    return LWB_STATUS_FAIL;
+  }
+#if LWB_COMPACT_HDR_ON
+  if (to_id > 0xff) {
+    return LWB_STATUS_FAIL;
+  }
+#endif /* LWB_COMPACT_HDR_ON */
+
+  data_buf_lst_item_t* p_item = memb_alloc(&mmb_data_buf);
+
+  if (!p_item) {
+    LWB_STATS_DATA(n_tx_nospace)++;
+    return LWB_STATUS_FAIL;
+  }
+
+  p_item->from_id = node_id;
+  p_item->buf.header.to_id = to_id;
+  p_item->buf.header.data_len = data_len;
+  p_item->buf.header.options = 0;
+  memcpy(p_item->buf.data, data, data_len);
+  list_add(lst_oneshot_queue, p_item);
+  oneshot_q_size++;
+
+  return LWB_STATUS_SUCCESS;
+}
+#endif /* LWB_ONESHOT_ON */
+
+#if LWB_STREAM_REQ_COALESCE_ON
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Merge a deletion or modification into the pending request of the same stream
+/// @return 1 if the request has been merged, 0 if it has to be queued
+static uint8_t coalesce_stream_req(uint8_t id, uint8_t type, uint16_t ipi)
+{
+  stream_req_lst_item_t* p_req_item = find_stream_req(id);
+
+  if (!p_req_item) {
+    return 0;
+  }
+
+  if (p_req_item->state == LWB_STREAM_REQ_NEW
+      && LWB_GET_STREAM_TYPE(p_req_item->req.req_type) == LWB_STREAM_TYPE_ADD) {
+    if (type == LWB_STREAM_TYPE_MOD) {
+      /* Still unknown to the host, add it with the new period */
+      p_req_item->req.ipi = ipi;
+      return 1;
+    }
+
+    /* Deleting a stream the host has never heard of */
+    list_remove(lst_stream_req, p_req_item);
+    memb_free(&mmb_stream_req, p_req_item);
+    stream_reqs_lst_size--;
+    if (stream_reqs_lst_size == 0) {
+      lwb_context.joining_state = (lwb_context.joining_state == LWB_JOINING_STATE_JOINING) ?
+                                  LWB_JOINING_STATE_NOT_JOINED : LWB_JOINING_STATE_JOINED;
+    }
+    return 1;
+  }
+
+  if (p_req_item->state != LWB_STREAM_REQ_NEW) {
+    /* The host may know the previous request already. An add request turns into a modification,
+     * which the host also accepts for a stream it does not have */
+    p_req_item->state = LWB_STREAM_REQ_CHANGED;
+  }
+
+#if LWB_SCHED_PHASE_ON
+  if (type == LWB_STREAM_TYPE_MOD
+      && LWB_GET_STREAM_TYPE(p_req_item->req.req_type) == LWB_STREAM_TYPE_DEL) {
+    /* The host may have deleted the stream already, it picks a phase for it again */
+    p_req_item->req.time_info = LWB_STREAM_PHASE_ANY;
+  }
+#endif
+
+  LWB_SET_STREAM_TYPE(p_req_item->req.req_type, type);
+  p_req_item->req.ipi = ipi;
+  if (type == LWB_STREAM_TYPE_DEL) {
+    p_req_item->req.time_info = 0;
+#if LWB_SLOT_CLASSES_ON
+    p_req_item->req.max_len = 0;
+#endif
+  }
+  PRINTF("stream req merged: id %"PRIu8", type %"PRIu8"\n", id, type);
+  return 1;
+}
+#endif /* LWB_STREAM_REQ_COALESCE_ON */
+
+/*------------------------------------------------------------------------------------------------*/
+static uint8_t add_stream_req(uint16_t ipi, uint16_t time_offset, uint8_t max_len)
 {
   stream_req_lst_item_t* p_req_item = memb_alloc(&mmb_stream_req);
 
@@ -643,8 +1601,14 @@ uint8_t lwb_g_rr_stream_add(uint16_t ipi, uint16_t time_offset)
 
   p_req_item->req.ipi = ipi;
   p_req_item->req.time_info = time_offset;
+#if LWB_SLOT_CLASSES_ON
+  p_req_item->req.max_len = max_len;
+#endif
   LWB_SET_STREAM_TYPE(p_req_item->req.req_type, LWB_STREAM_TYPE_ADD);
   LWB_SET_STREAM_ID(p_req_item->req.req_type, stream_id_next);
+#if LWB_STREAM_REQ_COALESCE_ON
+  p_req_item->state = LWB_STREAM_REQ_NEW;
+#endif
   list_add(lst_stream_req, p_req_item);
   stream_reqs_lst_size++;
 
@@ -662,9 +1626,29 @@ uint8_t lwb_g_rr_stream_add(uint16_t ipi, uint16_t time_offset)
   return stream_id_next++;
 }
 
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_g_rr_stream_add(uint16_t ipi, uint16_t time_offset)
+{
+  return add_stream_req(ipi, time_offset, 0);
+}
+
+#if LWB_SLOT_CLASSES_ON
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_g_rr_stream_add_max_len(uint16_t ipi, uint16_t time_offset, uint8_t max_len)
+{
+  return add_stream_req(ipi, time_offset, max_len);
+}
+#endif /* LWB_SLOT_CLASSES_ON */
+
 /*------------------------------------------------------------------------------------------------*/
 void lwb_g_rr_stream_del(uint8_t id)
 {
+#if LWB_STREAM_REQ_COALESCE_ON
+  if (coalesce_stream_req(id, LWB_STREAM_TYPE_DEL, 0)) {
+    return;
+  }
+#endif /* LWB_STREAM_REQ_COALESCE_ON */
+
   stream_req_lst_item_t* p_req_item = memb_alloc(&mmb_stream_req);
 
   if (!p_req_item) {
@@ -673,8 +1657,14 @@ void lwb_g_rr_stream_del(uint8_t id)
 
   p_req_item->req.ipi = 0;
   p_req_item->req.time_info = 0;
+#if LWB_SLOT_CLASSES_ON
+  p_req_item->req.max_len = 0;
+#endif
   LWB_SET_STREAM_TYPE(p_req_item->req.req_type, LWB_STREAM_TYPE_DEL);
   LWB_SET_STREAM_ID(p_req_item->req.req_type, id);
+#if LWB_STREAM_REQ_COALESCE_ON
+  p_req_item->state = LWB_STREAM_REQ_NEW;
+#endif
   list_add(lst_stream_req, p_req_item);
   stream_reqs_lst_size++;
   /* we don't care about the joining state in here */
@@ -682,6 +1672,12 @@ void lwb_g_rr_stream_del(uint8_t id)
 
 /*------------------------------------------------------------------------------------------------*/
 void lwb_g_rr_stream_mod(uint8_t id, uint16_t ipi) {
+#if LWB_STREAM_REQ_COALESCE_ON
+  if (coalesce_stream_req(id, LWB_STREAM_TYPE_MOD, ipi)) {
+    return;
+  }
+#endif /* LWB_STREAM_REQ_COALESCE_ON */
+
   stream_req_lst_item_t* p_req_item = memb_alloc(&mmb_stream_req);
 
   if (!p_req_item) {
@@ -691,9 +1687,21 @@ void lwb_g_rr_stream_mod(uint8_t id, uint16_t ipi) {
   PRINTF("stream mod\n");
 
   p_req_item->req.ipi = ipi;
+#if LWB_SCHED_PHASE_ON
+  /* The host keeps the phase the stream was added with */
+  p_req_item->req.time_info = LWB_STREAM_PHASE_ANY;
+#else
   p_req_item->req.time_info = 0;
+#endif
+#if LWB_SLOT_CLASSES_ON
+  /* The host keeps the payload size the stream was added with */
+  p_req_item->req.max_len = 0;
+#endif
   LWB_SET_STREAM_TYPE(p_req_item->req.req_type, LWB_STREAM_TYPE_MOD);
   LWB_SET_STREAM_ID(p_req_item->req.req_type, id);
+#if LWB_STREAM_REQ_COALESCE_ON
+  p_req_item->state = LWB_STREAM_REQ_NEW;
+#endif
   list_add(lst_stream_req, p_req_item);
   stream_reqs_lst_size++;
 
@@ -716,8 +1724,14 @@ void lwb_g_rr_data_output()
   data_buf_lst_item_t* item = NULL;
   while ((item = list_head(lst_rx_buf_queue))) {
     if (lwb_context.p_callbacks && lwb_context.p_callbacks->p_on_data) {
+#if LWB_NET_TIME_ON
+      lwb_time_set_rx(1, item->t_rx);
+#endif /* LWB_NET_TIME_ON */
       lwb_context.p_callbacks->p_on_data(item->buf.data, item->buf.header.data_len,
                                          item->from_id);
+#if LWB_NET_TIME_ON
+      lwb_time_set_rx(0, 0);
+#endif /* LWB_NET_TIME_ON */
     }
 
     list_remove(lst_rx_buf_queue, item);
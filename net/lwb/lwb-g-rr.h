@@ -48,10 +48,48 @@ void lwb_g_rr_init();
 
 lwb_status_t lwb_g_rr_queue_packet(uint8_t* data, uint8_t data_len, uint16_t to_id);
 
+#if LWB_EVENT_SLOT_ON
+lwb_status_t lwb_g_rr_queue_event(uint8_t* data, uint8_t data_len, uint16_t to_id);
+
+uint8_t lwb_g_rr_get_n_event_slots();
+#endif /* LWB_EVENT_SLOT_ON */
+
+#if LWB_ONESHOT_ON
+lwb_status_t lwb_g_rr_queue_oneshot(uint8_t* data, uint8_t data_len, uint16_t to_id);
+#endif /* LWB_ONESHOT_ON */
+
 void lwb_g_rr_data_output();
 
+#if LWB_HOST_SLOTS_ON
+/**
+ * @brief Get the number of packets in the TX queue
+ */
+uint8_t lwb_g_rr_get_tx_q_size();
+#endif /* LWB_HOST_SLOTS_ON */
+
+/**
+ * @brief Get the length of the pending stream acknowledgements as written by
+ *        lwb_g_rr_write_stream_acks()
+ */
+uint8_t lwb_g_rr_get_stream_acks_len();
+
+/**
+ * @brief Write the pending stream acknowledgements into a buffer and clear them
+ * @return Number of bytes written
+ */
+uint8_t lwb_g_rr_write_stream_acks(uint8_t* buf);
+
+/**
+ * @brief Process stream acknowledgements written by lwb_g_rr_write_stream_acks()
+ */
+void lwb_g_rr_read_stream_acks(uint8_t* buf, uint8_t len);
+
 lwb_status_t lwb_g_rr_stream_add(uint16_t ipi, uint16_t time_offset);
 
+#if LWB_SLOT_CLASSES_ON
+uint8_t lwb_g_rr_stream_add_max_len(uint16_t ipi, uint16_t time_offset, uint8_t max_len);
+#endif /* LWB_SLOT_CLASSES_ON */
+
 void lwb_g_rr_stream_del(uint8_t id);
 
 void lwb_g_rr_stream_mod(uint8_t id, uint16_t ipi);
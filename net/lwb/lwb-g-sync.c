@@ -46,6 +46,12 @@
 #include "lwb-g-rr.h"
 #include "lwb-scheduler.h"
 #include "lwb-sched-compressor.h"
+#include "lwb-slot-len.h"
+#include "lwb-channel.h"
+#include "lwb-time.h"
+#if LWB_DYN_T_COMP_ON
+#include "cc2538-rf.h"
+#endif /* LWB_DYN_T_COMP_ON */
 
 #if LWB_DEBUG
 #define PRINTF(...) printf(__VA_ARGS__)
@@ -62,12 +68,86 @@ static pt_state_t pt_state_sync;
 static pt_state_t pt_state_rr;
 
 static lwb_status_t ret_status;
+/* Payload length of the last schedule received, used to predict the channel hops of the next one */
+static uint8_t sched_payload_len = GLOSSY_UNKNOWN_PAYLOAD_LEN;
 
 static volatile uint8_t is_active;
 
+#if LWB_DYN_T_COMP_ON
+/// @brief Measured durations of computing and preparing the schedule, in rtimer ticks
+static rtimer_clock_t t_comp_samples[LWB_DYN_T_COMP_WINDOW_SIZE];
+static uint8_t t_comp_idx;
+static uint8_t t_comp_n;
+/// @brief Time currently reserved for computing and preparing the schedule
+static rtimer_clock_t t_comp_reserved;
+/// @brief MAC timer value when the schedule computation started
+static uint64_t t_comp_start_mtt;
+#endif /* LWB_DYN_T_COMP_ON */
+
 PROCESS_NAME(lwb_main_process);
 
 
+#if LWB_DYN_T_COMP_ON
+/*------------------------------------------------------------------------------------------------*/
+static void t_comp_init(void)
+{
+  t_comp_idx = 0;
+  t_comp_n = 0;
+  t_comp_reserved = T_COMP;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static inline void t_comp_start(void)
+{
+  t_comp_start_mtt = cc2538_rf_get_mac_time_now();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void t_comp_stop(void)
+{
+  uint8_t i, j;
+  rtimer_clock_t sorted[LWB_DYN_T_COMP_WINDOW_SIZE];
+  rtimer_clock_t t = 1 + glossy_mac_ticks_to_rtimer((uint32_t)(cc2538_rf_get_mac_time_now()
+                                                                 - t_comp_start_mtt));
+
+  if (t > t_comp_reserved) {
+    LWB_STATS_SCHED(n_t_comp_overruns)++;
+    PRINTF("WARN: schedule computation took %"PRIu32" ticks, %"PRIu32" reserved\n",
+           (uint32_t)t, (uint32_t)t_comp_reserved);
+    /* Start measuring again and reserve enough for what we have just seen */
+    t_comp_n = 0;
+    t_comp_reserved = LWB_DYN_T_COMP_FACTOR * t + T_DYN_T_COMP_MARGIN;
+    if (t_comp_reserved < T_COMP) {
+      t_comp_reserved = T_COMP;
+    }
+  }
+
+  t_comp_samples[t_comp_idx] = t;
+  t_comp_idx = (t_comp_idx + 1) % LWB_DYN_T_COMP_WINDOW_SIZE;
+  if (t_comp_n < LWB_DYN_T_COMP_WINDOW_SIZE) {
+    t_comp_n++;
+  }
+  if (t_comp_n < LWB_DYN_T_COMP_WINDOW_SIZE) {
+    return;
+  }
+
+  /* Sort in descending order and skip the largest ones */
+  for (i = 0; i < LWB_DYN_T_COMP_WINDOW_SIZE; i++) {
+    for (j = i; j > 0 && sorted[j - 1] < t_comp_samples[i]; j--) {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = t_comp_samples[i];
+  }
+  t_comp_reserved = LWB_DYN_T_COMP_FACTOR * sorted[LWB_DYN_T_COMP_N_OUTLIERS] + T_DYN_T_COMP_MARGIN;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+rtimer_clock_t lwb_g_sync_get_t_comp(void)
+{
+  return t_comp_reserved;
+}
+#endif /* LWB_DYN_T_COMP_ON */
+
 /*------------------------------------------------------------------------------------------------*/
 void lwb_g_sync_init()
 {
@@ -79,20 +159,33 @@ void lwb_g_sync_init()
 
   PT_INIT(pt_state_sync.pt);
 
+  /* Floods follow each other closely. Do not reprogram the interrupt priorities for each of them */
+  glossy_hold_irq_priorities(1);
+
+#if LWB_DYN_SLOT_LEN_ON
+  lwb_slot_len_init();
+#endif /* LWB_DYN_SLOT_LEN_ON */
+#if LWB_CHANNEL_SELECT_ON
+  lwb_channel_init();
+#endif /* LWB_CHANNEL_SELECT_ON */
+
   if (lwb_context.lwb_mode == LWB_MODE_HOST) {
+#if LWB_DYN_T_COMP_ON
+    t_comp_init();
+#endif /* LWB_DYN_T_COMP_ON */
     lwb_sched_init();
     lwb_sched_compute_schedule(&lwb_context.current_sched);
 
     pt_state_sync.cb = lwb_g_sync_host;
     pt_state_rr.cb = lwb_g_sync_host;
-    rtimer_set(&lwb_context.rt, RTIMER_NOW() + RTIMER_SECOND * 2, 0,
-               (rtimer_callback_t) pt_state_sync.cb, &pt_state_sync);
+    LWB_RTIMER_SET(&lwb_context.rt, RTIMER_NOW() + RTIMER_SECOND * 2, pt_state_sync.cb,
+                   &pt_state_sync);
   } else {
     lwb_context.joining_state = LWB_JOINING_STATE_NOT_JOINED;
     pt_state_sync.cb = lwb_g_sync_source;
     pt_state_rr.cb = lwb_g_sync_source;
-    rtimer_set(&lwb_context.rt, RTIMER_NOW() + RTIMER_SECOND, 0,
-               (rtimer_callback_t) pt_state_sync.cb, &pt_state_sync);
+    LWB_RTIMER_SET(&lwb_context.rt, RTIMER_NOW() + RTIMER_SECOND, pt_state_sync.cb,
+                   &pt_state_sync);
   }
 }
 
@@ -107,6 +200,15 @@ void prepare_schedule(void)
   lwb_pkt_header_t* header = (lwb_pkt_header_t*) lwb_context.txrx_buf;
   header->pkt_type = LWB_PKT_TYPE_SCHED;
   lwb_context.txrx_buf_len = sizeof(lwb_pkt_header_t);
+#if LWB_EVENT_SLOT_ON
+  CURRENT_SCHEDULE_INFO().n_event_slots = lwb_g_rr_get_n_event_slots();
+#endif /* LWB_EVENT_SLOT_ON */
+#if LWB_DYN_SLOT_LEN_ON
+  CURRENT_SCHEDULE_INFO().n_hops = lwb_slot_len_compute_n_hops();
+#endif /* LWB_DYN_SLOT_LEN_ON */
+#if LWB_CHANNEL_SELECT_ON
+  CURRENT_SCHEDULE_INFO().channel_switch = lwb_channel_compute_switch();
+#endif /* LWB_CHANNEL_SELECT_ON */
   /* Compress and copy the schedule to buffer */
   memcpy(lwb_context.txrx_buf + sizeof(lwb_pkt_header_t), &CURRENT_SCHEDULE_INFO(),
          sizeof(lwb_sched_info_t));
@@ -114,6 +216,21 @@ void prepare_schedule(void)
   lwb_context.txrx_buf_len += lwb_sched_compress(&CURRENT_SCHEDULE(),
                                                  lwb_context.txrx_buf + lwb_context.txrx_buf_len,
                                                  LWB_MAX_TXRX_BUF_LEN - lwb_context.txrx_buf_len);
+#if LWB_SCHED_ACKS_ON
+  /* Without a slot for them, the scheduler made room for the stream acknowledgements in here.
+   * With host slots, the first slot may be one for the packets of the host, but the scheduler
+   * only drops the acknowledgement slot if they fit, so they fit here with it too.
+   */
+  if (LWB_N_HOST_ACKS() > 0
+#if !LWB_HOST_SLOTS_ON
+      && (N_CURRENT_DATA_SLOTS() == 0 || CURRENT_SCHEDULE().slots[0] != 0)
+#endif /* !LWB_HOST_SLOTS_ON */
+      && lwb_context.txrx_buf_len + lwb_g_rr_get_stream_acks_len()
+         <= sizeof(lwb_pkt_header_t) + LWB_PKT_DATA_LEN_MAX()) {
+    lwb_context.txrx_buf_len += lwb_g_rr_write_stream_acks(lwb_context.txrx_buf
+                                                           + lwb_context.txrx_buf_len);
+  }
+#endif /* LWB_SCHED_ACKS_ON */
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -138,26 +255,40 @@ PT_THREAD(lwb_g_sync_host(struct rtimer *rt, pt_state_t* pt_state))
     lwb_context.t_start = RTIMER_TIME(rt);
 
     lwb_save_energest();
-    /* Start glossy and keep it on for T_SYNC_ON time*/
+    GLOSSY_SET_SLOT_START(lwb_context.t_start, lwb_context.txrx_buf_len);
+    /* Start glossy and keep it on for the duration announced in the schedule */
     glossy_start(node_id, lwb_context.txrx_buf, lwb_context.txrx_buf_len, N_SYNC, GLOSSY_WITH_SYNC);
-    LWB_WAIT_UNTIL(lwb_context.t_start + T_SYNC_ON);
+    LWB_WAIT_UNTIL(lwb_context.t_start + T_SYNC_LEN(CURRENT_SCHEDULE_INFO()));
     glossy_stop();
     lwb_update_ctrl_energest();
 
     lwb_context.sync_stats.n_rx = glossy_get_n_rx();
     lwb_context.sync_stats.relay_cnt_first_rx = glossy_get_relay_cnt_first_rx();
     lwb_context.t_sync_ref = GLOSSY_T_REF;
+#if LWB_NET_TIME_ON
+    lwb_time_set_ref(CURRENT_SCHEDULE_INFO().time, lwb_context.t_sync_ref, 1);
+#endif /* LWB_NET_TIME_ON */
 
     /* Glossy scheduling for data and contention slots  */
     PT_SPAWN(pt_state->pt, pt_state_rr.pt, lwb_g_rr_host(rt, &pt_state_rr, 0));
 
+#if LWB_DYN_T_COMP_ON
+    t_comp_start();
+#endif /* LWB_DYN_T_COMP_ON */
     memcpy(&OLD_SCHEDULE(), &CURRENT_SCHEDULE(), sizeof(lwb_schedule_t));
+#if LWB_CHANNEL_SELECT_ON
+    /* The next round starts on the new channel if the schedule of this one counted down to 1 */
+    lwb_channel_round_end(&OLD_SCHEDULE_INFO());
+#endif /* LWB_CHANNEL_SELECT_ON */
     /* Compute new schedule. The current schedule becomes the old one */
     lwb_sched_compute_schedule(&CURRENT_SCHEDULE());
     /* Compress and copy the schedule to buffer */
 
     /* Compress and copy the schedule to buffer */
     prepare_schedule();
+#if LWB_DYN_T_COMP_ON
+    t_comp_stop();
+#endif /* LWB_DYN_T_COMP_ON */
 
     LWB_SET_POLL_FLAG(LWB_POLL_FLAGS_SCHED_END);
     process_poll(&lwb_main_process);
@@ -173,6 +304,7 @@ PT_THREAD(lwb_g_sync_host(struct rtimer *rt, pt_state_t* pt_state))
   }
 
   is_active = 0;
+  glossy_hold_irq_priorities(0);
   lwb_context.run_state = LWB_RUN_STATE_STOPPED;
 
   PT_END(pt_state->pt);
@@ -185,7 +317,7 @@ static inline void lwb_set_n_my_slots()
   uint8_t i;
   lwb_context.n_my_slots = 0;
   for (i = 0; i < N_CURRENT_DATA_SLOTS(); i++) {
-    if (node_id == CURRENT_SCHEDULE().slots[i]) {
+    if (LWB_IS_MY_SLOT(CURRENT_SCHEDULE().slots[i])) {
       lwb_context.n_my_slots++;
     }
   }
@@ -338,6 +470,9 @@ PT_THREAD(lwb_g_sync_source(struct rtimer *rt, pt_state_t* pt_state))
 
     if (lwb_context.sync_state == LWB_SYNC_STATE_BOOTSTRAP) {
       PRINTF("BOOTSTRAP\r\n");
+#if LWB_CHANNEL_SELECT_ON
+      lwb_channel_scan_start();
+#endif /* LWB_CHANNEL_SELECT_ON */
       do {
         lwb_save_energest();
         glossy_start(GLOSSY_UNKNOWN_INITIATOR, lwb_context.txrx_buf, GLOSSY_UNKNOWN_PAYLOAD_LEN,
@@ -345,20 +480,39 @@ PT_THREAD(lwb_g_sync_source(struct rtimer *rt, pt_state_t* pt_state))
         LWB_WAIT_UNTIL(RTIMER_TIME(rt) + T_SYNC_ON);
         glossy_stop();
         lwb_update_ctrl_energest();
+#if LWB_CHANNEL_SELECT_ON
+        if (!GLOSSY_IS_SYNCED()) {
+          /* The host may have moved to another channel while we were not synchronized */
+          lwb_channel_scan();
+        }
+#endif /* LWB_CHANNEL_SELECT_ON */
         /* FIXME: Got to sleep if we don't receive for a schedule for long time */
       } while (!GLOSSY_IS_SYNCED());
 
     } else {
       lwb_save_energest();
+      if (lwb_context.sync_state == LWB_SYNC_STATE_SYNCED) {
+        /* With the skew estimated, the schedule is expected one guard time after waking up */
+        glossy_set_next_t_ref(lwb_context.t_start + lwb_context.t_sync_guard, sched_payload_len);
+      }
       glossy_start(GLOSSY_UNKNOWN_INITIATOR, lwb_context.txrx_buf, GLOSSY_UNKNOWN_PAYLOAD_LEN,
                    N_SYNC, GLOSSY_WITH_SYNC);
-      LWB_WAIT_UNTIL(lwb_context.t_start + T_SYNC_ON + lwb_context.t_sync_guard);
+      /* The new schedule is not known yet. Glossy stops by itself after N_SYNC transmissions, so
+       * this usually ends with the duration of the last schedule
+       */
+      LWB_WAIT_UNTIL(lwb_context.t_start + T_SYNC_LEN(OLD_SCHEDULE_INFO()) + lwb_context.t_sync_guard);
+      if (glossy_is_active()) {
+        /* The host may have announced a larger diameter in the new schedule */
+        LWB_WAIT_UNTIL(lwb_context.t_start + T_SYNC_LISTEN_LEN(OLD_SCHEDULE_INFO())
+                       + lwb_context.t_sync_guard);
+      }
       glossy_stop();
       lwb_update_ctrl_energest();
     }
 
     lwb_context.sync_stats.n_rx = glossy_get_n_rx();
     lwb_context.sync_stats.relay_cnt_first_rx = glossy_get_relay_cnt_first_rx();
+    lwb_context.sync_stats.t_ref_spread = glossy_get_t_ref_spread();
 
     update_sync_state();
 
@@ -371,10 +525,18 @@ PT_THREAD(lwb_g_sync_source(struct rtimer *rt, pt_state_t* pt_state))
         || lwb_context.sync_state == LWB_SYNC_STATE_SYNCED) {
       /* We are good to go */
       lwb_context.txrx_buf_len = glossy_get_payload_len();
+      sched_payload_len = lwb_context.txrx_buf_len;
 
       uint8_t* sched = LWB_PKT_DATA_PTR() + sizeof(lwb_sched_info_t);
       uint8_t len = lwb_context.txrx_buf_len - sizeof(lwb_pkt_header_t) - sizeof(lwb_sched_info_t);
       ret_status = lwb_sched_decompress(&CURRENT_SCHEDULE(), sched, len);
+#if LWB_SCHED_ACKS_ON
+      uint8_t sched_len = lwb_sched_get_compressed_len(&CURRENT_SCHEDULE());
+      if (len > sched_len) {
+        /* Stream acknowledgements follow the schedule */
+        lwb_g_rr_read_stream_acks(sched + sched_len, len - sched_len);
+      }
+#endif /* LWB_SCHED_ACKS_ON */
 
       lwb_set_n_my_slots();
 
@@ -387,12 +549,25 @@ PT_THREAD(lwb_g_sync_source(struct rtimer *rt, pt_state_t* pt_state))
       memcpy(&CURRENT_SCHEDULE(), &OLD_SCHEDULE(), sizeof(lwb_schedule_t));
       /* Set the new time based on the round period */
       CURRENT_SCHEDULE_INFO().time = OLD_SCHEDULE_INFO().time + OLD_SCHEDULE_INFO().round_period;
+#if LWB_CHANNEL_SELECT_ON
+      lwb_channel_skip_round(&CURRENT_SCHEDULE_INFO());
+#endif /* LWB_CHANNEL_SELECT_ON */
 
+      /* With dynamic slot lengths, the slot lengths of the last schedule are reused */
       if (lwb_context.sync_state == LWB_SYNC_STATE_UNSYNCED_1) {
         PT_SPAWN(pt_state->pt, pt_state_rr.pt, lwb_g_rr_source(rt, &pt_state_rr, 0));
       }
     }
 
+#if LWB_NET_TIME_ON
+    /* Also after a missed schedule, with the estimated reference */
+    lwb_time_set_ref(CURRENT_SCHEDULE_INFO().time, lwb_context.t_sync_ref,
+                     lwb_context.sync_state == LWB_SYNC_STATE_SYNCED
+                     || lwb_context.sync_state == LWB_SYNC_STATE_QUASI_SYNCED);
+#endif /* LWB_NET_TIME_ON */
+#if LWB_CHANNEL_SELECT_ON
+    lwb_channel_round_end(&CURRENT_SCHEDULE_INFO());
+#endif /* LWB_CHANNEL_SELECT_ON */
     memcpy(&OLD_SCHEDULE(), &CURRENT_SCHEDULE(), sizeof(lwb_schedule_t));
     lwb_context.t_last_sync_ref = lwb_context.t_sync_ref;
     lwb_context.time = OLD_SCHEDULE_INFO().time;
@@ -412,6 +587,7 @@ PT_THREAD(lwb_g_sync_source(struct rtimer *rt, pt_state_t* pt_state))
   }
 
   is_active = 0;
+  glossy_hold_irq_priorities(0);
   lwb_context.run_state = LWB_RUN_STATE_STOPPED;
   lwb_context.joining_state = LWB_JOINING_STATE_NOT_JOINED;
 
@@ -49,4 +49,13 @@ void lwb_g_sync_init();
 
 void lwb_g_sync_stop();
 
+#if LWB_DYN_T_COMP_ON
+/**
+ * @brief Get the time to reserve for computing and preparing the schedule
+ * @return T_COMP until enough rounds have been measured, otherwise the measured high-percentile
+ *         bound scaled by LWB_DYN_T_COMP_FACTOR plus T_DYN_T_COMP_MARGIN
+ */
+rtimer_clock_t lwb_g_sync_get_t_comp(void);
+#endif /* LWB_DYN_T_COMP_ON */
+
 #endif /* __LWB_G_SYNC_H__ */
@@ -41,11 +41,31 @@
 #include "contiki.h"
 
 #include "lwb-common.h"
+#include "lwb-slot-len.h"
+#include "lwb-g-sync.h"
+#include "lwb-time.h"
 
 #define N_CURRENT_DATA_SLOTS()          LWB_GET_N_DATA_SLOTS(lwb_context.current_sched.sched_info.n_slots)
 #define N_CURRENT_FREE_SLOTS()          LWB_GET_N_FREE_SLOTS(lwb_context.current_sched.sched_info.n_slots)
 #define CURRENT_SCHEDULE()              (lwb_context.current_sched)
 #define CURRENT_SCHEDULE_INFO()         (lwb_context.current_sched.sched_info)
+#if LWB_EVENT_SLOT_ON
+#define N_CURRENT_EVENT_SLOTS()         (lwb_context.current_sched.sched_info.n_event_slots)
+#endif
+
+#if LWB_SHORT_ADDR_ON
+/* Zero is the slot of the host, so a node without a short address has no slots */
+#define LWB_IS_MY_SLOT(owner)           (lwb_context.short_addr != 0 && (owner) == lwb_context.short_addr)
+#else
+#define LWB_IS_MY_SLOT(owner)           ((owner) == node_id)
+#endif /* LWB_SHORT_ADDR_ON */
+
+#if LWB_ONESHOT_ON
+/* One-shot acknowledgements travel together with the stream acknowledgements */
+#define LWB_N_HOST_ACKS()               (lwb_context.n_stream_acks + lwb_context.n_oneshot_acks)
+#else
+#define LWB_N_HOST_ACKS()               (lwb_context.n_stream_acks)
+#endif /* LWB_ONESHOT_ON */
 
 #define OLD_SCHEDULE()                  (lwb_context.old_sched)
 #define OLD_SCHEDULE_INFO()             (lwb_context.old_sched.sched_info)
@@ -61,23 +81,86 @@
 
 /// @defgroup TX RX buffer macros
 /// @{
+#if LWB_COMPACT_HDR_ON
+#define LWB_PKT_TYPE_MASK               0x07
+#define LWB_PKT_IN_QUEUE_SHIFT          3
+#define LWB_PKT_IN_QUEUE_MAX            0x1f
+#define GET_LWB_PKT_TYPE(type)          (lwb_context.txrx_buf[0] & LWB_PKT_TYPE_MASK)
+#else
 #define GET_LWB_PKT_TYPE(type)          (lwb_context.txrx_buf[0])
+#endif /* LWB_COMPACT_HDR_ON */
 #define SET_LWB_PKT_TYPE(type)          (lwb_context.txrx_buf[0] = type)
 #define LWB_PKT_DATA_PTR()              (lwb_context.txrx_buf + sizeof(lwb_pkt_header_t))
 #define LWB_PKT_DATA_LEN_MAX()          (glossy_get_max_payload_len(lwb_context.enc) - sizeof(lwb_pkt_header_t))
-#define LWB_PKT_APP_DATA_PTR()          (lwb_context.txrx_buf + sizeof(lwb_pkt_header_t) + sizeof(data_header_t))
-#define LWB_PKT_APP_DATA_LEN_MAX()      (LWB_PKT_DATA_LEN_MAX() - sizeof(data_header_t))
+#define LWB_PKT_APP_DATA_PTR()          (lwb_context.txrx_buf + sizeof(lwb_pkt_header_t) + sizeof(data_air_header_t))
+#define LWB_PKT_APP_DATA_LEN_MAX()      (LWB_PKT_DATA_LEN_MAX() - sizeof(data_air_header_t))
 #define LWB_PKT_APP_DATA_HDR_OPT_SET_PKT_TYPE(hdr, type)  (hdr)->options |= (type) & 0x0f
 #define LWB_PKT_APP_DATA_HDR_OPT_GET_PKT_TYPE(hdr)        ((hdr)->options & 0x0f)
+#define LWB_PKT_APP_DATA_HDR_OPT_SET_N_HOPS(hdr, n)       (hdr)->options = ((hdr)->options & 0x0f) \
+                                                                         | (MIN((n), 0x0f) << 4)
+#define LWB_PKT_APP_DATA_HDR_OPT_GET_N_HOPS(hdr)          ((hdr)->options >> 4)
+/* One-shot messages carry a sequence number in the bits of the hop count */
+#define LWB_PKT_APP_DATA_HDR_OPT_SET_ONESHOT_SEQ(hdr, seq) (hdr)->options = ((hdr)->options & 0x0f) \
+                                                                          | (((seq) & 0x0f) << 4)
+#define LWB_PKT_APP_DATA_HDR_OPT_GET_ONESHOT_SEQ(hdr)      ((hdr)->options >> 4)
 /// @}
 
 
-#define LWB_SCHED_GET_MAX_BW(period, n_free)  ((((period) * RTIMER_SECOND) \
-                                                 - T_SYNC_ON \
-                                                 - T_COMP \
-                                                 - ((n_free) * T_FREE_ON) \
-                                                 - ((n_free) * T_GAP)) \
-                                               / (T_GAP + T_RR_ON))
+#if LWB_DYN_SLOT_LEN_ON
+/// @brief Glossy duration of the schedule flood for the diameter announced in a schedule
+#define T_SYNC_LEN(sched_info)          lwb_slot_len_get_t_sync((sched_info).n_hops)
+/// @brief Glossy duration of a data slot for the diameter announced in a schedule
+#define T_RR_LEN(sched_info)            lwb_slot_len_get_t_rr((sched_info).n_hops)
+/// @brief How long sources listen for the next schedule flood after a schedule
+#define T_SYNC_LISTEN_LEN(sched_info)   lwb_slot_len_get_t_sync_listen((sched_info).n_hops)
+#else
+#define T_SYNC_LEN(sched_info)          T_SYNC_ON
+#define T_SYNC_LISTEN_LEN(sched_info)   T_SYNC_ON
+#define T_RR_LEN(sched_info)            T_RR_ON
+#endif
+
+#if LWB_DYN_SLOT_LEN_ON
+#define SCHED_N_HOPS(sched_info)        ((sched_info).n_hops)
+#else
+#define SCHED_N_HOPS(sched_info)        0
+#endif
+
+#if LWB_SLOT_CLASSES_ON
+/// @brief Glossy duration of a data slot of a schedule
+#define T_DATA_SLOT_LEN(sched, idx)     lwb_slot_len_get_t_data(SCHED_N_HOPS((sched).sched_info), \
+                                                                (sched).slot_cfgs[idx])
+/// @brief Number of Glossy transmissions in a data slot of a schedule
+#define N_TX_DATA_SLOT(sched, idx)      LWB_SLOT_CFG_GET_N_TX((sched).slot_cfgs[idx])
+#else
+#define T_DATA_SLOT_LEN(sched, idx)     T_RR_LEN((sched).sched_info)
+#define N_TX_DATA_SLOT(sched, idx)      N_RR
+#endif
+
+#if LWB_EVENT_SLOT_ON
+/// @brief Duration of an event slot followed by its acknowledgement slot, including the gaps
+#define T_EVENT_SLOT_LEN                (T_EVENT_ON + T_GAP + T_EVENT_ACK_ON + T_GAP)
+/// @brief Time the event slots of a round take: the event slot and the fast event slots
+#define T_EVENT_BUDGET(n_event_slots)   (T_EVENT_SLOT_LEN + ((n_event_slots) - 1) * T_EVENT_FAST_PERIOD)
+#else
+#define T_EVENT_BUDGET(n_event_slots)   0
+#endif
+
+#if LWB_DYN_T_COMP_ON
+/// @brief Time reserved for the schedule computation at the end of a round
+#define LWB_T_COMP()                    lwb_g_sync_get_t_comp()
+#else
+#define LWB_T_COMP()                    T_COMP
+#endif
+
+/// @brief Time available for data slots in a round
+#define LWB_SCHED_GET_MAX_T(period, n_free)   (((period) * RTIMER_SECOND) \
+                                                - T_SYNC_ON \
+                                                - LWB_T_COMP() \
+                                                - T_EVENT_BUDGET(1) \
+                                                - ((n_free) * T_FREE_ON) \
+                                                - ((n_free) * T_GAP))
+
+#define LWB_SCHED_GET_MAX_BW(period, n_free)  (LWB_SCHED_GET_MAX_T(period, n_free) / (T_GAP + T_RR_ON))
 
 /// @addtogroup rtimer scheduling
 ///             macro for rtimer based scheduling
@@ -85,9 +168,16 @@
 #define SCHEDULE(ref, offset, cb)   rtimer_set(&lwb_context.rt, ref + offset, 1, (rtimer_callback_t)cb, &lwb_context)
 #define SCHEDULE_L(ref, offset, cb) rtimer_set_long(&lwb_context.rt, ref, offset, (rtimer_callback_t)cb, &lwb_context)
 
+/* Timed callbacks of the network time share the rtimer with LWB */
+#if LWB_NET_TIME_ON
+#define LWB_RTIMER_SET(rt, time, cb, ptr) lwb_time_rtimer_set(rt, time, (rtimer_callback_t)(cb), ptr)
+#else
+#define LWB_RTIMER_SET(rt, time, cb, ptr) rtimer_set(rt, time, 0, (rtimer_callback_t)(cb), ptr)
+#endif /* LWB_NET_TIME_ON */
+
 #define LWB_WAIT_UNTIL(time) \
 {\
-  rtimer_set(rt, (time), 0, (rtimer_callback_t)pt_state->cb, pt_state);\
+  LWB_RTIMER_SET(rt, (time), pt_state->cb, pt_state);\
   PT_YIELD(pt_state->pt);\
 }
 
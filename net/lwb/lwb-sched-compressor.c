@@ -39,6 +39,12 @@
 #define COMP_BUFFER_LEN 128
 static uint8_t comp_buf[COMP_BUFFER_LEN];
 
+#if LWB_SLOT_CLASSES_ON
+#define SLOT_CFGS_LEN(sched)  ((LWB_GET_N_DATA_SLOTS((sched)->sched_info.n_slots) + 1) / 2)
+#else
+#define SLOT_CFGS_LEN(sched)  0
+#endif
+
 /*------------------------------------------------------------------------------------------------*/
 static inline uint8_t get_n_bits(uint16_t a) {
     uint8_t i;
@@ -71,7 +77,7 @@ uint8_t lwb_sched_compress(lwb_schedule_t *sched, uint8_t* buf, uint8_t buf_len)
   req_len = (max_n_bits * LWB_GET_N_DATA_SLOTS(sched->sched_info.n_slots)) / 8;
   req_len += ((max_n_bits * LWB_GET_N_DATA_SLOTS(sched->sched_info.n_slots)) % 8) ? 1 : 0;
 
-  if (buf_len < req_len + 1) {
+  if (buf_len < req_len + 1 + SLOT_CFGS_LEN(sched)) {
     return 0;
   }
 
@@ -100,7 +106,15 @@ uint8_t lwb_sched_compress(lwb_schedule_t *sched, uint8_t* buf, uint8_t buf_len)
   buf[0] = max_n_bits;
   memcpy(buf + 1, comp_buf, req_len);
 
-  return req_len + 1;
+#if LWB_SLOT_CLASSES_ON
+  /* The configurations of the data slots follow, two per byte */
+  memset(buf + 1 + req_len, 0, SLOT_CFGS_LEN(sched));
+  for (i = 0; i < LWB_GET_N_DATA_SLOTS(sched->sched_info.n_slots); i++) {
+    buf[1 + req_len + i / 2] |= (sched->slot_cfgs[i] & 0x0f) << ((i % 2) * 4);
+  }
+#endif /* LWB_SLOT_CLASSES_ON */
+
+  return req_len + 1 + SLOT_CFGS_LEN(sched);
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -135,5 +149,37 @@ uint8_t lwb_sched_decompress(lwb_schedule_t *sched, uint8_t* buf, uint8_t buf_le
     sched->slots[ui8_i] = (tmp >> (bit_start % 8)) & ((1 << max_n_bits) - 1);
   }
 
+#if LWB_SLOT_CLASSES_ON
+  uint8_t slots_len = ((uint16_t)max_n_bits * LWB_GET_N_DATA_SLOTS(sched->sched_info.n_slots) + 7) / 8;
+
+  for (ui8_i = 0; ui8_i < LWB_GET_N_DATA_SLOTS(sched->sched_info.n_slots); ui8_i++) {
+    if (1 + slots_len + ui8_i / 2 < buf_len) {
+      sched->slot_cfgs[ui8_i] = (buf[1 + slots_len + ui8_i / 2] >> ((ui8_i % 2) * 4)) & 0x0f;
+    } else {
+      /* Truncated schedule. Fall back to the longest slots */
+      sched->slot_cfgs[ui8_i] = LWB_SLOT_CFG(LWB_SLOT_CLASS_MAX, N_RR);
+    }
+  }
+#endif /* LWB_SLOT_CLASSES_ON */
+
   return LWB_GET_N_DATA_SLOTS(sched->sched_info.n_slots);
 }
+
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_sched_get_compressed_len(lwb_schedule_t *sched)
+{
+  uint8_t i;
+  uint8_t max_n_bits = 0;
+  uint8_t n_bits;
+
+  /* Same bit width as lwb_sched_compress(), so this also works on a decompressed schedule */
+  for (i = 0; i < LWB_GET_N_DATA_SLOTS(sched->sched_info.n_slots); i++) {
+    n_bits = get_n_bits(sched->slots[i]);
+    if (n_bits > max_n_bits) {
+      max_n_bits = n_bits;
+    }
+  }
+
+  return 1 + ((uint16_t)max_n_bits * LWB_GET_N_DATA_SLOTS(sched->sched_info.n_slots) + 7) / 8
+         + SLOT_CFGS_LEN(sched);
+}
@@ -41,4 +41,6 @@ uint8_t lwb_sched_compress(lwb_schedule_t *sched, uint8_t* buf, uint8_t buf_len)
 
 uint8_t lwb_sched_decompress(lwb_schedule_t *sched, uint8_t* buf, uint8_t buf_len);
 
+uint8_t lwb_sched_get_compressed_len(lwb_schedule_t *sched);
+
 #endif /* __LWB_SHED_COMPRESSOR_H__ */
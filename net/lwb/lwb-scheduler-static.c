@@ -45,6 +45,9 @@
 #include "lwb-common.h"
 #include "lwb-scheduler.h"
 #include "lwb-macros.h"
+#include "lwb-slot-len.h"
+#include "lwb-sched-compressor.h"
+#include "lwb-g-rr.h"
 
 #if LWB_DEBUG
 #define PRINTF(...) printf(__VA_ARGS__)
@@ -61,6 +64,15 @@
 #define LWB_SCHED_WAIT_TIME       300
 #define LWB_SCHED_WAIT_N_STREAMS  24
 
+#if LWB_SCHED_PHASE_ON
+/* A stream is due at next_ready, which moves on by whole IPIs, and thereby keeps its phase */
+#define STREAM_IS_DUE(s)    (lwb_context.time >= (s)->next_ready)
+#define STREAM_N_DUE(s)     ((uint8_t)((lwb_context.time - (s)->next_ready) / (s)->ipi + 1))
+#else
+#define STREAM_IS_DUE(s)    (lwb_context.time >= (s)->ipi + (s)->last_assigned)
+#define STREAM_N_DUE(s)     ((uint8_t)((lwb_context.time - (s)->last_assigned) / (s)->ipi))
+#endif
+
 extern lwb_context_t lwb_context;
 
 MEMB(streams_memb, lwb_stream_info_t, LWB_MAX_N_STREAMS);
@@ -73,20 +85,269 @@ static uint8_t n_crr_sched_strms;
 static lwb_stream_info_t* elgble_strms[LWB_MAX_N_STREAMS];
 static uint8_t n_elgble_strms;
 
+#if LWB_SHORT_ADDR_ON
+/* Node IDs of the short addresses in use. Short address i + 1 belongs to short_addrs[i], zero if
+ * it is free
+ */
+static uint16_t short_addrs[LWB_SHORT_ADDR_MAX_NODES];
+#endif
+
+#if LWB_SCHED_ADMISSION_ON && LWB_SCHED_WAITLIST_LEN > 0
+/* Streams waiting for bandwidth, oldest first */
+typedef struct waitlist_item {
+  struct waitlist_item* next;
+  uint16_t              node_id;
+  lwb_stream_req_t      req;
+} waitlist_item_t;
+
+MEMB(waitlist_memb, waitlist_item_t, LWB_SCHED_WAITLIST_LEN);
+LIST(waitlist);
+#endif
+
 static uint16_t period;
 static uint16_t used_bw;   /* used bandwidth: # packets per period */
 static uint16_t max_bw;
+#if LWB_SLOT_CLASSES_ON
+static uint32_t used_t;    /* used bandwidth: time of the data slots per period */
+static uint32_t max_t;
+#endif
 
+#if LWB_HOST_SLOTS_ON
+/* Slots of the host for its own packets in the current round, reserved before the streams */
+static uint8_t n_host_slots;
+#define N_HOST_SLOTS()      n_host_slots
+#else
+#define N_HOST_SLOTS()      0
+#endif
+
+#if LWB_EVENT_SLOT_ON
+/* Time the fast event slots take from the data slots of the current round */
+static uint32_t t_fast_events;
+#define ROUND_MAX_BW()      (max_bw - MIN(max_bw, (t_fast_events + T_GAP + T_RR_ON - 1) \
+                                                  / (T_GAP + T_RR_ON)))
+#define ROUND_MAX_T()       (max_t - MIN(max_t, t_fast_events))
+#else
+#define ROUND_MAX_BW()      max_bw
+#define ROUND_MAX_T()       max_t
+#endif
+#if LWB_SLOT_CLASSES_ON
+#define T_HOST_SLOTS()      ((uint32_t)N_HOST_SLOTS() \
+                             * (lwb_slot_len_get_t_data(0, get_slot_cfg(NULL)) + T_GAP))
+#endif
+
+#if LWB_SLOT_CLASSES_ON
 /*------------------------------------------------------------------------------------------------*/
-static void inline add_stream(uint16_t from_node_id, lwb_stream_req_t *p_req)
+static inline uint32_t get_stream_t(uint8_t max_len, uint16_t ipi)
 {
-  /* We have a stream add request with an existing stream ID.
-   * This could happen due to the node has not received the stream acknowledgement.
-   * So we add an acknowledgement from it. Otherwise it will keep sending stream requests.
+  /* Streams with missed slots may get one more transmission. Reserve time for it */
+  uint8_t n_tx = MIN(N_RR + 1, LWB_SLOT_N_TX_MAX);
+  rtimer_clock_t t_slot = lwb_slot_len_get_t_data(0, LWB_SLOT_CFG(lwb_slot_len_get_class(max_len),
+                                                                  n_tx));
+  return (uint32_t)MAX(1, period / ipi) * (t_slot + T_GAP);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static uint8_t get_slot_cfg(lwb_stream_info_t* strm)
+{
+  lwb_stream_info_t *crr_stream;
+  uint8_t max_len = 0;
+  uint8_t n_tx = N_RR;
+
+  if (strm == NULL) {
+    /* Stream acknowledgements */
+    return LWB_SLOT_CFG(LWB_SLOT_CLASS_MAX, N_RR);
+  }
+
+  /* A source sends the head of its queue in any of its slots. So the slot has to fit the largest
+   * packet of all of its streams.
    */
+  for (crr_stream = list_head(streams_list); crr_stream != NULL; crr_stream = crr_stream->next) {
+    if (crr_stream->node_id == strm->node_id) {
+      if (crr_stream->max_len == 0) {
+        return LWB_SLOT_CFG(LWB_SLOT_CLASS_MAX, N_RR);
+      }
+      max_len = MAX(max_len, crr_stream->max_len);
+    }
+  }
+
+  if (strm->n_cons_missed > 0) {
+    /* We missed the last packet(s) of this stream. Make the flood more reliable */
+    n_tx = MIN(N_RR + 1, LWB_SLOT_N_TX_MAX);
+  }
+
+  return LWB_SLOT_CFG(lwb_slot_len_get_class(max_len), n_tx);
+}
+#endif /* LWB_SLOT_CLASSES_ON */
+
+#if LWB_SHORT_ADDR_ON
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Get the short address of a node
+/// @return The short address, or zero if the node has none
+static uint8_t get_short_addr(uint16_t id)
+{
+  uint8_t i;
+  for (i = 0; i < LWB_SHORT_ADDR_MAX_NODES; i++) {
+    if (short_addrs[i] == id) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Give a node the lowest free short address, which keeps the slot owners of the schedules
+///        narrow. Called when its first stream is admitted.
+/// @return The short address, or zero if all of them are in use
+static uint8_t alloc_short_addr(uint16_t id)
+{
+  uint8_t i;
+  uint8_t addr = get_short_addr(id);
+
+  if (addr) {
+    return addr;
+  }
+  for (i = 0; i < LWB_SHORT_ADDR_MAX_NODES; i++) {
+    if (short_addrs[i] == 0) {
+      short_addrs[i] = id;
+      PRINTF("SADDR assigned: node %"PRIu16", addr %"PRIu8"\n", id, i + 1);
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Free the short address of a node if it has no streams left. The node learns it from the
+///        zero address in the acknowledgement of its last stream.
+static void release_short_addr(uint16_t id)
+{
+  lwb_stream_info_t *crr_stream;
+  uint8_t addr;
+
+  for (crr_stream = list_head(streams_list); crr_stream != NULL; crr_stream = crr_stream->next) {
+    if (crr_stream->node_id == id) {
+      return;
+    }
+  }
+  addr = get_short_addr(id);
+  if (addr) {
+    short_addrs[addr - 1] = 0;
+    PRINTF("SADDR freed: node %"PRIu16", addr %"PRIu8"\n", id, addr);
+  }
+}
+#endif /* LWB_SHORT_ADDR_ON */
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Queue a stream acknowledgement for a node
+static void add_stream_ack(uint16_t from_node_id, uint8_t stream_id, uint8_t result)
+{
   if (lwb_context.n_stream_acks < LWB_SCHED_MAX_SLOTS) {
+#if LWB_SHORT_ADDR_ON
+    lwb_context.stream_ack_addrs[lwb_context.n_stream_acks] = get_short_addr(from_node_id);
+#endif
+#if LWB_SCHED_ADMISSION_ON
+    lwb_context.stream_ack_results[lwb_context.n_stream_acks] = LWB_STREAM_ACK_RESULT(stream_id,
+                                                                                      result);
+#endif
     lwb_context.stream_akcs[lwb_context.n_stream_acks++] = from_node_id;
   }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static inline uint8_t stream_fits(lwb_stream_req_t *p_req)
+{
+#if LWB_SLOT_CLASSES_ON
+  return used_t + get_stream_t(p_req->max_len, p_req->ipi) <= max_t;
+#else
+  return used_bw + MAX(1, period / p_req->ipi) <= max_bw;
+#endif
+}
+
+#if LWB_SCHED_ADMISSION_ON && LWB_SCHED_WAITLIST_LEN > 0
+/*------------------------------------------------------------------------------------------------*/
+static waitlist_item_t* find_waitlisted(uint16_t id, lwb_stream_req_t *p_req)
+{
+  waitlist_item_t *item;
+  for (item = list_head(waitlist); item != NULL; item = item->next) {
+    if (id == item->node_id
+        && LWB_GET_STREAM_ID(p_req->req_type) == LWB_GET_STREAM_ID(item->req.req_type)) {
+      return item;
+    }
+  }
+  return NULL;
+}
+#endif /* LWB_SCHED_ADMISSION_ON && LWB_SCHED_WAITLIST_LEN > 0 */
+
+#if LWB_SCHED_PHASE_ON
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Pick the phase of a new stream among the rounds within its IPI, the one with the fewest
+///        streams of the same IPI
+/// @return Phase in seconds, below ipi
+static uint16_t get_spread_phase(uint16_t ipi)
+{
+  lwb_stream_info_t *crr_stream;
+  uint16_t n_same = 0;
+  uint16_t n_phases;
+  uint16_t n_in_phase;
+  uint16_t best_n = 0xffff;
+  uint16_t best = 0;
+  uint16_t k;
+
+  for (crr_stream = list_head(streams_list); crr_stream != NULL; crr_stream = crr_stream->next) {
+    if (crr_stream->ipi == ipi) {
+      n_same++;
+    }
+  }
+  /* One of the first n_same + 1 rounds is free of streams of the same IPI if there are as many */
+  n_phases = MIN(MAX(1, ipi / period), n_same + 1);
+
+  for (k = 0; k < n_phases && best_n > 0; k++) {
+    n_in_phase = 0;
+    for (crr_stream = list_head(streams_list); crr_stream != NULL; crr_stream = crr_stream->next) {
+      if (crr_stream->ipi == ipi && (crr_stream->next_ready % ipi) / period == k) {
+        n_in_phase++;
+      }
+    }
+    if (n_in_phase < best_n) {
+      best_n = n_in_phase;
+      best = k * period;
+    }
+  }
+  return best;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Get the time of the first slot of a new stream, the first one after the current round
+///        with the requested phase
+static uint32_t get_first_ready(lwb_stream_req_t *p_req)
+{
+  uint32_t t = lwb_context.time + period;
+  uint16_t phase = (p_req->time_info == LWB_STREAM_PHASE_ANY) ?
+                   get_spread_phase(p_req->ipi) : p_req->time_info % p_req->ipi;
+  return t + (phase + p_req->ipi - t % p_req->ipi) % p_req->ipi;
+}
+#endif /* LWB_SCHED_PHASE_ON */
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Mark a stream as served in the current round
+static inline void stream_assigned(lwb_stream_info_t *stream)
+{
+#if LWB_SCHED_PHASE_ON
+  if (STREAM_IS_DUE(stream)) {
+    stream->next_ready += (uint32_t)STREAM_N_DUE(stream) * stream->ipi;
+  }
+#endif
+  stream->n_allocated++;
+  stream->last_assigned = lwb_context.time;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @return One of lwb_stream_result_t
+static uint8_t add_stream(uint16_t from_node_id, lwb_stream_req_t *p_req)
+{
+#if LWB_SHORT_ADDR_ON
+  uint8_t short_addr;
+#endif
 
   lwb_stream_info_t *crr_stream;
   for (crr_stream = list_head(streams_list); crr_stream != NULL; crr_stream = crr_stream->next) {
@@ -96,30 +357,78 @@ static void inline add_stream(uint16_t from_node_id, lwb_stream_req_t *p_req)
       PRINTF("SREQ duplicate: node %"PRIu16", id %"PRIu8", ipi %"PRIu16"\n",
              from_node_id, LWB_GET_STREAM_ID(p_req->req_type), p_req->ipi);
       LWB_STATS_SCHED(n_duplicates)++;
-      return;
+      return LWB_STREAM_ADMITTED;
     }
   }
 
-  if (used_bw + MAX(1, period / p_req->ipi) > max_bw) {
-    /* Cannot support stream due to bandwidth limit. Drop it */
+#if LWB_SCHED_ADMISSION_ON && LWB_SCHED_WAITLIST_LEN > 0
+  if (find_waitlisted(from_node_id, p_req)) {
+    LWB_STATS_SCHED(n_duplicates)++;
+    return LWB_STREAM_WAITLISTED;
+  }
+#endif
+
+  if (!stream_fits(p_req)) {
+#if LWB_SLOT_CLASSES_ON
+    PRINTF("SREQ BW limit: used %"PRIu32", max %"PRIu32", need %"PRIu32", node %"PRIu16", id %"PRIu8", ipi %"PRIu16"\n",
+           used_t, max_t, get_stream_t(p_req->max_len, p_req->ipi), from_node_id,
+           LWB_GET_STREAM_ID(p_req->req_type), p_req->ipi);
+#else
     PRINTF("SREQ BW limit: used %"PRIu16", max %"PRIu16", node %"PRIu16", id %"PRIu8", ipi %"PRIu16"\n",
            used_bw, max_bw, from_node_id, LWB_GET_STREAM_ID(p_req->req_type), p_req->ipi);
-    return;
+#endif
+#if LWB_SCHED_ADMISSION_ON && LWB_SCHED_WAITLIST_LEN > 0
+    /* Keep it until bandwidth frees up */
+    waitlist_item_t *item = memb_alloc(&waitlist_memb);
+    if (item) {
+      item->node_id = from_node_id;
+      memcpy(&item->req, p_req, sizeof(lwb_stream_req_t));
+      list_add(waitlist, item);
+      LWB_STATS_SCHED(n_waitlisted)++;
+      return LWB_STREAM_WAITLISTED;
+    }
+#endif
+#if LWB_SCHED_ADMISSION_ON
+    LWB_STATS_SCHED(n_rejected)++;
+#endif
+    /* Cannot support stream due to bandwidth limit. Drop it */
+    return LWB_STREAM_REJECTED;
   }
 
   crr_stream = memb_alloc(&streams_memb);
   if (!crr_stream) {
     LWB_STATS_SCHED(n_no_space)++;
-    return;
+    return LWB_STREAM_REJECTED;
+  }
+
+#if LWB_SHORT_ADDR_ON
+  /* Only admitted nodes take an address */
+  short_addr = alloc_short_addr(from_node_id);
+  if (short_addr == 0) {
+    memb_free(&streams_memb, crr_stream);
+    LWB_STATS_SCHED(n_no_space)++;
+    return LWB_STREAM_REJECTED;
   }
+#endif
 
   memset(crr_stream, 0, sizeof(lwb_stream_info_t));
   crr_stream->node_id = from_node_id;
+#if LWB_SHORT_ADDR_ON
+  crr_stream->short_addr = short_addr;
+#endif
   crr_stream->ipi = p_req->ipi;
   crr_stream->last_assigned = lwb_context.time;
+#if LWB_SCHED_PHASE_ON
+  crr_stream->next_ready = get_first_ready(p_req);
+#else
   crr_stream->next_ready = p_req->time_info;
+#endif
   crr_stream->stream_id = LWB_GET_STREAM_ID(p_req->req_type);
   crr_stream->avg_max_qlen = LWB_SCHED_DEFAULT_AVG_MAX_QLEN;
+#if LWB_SLOT_CLASSES_ON
+  crr_stream->max_len = p_req->max_len;
+  used_t += get_stream_t(p_req->max_len, p_req->ipi);
+#endif
 
   list_add(streams_list, crr_stream);
   n_streams++;
@@ -131,6 +440,7 @@ static void inline add_stream(uint16_t from_node_id, lwb_stream_req_t *p_req)
   PRINTF("SREQ added: used %"PRIu16", max %"PRIu16", node %"PRIu16", id %"PRIu8", ipi %"PRIu16"\n",
          used_bw, max_bw, from_node_id, LWB_GET_STREAM_ID(p_req->req_type), p_req->ipi);
 
+  return LWB_STREAM_ADMITTED;
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -141,6 +451,9 @@ static void del_stream_ex(lwb_stream_info_t *stream)
   }
 
   used_bw -= MAX(1, period / stream->ipi);
+#if LWB_SLOT_CLASSES_ON
+  used_t -= get_stream_t(stream->max_len, stream->ipi);
+#endif
   PRINTF("SREQ deleted: used %"PRIu16", max %"PRIu16", node %"PRIu16", id %"PRIu8", ipi %"PRIu16"\n",
          used_bw, max_bw, stream->node_id, stream->stream_id, stream->ipi);
 
@@ -149,30 +462,220 @@ static void del_stream_ex(lwb_stream_info_t *stream)
   n_streams--;
 }
 
+/*------------------------------------------------------------------------------------------------*/
+static inline lwb_stream_info_t* find_stream(uint16_t id, lwb_stream_req_t *p_req)
+{
+  lwb_stream_info_t *crr_stream;
+  for (crr_stream = list_head(streams_list); crr_stream != NULL; crr_stream = crr_stream->next) {
+    if ((id == crr_stream->node_id)
+        && (LWB_GET_STREAM_ID(p_req->req_type) == crr_stream->stream_id)) {
+      return crr_stream;
+    }
+  }
+  return NULL;
+}
+
 /*------------------------------------------------------------------------------------------------*/
 static inline void del_stream(uint16_t id, lwb_stream_req_t *p_req)
 {
-  lwb_stream_info_t *prev_stream;
-  for (prev_stream = list_head(streams_list); prev_stream != NULL;
-       prev_stream = prev_stream->next) {
+#if LWB_SCHED_ADMISSION_ON && LWB_SCHED_WAITLIST_LEN > 0
+  waitlist_item_t *item = find_waitlisted(id, p_req);
+  if (item) {
+    list_remove(waitlist, item);
+    memb_free(&waitlist_memb, item);
+  }
+#endif
+  del_stream_ex(find_stream(id, p_req));
+}
 
-    if ((id == prev_stream->node_id)
-        && (LWB_GET_STREAM_ID(p_req->req_type) == prev_stream->stream_id)) {
-      del_stream_ex(prev_stream);
+#if LWB_SCHED_ADMISSION_ON && LWB_SCHED_WAITLIST_LEN > 0
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Admit the waitlisted streams that fit now, oldest first, and tell their sources
+static void admit_waitlisted(void)
+{
+  waitlist_item_t *item;
+  waitlist_item_t *next;
+  for (item = list_head(waitlist); item != NULL; item = next) {
+    next = item->next;
+    if (lwb_context.n_stream_acks == LWB_SCHED_MAX_SLOTS) {
+      /* No room to tell the source. Try again in the next round */
       return;
     }
+    if (!stream_fits(&item->req)) {
+      /* A smaller stream further back may still fit */
+      continue;
+    }
+    list_remove(waitlist, item);
+    add_stream_ack(item->node_id, LWB_GET_STREAM_ID(item->req.req_type),
+                   add_stream(item->node_id, &item->req));
+    memb_free(&waitlist_memb, item);
+  }
+}
+#endif /* LWB_SCHED_ADMISSION_ON && LWB_SCHED_WAITLIST_LEN > 0 */
+#if LWB_SCHED_ACKS_ON
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Drop the slot of the stream acknowledgements if they fit into the schedule packet
+/// @return Number of data slots of the schedule
+static uint8_t remove_ack_slot(lwb_schedule_t* p_sched, uint8_t n_slots)
+{
+  /* Without acknowledgements, a first slot of the host is one for its own packets */
+  if (LWB_N_HOST_ACKS() == 0 || n_slots == 0 || n_crr_sched_strms == 0 || crr_sched_strms[0] != NULL
+      || p_sched->slots[0] != 0) {
+    return n_slots;
+  }
+
+  memmove(&p_sched->slots[0], &p_sched->slots[1], (n_slots - 1) * sizeof(p_sched->slots[0]));
+#if LWB_SLOT_CLASSES_ON
+  memmove(&p_sched->slot_cfgs[0], &p_sched->slot_cfgs[1], n_slots - 1);
+#endif
+  LWB_SET_N_DATA_SLOTS(p_sched->sched_info.n_slots, (n_slots - 1));
+
+  if (sizeof(lwb_sched_info_t) + lwb_sched_get_compressed_len(p_sched)
+      + lwb_g_rr_get_stream_acks_len() > LWB_PKT_DATA_LEN_MAX()) {
+    /* They do not fit. Keep the slot */
+    memmove(&p_sched->slots[1], &p_sched->slots[0], (n_slots - 1) * sizeof(p_sched->slots[0]));
+    p_sched->slots[0] = 0;
+#if LWB_SLOT_CLASSES_ON
+    memmove(&p_sched->slot_cfgs[1], &p_sched->slot_cfgs[0], n_slots - 1);
+    p_sched->slot_cfgs[0] = get_slot_cfg(NULL);
+#endif
+    LWB_SET_N_DATA_SLOTS(p_sched->sched_info.n_slots, n_slots);
+    return n_slots;
+  }
+
+  memmove(&crr_sched_strms[0], &crr_sched_strms[1],
+          (n_crr_sched_strms - 1) * sizeof(lwb_stream_info_t*));
+  n_crr_sched_strms--;
+  return n_slots - 1;
+}
+#endif /* LWB_SCHED_ACKS_ON */
+
+#if LWB_SCHED_PIN_SLOTS_ON
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Give the due streams their slots in a fixed order, shortest IPI first and in the order
+///        of the stream list among equal IPIs. Streams due in every round thus keep their slot
+///        while the stream set is unchanged, whatever streams with longer periods do. Streams due
+///        more than once get their further slots behind, round-robin.
+/// @return Number of data slots of the schedule
+static uint8_t assign_pinned_slots(lwb_schedule_t* p_sched, uint8_t n_assigned_slots)
+{
+  lwb_stream_info_t *crr_strm;
+  uint8_t n_extra[LWB_MAX_N_STREAMS];
+  uint8_t more;
+  uint8_t i;
+  uint8_t j;
+#if LWB_SLOT_CLASSES_ON
+  /* Slots are limited by the time they take rather than by their number */
+  uint8_t max_slots = LWB_SCHED_MAX_SLOTS - N_HOST_SLOTS();
+  uint32_t t_slots = T_HOST_SLOTS();
+  for (i = 0; i < n_assigned_slots; i++) {
+    t_slots += lwb_slot_len_get_t_data(0, p_sched->slot_cfgs[i]) + T_GAP;
+  }
+#else
+  uint8_t max_slots = ROUND_MAX_BW() - N_HOST_SLOTS();
+#endif
+
+  /* Sort the due streams by IPI. Insertion keeps the list order among equal IPIs */
+  n_elgble_strms = 0;
+  for (crr_strm = list_head(streams_list); crr_strm != NULL; crr_strm = crr_strm->next) {
+    if (!STREAM_IS_DUE(crr_strm)) {
+      continue;
+    }
+    for (j = n_elgble_strms; j > 0 && elgble_strms[j - 1]->ipi > crr_strm->ipi; j--) {
+      elgble_strms[j] = elgble_strms[j - 1];
+      n_extra[j] = n_extra[j - 1];
+    }
+    elgble_strms[j] = crr_strm;
+    n_extra[j] = STREAM_N_DUE(crr_strm) - 1;
+    n_elgble_strms++;
+  }
+
+  for (i = 0; i < n_elgble_strms && n_assigned_slots < max_slots; i++) {
+#if LWB_SLOT_CLASSES_ON
+    p_sched->slot_cfgs[n_assigned_slots] = get_slot_cfg(elgble_strms[i]);
+    t_slots += lwb_slot_len_get_t_data(0, p_sched->slot_cfgs[n_assigned_slots]) + T_GAP;
+    if (t_slots > ROUND_MAX_T()) {
+      /* The round is full. The remaining streams get their slots in the next rounds */
+      return n_assigned_slots;
+    }
+#endif
+#if LWB_SHORT_ADDR_ON
+    p_sched->slots[n_assigned_slots++] = elgble_strms[i]->short_addr;
+#else
+    p_sched->slots[n_assigned_slots++] = elgble_strms[i]->node_id;
+#endif
+    stream_assigned(elgble_strms[i]);
+    crr_sched_strms[n_crr_sched_strms++] = elgble_strms[i];
+  }
+
+  do {
+    more = 0;
+    for (i = 0; i < n_elgble_strms && n_assigned_slots < max_slots; i++) {
+      if (n_extra[i] == 0) {
+        continue;
+      }
+#if LWB_SLOT_CLASSES_ON
+      p_sched->slot_cfgs[n_assigned_slots] = get_slot_cfg(elgble_strms[i]);
+      t_slots += lwb_slot_len_get_t_data(0, p_sched->slot_cfgs[n_assigned_slots]) + T_GAP;
+      if (t_slots > ROUND_MAX_T()) {
+        /* The round is full. The remaining slots are lost like without pinning */
+        return n_assigned_slots;
+      }
+#endif
+#if LWB_SHORT_ADDR_ON
+      p_sched->slots[n_assigned_slots++] = elgble_strms[i]->short_addr;
+#else
+      p_sched->slots[n_assigned_slots++] = elgble_strms[i]->node_id;
+#endif
+      elgble_strms[i]->n_allocated++;
+      crr_sched_strms[n_crr_sched_strms++] = elgble_strms[i];
+      more |= --n_extra[i] > 0;
+    }
+  } while (more && n_assigned_slots < max_slots);
+
+  return n_assigned_slots;
+}
+#endif /* LWB_SCHED_PIN_SLOTS_ON */
+
+#if LWB_HOST_SLOTS_ON
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Append the slots reserved for the packets of the host behind the ones of the streams
+/// @return Number of data slots of the schedule
+static uint8_t add_host_slots(lwb_schedule_t* p_sched, uint8_t n_assigned_slots)
+{
+  uint8_t i;
+  for (i = 0; i < n_host_slots && n_assigned_slots < LWB_SCHED_MAX_SLOTS; i++) {
+    crr_sched_strms[n_crr_sched_strms++] = NULL;
+#if LWB_SLOT_CLASSES_ON
+    p_sched->slot_cfgs[n_assigned_slots] = get_slot_cfg(NULL);
+#endif
+    p_sched->slots[n_assigned_slots++] = 0;
   }
+  return n_assigned_slots;
 }
+#endif /* LWB_HOST_SLOTS_ON */
+
 /*------------------------------------------------------------------------------------------------*/
 void lwb_sched_init(void)
 {
   memb_init(&streams_memb);
   list_init(streams_list);
   n_streams = 0;
+#if LWB_SHORT_ADDR_ON
+  memset(short_addrs, 0, sizeof(short_addrs));
+#endif
+#if LWB_SCHED_ADMISSION_ON && LWB_SCHED_WAITLIST_LEN > 0
+  memb_init(&waitlist_memb);
+  list_init(waitlist);
+#endif
 
   period = LWB_SCHED_PERIOD_START;
   max_bw = MIN(LWB_SCHED_GET_MAX_BW(period, MAX_N_FREE_SLOTS), LWB_SCHED_MAX_SLOTS) ;
   used_bw = 0;
+#if LWB_SLOT_CLASSES_ON
+  max_t = LWB_SCHED_GET_MAX_T(period, MAX_N_FREE_SLOTS);
+  used_t = 0;
+#endif
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -182,7 +685,16 @@ void lwb_sched_compute_schedule(lwb_schedule_t* p_sched)
   uint8_t n_assigned_slots = 0;
   lwb_stream_info_t *crr_strm;
   lwb_stream_info_t *strm_to_remove;
+#if LWB_SCHED_ADMISSION_ON
+  uint16_t rm_node_id;
+  uint8_t rm_stream_id;
+#endif
+#if !LWB_SCHED_PIN_SLOTS_ON
   uint8_t i;
+#endif
+#if LWB_SLOT_CLASSES_ON
+  uint32_t t_slots = 0;
+#endif
 
   for (crr_strm = list_head(streams_list); crr_strm != NULL;) {
 
@@ -195,55 +707,123 @@ void lwb_sched_compute_schedule(lwb_schedule_t* p_sched)
     if (crr_strm->n_cons_missed > LWB_SCHED_N_CONS_MISSED_MAX) {
       strm_to_remove = crr_strm;
       crr_strm = crr_strm->next;
+#if LWB_SCHED_ADMISSION_ON
+      rm_node_id = strm_to_remove->node_id;
+      rm_stream_id = strm_to_remove->stream_id;
+      del_stream_ex(strm_to_remove);
+#if LWB_SHORT_ADDR_ON
+      release_short_addr(rm_node_id);
+#endif
+      /* Let the source know that its stream is gone, and with its last stream its address */
+      add_stream_ack(rm_node_id, rm_stream_id, LWB_STREAM_REJECTED);
+#else
+      /* The source is not told, so it keeps its short address */
       del_stream_ex(strm_to_remove);
+#endif
     } else {
       crr_strm = crr_strm->next;
     }
   }
 
 
+#if LWB_SCHED_ADMISSION_ON && LWB_SCHED_WAITLIST_LEN > 0
+  admit_waitlisted();
+#endif
+
   memset(crr_sched_strms, 0, sizeof(lwb_stream_info_t*) * LWB_SCHED_MAX_SLOTS);
   n_crr_sched_strms = 0;
 
+#if LWB_EVENT_SLOT_ON
+  /* Only rounds with pending events have fast event slots. Streams left out stay due */
+  t_fast_events = T_EVENT_BUDGET(lwb_g_rr_get_n_event_slots()) - T_EVENT_BUDGET(1);
+#endif
+
   /* Always have a contention slot */
   n_free_slots = MAX_N_FREE_SLOTS;
 
-  if (lwb_context.n_stream_acks > 0) {
+  if (LWB_N_HOST_ACKS() > 0) {
     /* We have stream ACKs to be sent.
      * There is no stream associated for stream AKCs
      */
     crr_sched_strms[n_crr_sched_strms++] = NULL;
+#if LWB_SLOT_CLASSES_ON
+    p_sched->slot_cfgs[n_assigned_slots] = get_slot_cfg(NULL);
+    t_slots += lwb_slot_len_get_t_data(0, p_sched->slot_cfgs[n_assigned_slots]) + T_GAP;
+#endif
     p_sched->slots[n_assigned_slots++] = 0;
   }
 
   lwb_context.time += period;
 
+#if LWB_HOST_SLOTS_ON
+  /* As many slots as the host has packets queued, up to its share of the round. The streams get
+   * the rest, the ones left out stay due and catch up later.
+   */
+  n_host_slots = MIN(lwb_g_rr_get_tx_q_size(), MAX(1, max_bw * LWB_HOST_SLOTS_SHARE / 100));
+#if LWB_SLOT_CLASSES_ON
+  t_slots += T_HOST_SLOTS();
+#endif
+#endif /* LWB_HOST_SLOTS_ON */
+
+#if LWB_SCHED_PIN_SLOTS_ON
+  n_assigned_slots = assign_pinned_slots(p_sched, n_assigned_slots);
+#else
   /* Find eligible streams */
   uint8_t tot_in_this_round = 0;
   n_elgble_strms = 0;
   for (crr_strm = list_head(streams_list); crr_strm != NULL; crr_strm = crr_strm->next) {
-    if (lwb_context.time >= crr_strm->ipi + crr_strm->last_assigned) {
-      tot_in_this_round += (uint8_t)((lwb_context.time - crr_strm->last_assigned) / crr_strm->ipi);
+    if (STREAM_IS_DUE(crr_strm)) {
+      tot_in_this_round += STREAM_N_DUE(crr_strm);
       elgble_strms[n_elgble_strms++] = crr_strm;
     }
   }
   /* Calculate the maximum number of slots we can accommodate */
-  tot_in_this_round = MIN(max_bw, (tot_in_this_round + n_assigned_slots));
+#if LWB_SLOT_CLASSES_ON
+  /* Slots are limited by the time they take rather than by their number */
+  tot_in_this_round = MIN(LWB_SCHED_MAX_SLOTS - N_HOST_SLOTS(),
+                          (tot_in_this_round + n_assigned_slots));
+#else
+  tot_in_this_round = MIN(ROUND_MAX_BW() - N_HOST_SLOTS(), (tot_in_this_round + n_assigned_slots));
+#endif
   /* Allocate slots for all eligible streams in round-robin manner */
   while (n_assigned_slots < tot_in_this_round) {
     for (i = 0; i < n_elgble_strms && n_assigned_slots < tot_in_this_round; i++) {
+#if LWB_SLOT_CLASSES_ON
+        p_sched->slot_cfgs[n_assigned_slots] = get_slot_cfg(elgble_strms[i]);
+        t_slots += lwb_slot_len_get_t_data(0, p_sched->slot_cfgs[n_assigned_slots]) + T_GAP;
+        if (t_slots > ROUND_MAX_T()) {
+          /* The round is full. The remaining streams get their slots in the next rounds */
+          tot_in_this_round = n_assigned_slots;
+          break;
+        }
+#endif
+#if LWB_SHORT_ADDR_ON
+        p_sched->slots[n_assigned_slots++] = elgble_strms[i]->short_addr;
+#else
         p_sched->slots[n_assigned_slots++] = elgble_strms[i]->node_id;
-        elgble_strms[i]->n_allocated++;
-        elgble_strms[i]->last_assigned = lwb_context.time;
+#endif
+        stream_assigned(elgble_strms[i]);
         crr_sched_strms[n_crr_sched_strms++] = elgble_strms[i];
       }
   }
+#endif /* LWB_SCHED_PIN_SLOTS_ON */
+
+#if LWB_HOST_SLOTS_ON
+  n_assigned_slots = add_host_slots(p_sched, n_assigned_slots);
+#endif
 
   if (lwb_context.time > LWB_SCHED_WAIT_TIME || n_streams == LWB_SCHED_WAIT_N_STREAMS) {
     period = LWB_SCHED_PERIOD_STEADY;
     max_bw = MIN(LWB_SCHED_GET_MAX_BW(period, MAX_N_FREE_SLOTS), LWB_SCHED_MAX_SLOTS) ;
+#if LWB_SLOT_CLASSES_ON
+    max_t = LWB_SCHED_GET_MAX_T(period, MAX_N_FREE_SLOTS);
+#endif
   }
 
+#if LWB_SCHED_ACKS_ON
+  n_assigned_slots = remove_ack_slot(p_sched, n_assigned_slots);
+#endif
+
   LWB_SET_N_FREE_SLOTS(p_sched->sched_info.n_slots, n_free_slots);
   LWB_SET_N_DATA_SLOTS(p_sched->sched_info.n_slots, n_assigned_slots);
   p_sched->sched_info.time = lwb_context.time;
@@ -255,16 +835,57 @@ void lwb_sched_compute_schedule(lwb_schedule_t* p_sched)
 /*------------------------------------------------------------------------------------------------*/
 void lwb_sched_process_stream_req(uint16_t from_node_id, lwb_stream_req_t *req)
 {
+#if LWB_SLOT_CLASSES_ON || LWB_SCHED_PHASE_ON
+  lwb_stream_info_t *stream;
+#endif
+  uint8_t stream_id = LWB_GET_STREAM_ID(req->req_type);
+  uint8_t result;
+
   switch (LWB_GET_STREAM_TYPE(req->req_type)) {
     case LWB_STREAM_TYPE_ADD:
-      add_stream(from_node_id, req);
+      /* A stream add request with an existing stream ID could happen due to the node has not
+       * received the stream acknowledgement. So we acknowledge it again. Otherwise it will keep
+       * sending stream requests.
+       */
+      add_stream_ack(from_node_id, stream_id, add_stream(from_node_id, req));
       break;
     case LWB_STREAM_TYPE_DEL:
       del_stream(from_node_id, req);
+#if LWB_STREAM_REQ_COALESCE_ON || LWB_SCHED_ADMISSION_ON
+#if LWB_SHORT_ADDR_ON
+      /* The acknowledgement tells the source whether it lost its address. Without one, the source
+       * keeps it
+       */
+      release_short_addr(from_node_id);
+#endif
+      /* Sources match acknowledgements to their pending requests, so every one of them has to be
+       * acknowledged
+       */
+      add_stream_ack(from_node_id, stream_id, LWB_STREAM_ADMITTED);
+#endif
       break;
     case LWB_STREAM_TYPE_MOD:
+#if LWB_SLOT_CLASSES_ON || LWB_SCHED_PHASE_ON
+      stream = find_stream(from_node_id, req);
+#endif
+#if LWB_SLOT_CLASSES_ON
+      if (req->max_len == 0 && stream) {
+        /* Keep the payload size the stream was added with */
+        req->max_len = stream->max_len;
+      }
+#endif
+#if LWB_SCHED_PHASE_ON
+      if (req->time_info == LWB_STREAM_PHASE_ANY && stream) {
+        /* Keep the phase the stream was added with */
+        req->time_info = stream->next_ready % stream->ipi;
+      }
+#endif
       del_stream(from_node_id, req);
-      add_stream(from_node_id, req);
+      result = add_stream(from_node_id, req);
+#if LWB_SHORT_ADDR_ON
+      release_short_addr(from_node_id);
+#endif
+      add_stream_ack(from_node_id, stream_id, result);
       break;
     default:
       break;
@@ -274,7 +895,7 @@ void lwb_sched_process_stream_req(uint16_t from_node_id, lwb_stream_req_t *req)
 /*------------------------------------------------------------------------------------------------*/
 void lwb_sched_update_data_slot_usage(uint8_t slot_index, uint8_t used)
 {
-  if (slot_index > 0 && slot_index < n_crr_sched_strms && crr_sched_strms[slot_index]) {
+  if (slot_index < n_crr_sched_strms && crr_sched_strms[slot_index]) {
     if (used) {
       crr_sched_strms[slot_index]->n_used++;
       crr_sched_strms[slot_index]->n_cons_missed = 0;
@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2026, Uppsala University, Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// @file lwb-slot-len.c
+/// @brief Slot lengths derived from the network diameter estimated by the host and from the
+///        payload size of the streams.
+///
+/// The host learns the hop distance of the nodes from the relay counter of the floods it receives
+/// and from the relay counter of the schedule reception that sources report in their data headers.
+/// Any two nodes are at most as far apart as the sum of their distances to the host, so the sum of
+/// the two largest distances of a round is used as the diameter estimate of that round. The maximum
+/// over a window of rounds plus a margin is announced in the schedule and both the host and the
+/// sources derive the flood durations from it. If a round reveals a larger diameter than the
+/// announced one, the host falls back to the maximum slot lengths for a few rounds.
+///
+/// With slot classes, every data slot has a duration class, derived from the largest payload the
+/// streams of the slot owner declared, and its own N_TX. Both are announced in the schedule.
+
+#include <string.h>
+
+#include "contiki.h"
+#include "glossy.h"
+#include "lwb-common.h"
+#include "lwb-macros.h"
+#include "lwb-slot-len.h"
+
+#if LWB_DYN_SLOT_LEN_ON || LWB_SLOT_CLASSES_ON
+
+#if LWB_DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/// @brief The relay counter of Glossy is reported in a nibble
+#define N_HOPS_MAX  0x0f
+
+extern lwb_context_t lwb_context;
+
+/*------------------------------------------------------------------------------------------------*/
+static rtimer_clock_t get_t_flood(uint8_t payload_len, uint8_t n_hops, uint8_t n_tx_max,
+                                  rtimer_clock_t t_max)
+{
+  rtimer_clock_t t;
+
+  payload_len = MIN(payload_len, glossy_get_max_payload_len(lwb_context.enc));
+  /* The flood starts T_FLOOD_REF after the start of the slot */
+  t = T_FLOOD_REF + glossy_get_flood_duration(payload_len, n_hops, n_tx_max, lwb_context.enc)
+      + T_DYN_SLOT_LEN_MARGIN;
+
+  return MIN(t, t_max);
+}
+
+#if LWB_DYN_SLOT_LEN_ON
+/// @brief Diameter estimates of the last rounds
+static uint8_t diameters[LWB_DYN_SLOT_LEN_WINDOW_SIZE];
+static uint8_t diameter_idx;
+
+/// @brief The largest hop distance in the current round and the node it belongs to
+static uint8_t n_hops_max;
+static uint16_t n_hops_max_id;
+/// @brief The largest hop distance of any other node in the current round
+static uint8_t n_hops_max_2nd;
+
+/// @brief Number of rounds left with the maximum slot lengths
+static uint8_t n_fallback_rounds;
+/// @brief Diameter announced in the last schedule
+static uint8_t n_hops_announced;
+
+/// @brief Durations for the last requested diameters, to avoid recalculating them at every slot
+static uint8_t t_sync_n_hops;
+static rtimer_clock_t t_sync;
+static uint8_t t_rr_n_hops;
+static rtimer_clock_t t_rr;
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_slot_len_init()
+{
+  memset(diameters, 0, sizeof(diameters));
+  diameter_idx = 0;
+  n_hops_max = 0;
+  n_hops_max_id = 0;
+  n_hops_max_2nd = 0;
+  n_fallback_rounds = 0;
+  n_hops_announced = 0;
+  t_sync_n_hops = 0;
+  t_sync = T_SYNC_ON;
+  t_rr_n_hops = 0;
+  t_rr = T_RR_ON;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_slot_len_add_n_hops(uint16_t id, uint8_t n_hops)
+{
+  if (n_hops == 0) {
+    return;
+  }
+
+  if (id == n_hops_max_id) {
+    n_hops_max = MAX(n_hops_max, n_hops);
+  } else if (n_hops > n_hops_max) {
+    n_hops_max_2nd = n_hops_max;
+    n_hops_max = n_hops;
+    n_hops_max_id = id;
+  } else if (n_hops > n_hops_max_2nd) {
+    n_hops_max_2nd = n_hops;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_slot_len_compute_n_hops()
+{
+  uint8_t diameter = MIN(n_hops_max + n_hops_max_2nd, N_HOPS_MAX);
+  uint8_t n_hops = 0;
+  uint8_t i;
+
+  if (n_hops_announced > 0 && diameter > n_hops_announced) {
+    /* The slots of this round were too short. Go back to the maximum immediately */
+    n_fallback_rounds = LWB_DYN_SLOT_LEN_FALLBACK_ROUNDS;
+    LWB_STATS_SCHED(n_slot_len_fallbacks)++;
+    PRINTF("diameter %u exceeds %u\r\n", diameter, n_hops_announced);
+  }
+
+  diameters[diameter_idx] = diameter;
+  diameter_idx = (diameter_idx + 1) % LWB_DYN_SLOT_LEN_WINDOW_SIZE;
+
+  n_hops_max = 0;
+  n_hops_max_id = 0;
+  n_hops_max_2nd = 0;
+
+  for (i = 0; i < LWB_DYN_SLOT_LEN_WINDOW_SIZE; i++) {
+    n_hops = MAX(n_hops, diameters[i]);
+  }
+
+  if (n_fallback_rounds > 0) {
+    n_fallback_rounds--;
+    n_hops_announced = 0;
+  } else if (n_hops == 0) {
+    /* Nothing heard yet */
+    n_hops_announced = 0;
+  } else {
+    n_hops_announced = MIN(n_hops + LWB_DYN_SLOT_LEN_HOP_MARGIN, N_HOPS_MAX);
+  }
+
+  return n_hops_announced;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+rtimer_clock_t lwb_slot_len_get_t_sync(uint8_t n_hops)
+{
+  if (n_hops == 0) {
+    return T_SYNC_ON;
+  }
+
+  if (n_hops != t_sync_n_hops) {
+    t_sync = get_t_flood(LWB_MAX_TXRX_BUF_LEN, n_hops, N_SYNC, T_SYNC_ON);
+    t_sync_n_hops = n_hops;
+  }
+  return t_sync;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+rtimer_clock_t lwb_slot_len_get_t_rr(uint8_t n_hops)
+{
+  if (n_hops == 0) {
+    return T_RR_ON;
+  }
+
+  if (n_hops != t_rr_n_hops) {
+    t_rr = get_t_flood(LWB_DYN_SLOT_LEN_MAX_PAYLOAD, n_hops, N_RR, T_RR_ON);
+    t_rr_n_hops = n_hops;
+  }
+  return t_rr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+rtimer_clock_t lwb_slot_len_get_t_sync_listen(uint8_t n_hops)
+{
+  if (n_hops == 0) {
+    return T_SYNC_ON;
+  }
+
+  /* Called once per round, not worth a cache */
+  return get_t_flood(LWB_MAX_TXRX_BUF_LEN, MIN(n_hops + LWB_DYN_SLOT_LEN_HOP_MARGIN, N_HOPS_MAX),
+                     N_SYNC, T_SYNC_ON);
+}
+#endif /* LWB_DYN_SLOT_LEN_ON */
+
+#if LWB_SLOT_CLASSES_ON
+#if N_RR > LWB_SLOT_N_TX_MAX
+#error "N_RR does not fit into the data slot configuration"
+#endif
+
+/// @brief Largest application payload of each duration class
+static const uint8_t class_lens[LWB_SLOT_CLASS_MAX] = {
+  LWB_SLOT_CLASS_0_LEN, LWB_SLOT_CLASS_1_LEN, LWB_SLOT_CLASS_2_LEN
+};
+
+/// @brief Durations of the data slot configurations for the last two requested diameters. The
+///        scheduler asks for diameter zero, the rounds for the announced one.
+#define T_DATA_N_CACHED 2
+static uint8_t t_data_n_hops[T_DATA_N_CACHED] = { 0xff, 0xff };
+static rtimer_clock_t t_data[T_DATA_N_CACHED][1 << 4];
+/// @brief Cache entry replaced next
+static uint8_t t_data_victim;
+
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_slot_len_get_class(uint8_t max_len)
+{
+  uint8_t i;
+
+  if (max_len == 0) {
+    return LWB_SLOT_CLASS_MAX;
+  }
+
+  for (i = 0; i < LWB_SLOT_CLASS_MAX; i++) {
+    if (max_len <= class_lens[i]) {
+      return i;
+    }
+  }
+  return LWB_SLOT_CLASS_MAX;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_slot_len_get_class_len(uint8_t slot_class)
+{
+  if (slot_class >= LWB_SLOT_CLASS_MAX) {
+    return LWB_PKT_APP_DATA_LEN_MAX();
+  }
+  return MIN(class_lens[slot_class], LWB_PKT_APP_DATA_LEN_MAX());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static uint8_t get_implicit_n_hops()
+{
+  /* The number of hops a flood of the largest packet with N_RR transmissions can travel in T_RR_ON */
+  rtimer_clock_t T_slot = glossy_get_flood_duration(LWB_MAX_TXRX_BUF_LEN, 1, 0, lwb_context.enc);
+  uint8_t n_slots = T_RR_ON / T_slot;
+
+  return n_slots > 2 * N_RR ? n_slots - 2 * N_RR : 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+rtimer_clock_t lwb_slot_len_get_t_data(uint8_t n_hops, uint8_t slot_cfg)
+{
+  rtimer_clock_t* t;
+  uint8_t i;
+
+  slot_cfg &= 0x0f;
+
+  for (i = 0; i < T_DATA_N_CACHED && t_data_n_hops[i] != n_hops; i++);
+  if (i == T_DATA_N_CACHED) {
+    i = t_data_victim;
+    t_data_victim = (t_data_victim + 1) % T_DATA_N_CACHED;
+    memset(t_data[i], 0, sizeof(t_data[i]));
+    t_data_n_hops[i] = n_hops;
+  }
+  t = t_data[i];
+
+  if (t[slot_cfg] == 0) {
+    uint8_t slot_class = LWB_SLOT_CFG_GET_CLASS(slot_cfg);
+    uint8_t payload_len = slot_class == LWB_SLOT_CLASS_MAX ? LWB_MAX_TXRX_BUF_LEN
+                          : class_lens[slot_class] + sizeof(lwb_pkt_header_t) + sizeof(data_air_header_t);
+
+    /* Slots never get longer than T_RR_ON since the scheduler admits streams against it */
+    t[slot_cfg] = get_t_flood(payload_len, n_hops ? n_hops : get_implicit_n_hops(),
+                              LWB_SLOT_CFG_GET_N_TX(slot_cfg), T_RR_ON);
+  }
+  return t[slot_cfg];
+}
+#endif /* LWB_SLOT_CLASSES_ON */
+
+#endif /* LWB_DYN_SLOT_LEN_ON || LWB_SLOT_CLASSES_ON */
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2026, Uppsala University, Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __LWB_SLOT_LEN_H__
+#define __LWB_SLOT_LEN_H__
+
+/// @file lwb-slot-len.h
+/// @brief Slot lengths derived from the network diameter estimated by the host and from the
+///        payload size of the streams.
+
+#include "contiki.h"
+#include "lwb-common.h"
+
+#if LWB_DYN_SLOT_LEN_ON
+
+void lwb_slot_len_init();
+
+/// @brief Record the hop distance between the host and a node (host only).
+/// @param id     Node ID
+/// @param n_hops Hop distance. Zero values are ignored.
+void lwb_slot_len_add_n_hops(uint16_t id, uint8_t n_hops);
+
+/// @brief Close the observations of the current round and compute the diameter to be announced in
+///        the next schedule (host only).
+/// @return Diameter in hops, including the margin. Zero means that the maximum slot lengths are used.
+uint8_t lwb_slot_len_compute_n_hops();
+
+/// @brief Get the Glossy duration of the schedule flood for an announced diameter.
+rtimer_clock_t lwb_slot_len_get_t_sync(uint8_t n_hops);
+
+/// @brief Get the Glossy duration of a data slot for an announced diameter.
+rtimer_clock_t lwb_slot_len_get_t_rr(uint8_t n_hops);
+
+/// @brief Get how long a source listens for the next schedule flood.
+/// @param n_hops Diameter announced in the last received schedule. The next schedule may announce
+///               up to LWB_DYN_SLOT_LEN_HOP_MARGIN more hops. Larger increases go back to zero.
+rtimer_clock_t lwb_slot_len_get_t_sync_listen(uint8_t n_hops);
+
+#endif /* LWB_DYN_SLOT_LEN_ON */
+
+#if LWB_SLOT_CLASSES_ON
+
+/// @brief Get the smallest duration class that fits an application payload.
+/// @param max_len Maximum application payload. Zero selects the largest class.
+uint8_t lwb_slot_len_get_class(uint8_t max_len);
+
+/// @brief Get the largest application payload, including piggybacked stream requests, that fits
+///        in a slot of the given duration class.
+uint8_t lwb_slot_len_get_class_len(uint8_t slot_class);
+
+/// @brief Get the Glossy duration of a data slot.
+/// @param n_hops   Announced diameter. Zero if unknown, in which case the diameter T_RR_ON is sized
+///                 for is assumed.
+/// @param slot_cfg Duration class and N_TX of the slot. @see LWB_SLOT_CFG
+rtimer_clock_t lwb_slot_len_get_t_data(uint8_t n_hops, uint8_t slot_cfg);
+
+#endif /* LWB_SLOT_CLASSES_ON */
+
+#endif /* __LWB_SLOT_LEN_H__ */
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2026, Uppsala University, Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// @file lwb-time.c
+/// @brief Network time service.
+///
+/// The network time is the rtimer time of the host since it started. Every schedule carries the
+/// host time of its round in seconds and every node knows when the host sent it in its own rtimer
+/// time, so that pair is the reference to convert local times. Sources correct the time elapsed
+/// since the reference with the clock skew estimated by the synchronization. The error grows with
+/// the time since the last received schedule, by the residual of the skew measured at the last
+/// received schedule.
+///
+/// Timed callbacks sleep on a ctimer and wait for the rest on the rtimer. Contiki has a single
+/// rtimer, which LWB keeps busy, so LWB sets it through lwb_time_rtimer_set() and the callback
+/// borrows it while it is due before the next wake-up of LWB.
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "contiki.h"
+#include "cpu.h"
+#include "glossy.h"
+#include "lwb-common.h"
+#include "lwb-macros.h"
+#include "lwb.h"
+#include "lwb-time.h"
+
+#if LWB_NET_TIME_ON
+
+#if LWB_DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+extern lwb_context_t lwb_context;
+
+/// @brief Host time of the last schedule in seconds
+static uint32_t ref_time;
+/// @brief Local rtimer time at which the host sent the last schedule
+static rtimer_clock_t t_ref;
+/// @brief A reference has been set since LWB started
+static uint8_t ref_valid;
+/// @brief Skew estimate when the reference was set
+static int32_t ref_skew;
+
+/// @brief Host time in seconds and local rtimer time of the last received schedule (source only)
+static uint32_t rx_ref_time;
+static rtimer_clock_t t_rx_ref;
+static uint8_t rx_ref_valid;
+/// @brief Error of the skew in ticks per second, measured at the last received schedule
+static uint32_t skew_err;
+static uint8_t skew_err_valid;
+
+/// @brief Timestamp of the packet being delivered to the application
+static rtimer_clock_t t_rx_current;
+static uint8_t rx_current_valid;
+
+/// @brief Pending timed callback
+static struct ctimer cb_timer;
+static lwb_net_time_t cb_time;
+static void (*cb_func)(void*);
+static void* cb_ptr;
+
+/// @brief Last stage of the timed callback on the rtimer
+static struct rtimer cb_rt;
+static rtimer_clock_t t_cb_rt;
+static uint8_t cb_rt_pending;
+
+/// @brief Next wake-up of LWB
+static struct rtimer* lwb_rt;
+static rtimer_callback_t lwb_rt_func;
+static void* lwb_rt_ptr;
+static uint8_t lwb_rt_pending;
+
+/*------------------------------------------------------------------------------------------------*/
+static inline uint8_t is_synced()
+{
+  return ref_valid && (lwb_context.lwb_mode == LWB_MODE_HOST
+                       || lwb_context.sync_state != LWB_SYNC_STATE_BOOTSTRAP);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Convert a local time within 2^31 ticks (18 hours) of the reference
+static lwb_net_time_t rtimer_to_net_time(rtimer_clock_t t)
+{
+  int64_t t_elapsed = (int32_t)(t - t_ref);
+  /* The local clock gains skew ticks per second of the host */
+  t_elapsed -= (t_elapsed * lwb_context.skew) / RTIMER_SECOND;
+  return (lwb_net_time_t)((int64_t)ref_time * RTIMER_SECOND + t_elapsed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static lwb_status_t net_time_to_rtimer(lwb_net_time_t nt, rtimer_clock_t* t)
+{
+  int64_t t_elapsed = (int64_t)(nt - (lwb_net_time_t)ref_time * RTIMER_SECOND);
+  t_elapsed += (t_elapsed * lwb_context.skew) / RTIMER_SECOND;
+  if (t_elapsed > INT32_MAX || t_elapsed < INT32_MIN) {
+    return LWB_STATUS_FAIL;
+  }
+  *t = t_ref + (rtimer_clock_t)(int32_t)t_elapsed;
+  return LWB_STATUS_SUCCESS;
+}
+
+static void cb_rt_expired(struct rtimer* rt, void* ptr);
+
+/*------------------------------------------------------------------------------------------------*/
+static void lwb_rt_expired(struct rtimer* rt, void* ptr)
+{
+  lwb_rt_pending = 0;
+  lwb_rt_func(rt, lwb_rt_ptr);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Give the rtimer to the timed callback if it is due before the next wake-up of LWB, to
+///        LWB otherwise
+static void arm_rtimer()
+{
+  if (cb_rt_pending && (!lwb_rt_pending || (int32_t)(t_cb_rt - lwb_rt->time) < 0)) {
+    rtimer_set(&cb_rt, t_cb_rt, 0, cb_rt_expired, NULL);
+  } else if (lwb_rt_pending) {
+    rtimer_set(lwb_rt, lwb_rt->time, 0, lwb_rt_expired, NULL);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Called in the rtimer interrupt at the deadline of the timed callback
+static void cb_rt_expired(struct rtimer* rt, void* ptr)
+{
+  void (*func)(void*);
+
+  cb_rt_pending = 0;
+  /* Hand the rtimer back before the callback, LWB may be due soon */
+  arm_rtimer();
+
+  func = cb_func;
+  cb_func = NULL;
+  if (func) {
+    func(cb_ptr);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_time_rtimer_set(struct rtimer* rt, rtimer_clock_t t, rtimer_callback_t func, void* ptr)
+{
+  rt->time = t;
+  lwb_rt = rt;
+  lwb_rt_func = func;
+  lwb_rt_ptr = ptr;
+  lwb_rt_pending = 1;
+  arm_rtimer();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Stop the last stage of the timed callback. Called from a process.
+static void cb_rt_stop()
+{
+  INTERRUPTS_DISABLE();
+  if (cb_rt_pending) {
+    cb_rt_pending = 0;
+    arm_rtimer();
+  }
+  INTERRUPTS_ENABLE();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_time_init()
+{
+  ctimer_stop(&cb_timer);
+  cb_rt_stop();
+  cb_func = NULL;
+  ref_valid = 0;
+  rx_ref_valid = 0;
+  skew_err_valid = 0;
+  rx_current_valid = 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_time_set_ref(uint32_t time, rtimer_clock_t t, uint8_t received)
+{
+  uint32_t dt;
+  int32_t err;
+
+  if (received) {
+    if (rx_ref_valid && time != rx_ref_time) {
+      /* Compare with the prediction of the last received schedule and the skew known then */
+      dt = time - rx_ref_time;
+      err = (int32_t)(t - (t_rx_ref + dt * RTIMER_SECOND + (int32_t)dt * ref_skew));
+      if (err < 0) {
+        err = -err;
+      }
+      /* The skew has a resolution of one tick per second */
+      skew_err = MAX(1, ((uint32_t)err + dt - 1) / dt);
+      skew_err_valid = 1;
+    }
+    rx_ref_time = time;
+    t_rx_ref = t;
+    rx_ref_valid = 1;
+  }
+
+  ref_time = time;
+  t_ref = t;
+  ref_skew = lwb_context.skew;
+  ref_valid = 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_time_set_rx(uint8_t valid, rtimer_clock_t t_rx)
+{
+  rx_current_valid = valid;
+  t_rx_current = t_rx;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+lwb_status_t lwb_get_net_time(lwb_net_time_t* nt)
+{
+  return lwb_net_time_from_rtimer(RTIMER_NOW(), nt);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+lwb_status_t lwb_net_time_from_rtimer(rtimer_clock_t t, lwb_net_time_t* nt)
+{
+  if (!is_synced()) {
+    return LWB_STATUS_FAIL;
+  }
+  *nt = rtimer_to_net_time(t);
+  return LWB_STATUS_SUCCESS;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+lwb_status_t lwb_net_time_from_mac_time(uint64_t t_mt, lwb_net_time_t* nt)
+{
+  return lwb_net_time_from_rtimer(glossy_mac_time_to_rtimer(t_mt), nt);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+lwb_status_t lwb_net_time_to_rtimer(lwb_net_time_t nt, rtimer_clock_t* t)
+{
+  if (!is_synced()) {
+    return LWB_STATUS_FAIL;
+  }
+  return net_time_to_rtimer(nt, t);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+rtimer_clock_t lwb_get_net_time_error()
+{
+  if (!is_synced()) {
+    return LWB_NET_TIME_UNSYNCED;
+  }
+  if (lwb_context.lwb_mode == LWB_MODE_HOST) {
+    return 0;
+  }
+  if (!skew_err_valid) {
+    /* Nothing measured yet. The guard time covers the uncertainty of the next schedule */
+    return lwb_context.t_sync_guard;
+  }
+  /* The reference is as good as the timestamp of the schedule, one tick */
+  return 1 + (rtimer_clock_t)(((uint64_t)(rtimer_clock_t)(RTIMER_NOW() - t_rx_ref) * skew_err
+                               + RTIMER_SECOND - 1) / RTIMER_SECOND);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+lwb_status_t lwb_get_rx_net_time(lwb_net_time_t* nt)
+{
+  if (!rx_current_valid) {
+    return LWB_STATUS_FAIL;
+  }
+  return lwb_net_time_from_rtimer(t_rx_current, nt);
+}
+
+static void cb_timer_expired(void* ptr);
+
+/*------------------------------------------------------------------------------------------------*/
+/// @brief Sleep until at most T_NET_TIME_RTIMER before the deadline, t_wait rtimer ticks from now.
+///        The clock runs at CLOCK_SECOND, the rest is waited on the rtimer.
+static void set_cb_timer(int32_t t_wait)
+{
+  clock_time_t t_sleep = 0;
+  if (t_wait > (int32_t)T_NET_TIME_RTIMER) {
+    t_sleep = (clock_time_t)(((uint64_t)(t_wait - T_NET_TIME_RTIMER) * CLOCK_SECOND) / RTIMER_SECOND);
+  }
+  ctimer_set(&cb_timer, t_sleep, cb_timer_expired, NULL);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void cb_timer_expired(void* ptr)
+{
+  rtimer_clock_t t;
+  int32_t t_wait;
+  void (*func)(void*);
+
+  /* The reference may have moved on since the callback was scheduled, so convert again. Without
+   * synchronization, the last reference is still the best guess.
+   */
+  if (net_time_to_rtimer(cb_time, &t) != LWB_STATUS_SUCCESS) {
+    cb_func = NULL;
+    return;
+  }
+
+  t_wait = (int32_t)(t - RTIMER_NOW());
+  if (t_wait > (int32_t)T_NET_TIME_RTIMER) {
+    /* Woken up too early, e.g. the skew estimate has changed */
+    set_cb_timer(t_wait);
+    return;
+  }
+
+  /* The rtimer interrupt must not change the owner of the rtimer in between */
+  INTERRUPTS_DISABLE();
+  t_cb_rt = t;
+  cb_rt_pending = 1;
+  arm_rtimer();
+  INTERRUPTS_ENABLE();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+lwb_status_t lwb_net_time_schedule(lwb_net_time_t nt, void (*func)(void*), void* ptr)
+{
+  rtimer_clock_t t;
+  int32_t t_wait;
+
+  if (func == NULL || lwb_net_time_to_rtimer(nt, &t) != LWB_STATUS_SUCCESS) {
+    return LWB_STATUS_FAIL;
+  }
+  t_wait = (int32_t)(t - RTIMER_NOW());
+  if (t_wait < 0) {
+    PRINTF("lwb-time: %"PRIi32" ticks late\n", -t_wait);
+    return LWB_STATUS_FAIL;
+  }
+
+  cb_rt_stop();
+  cb_time = nt;
+  cb_func = func;
+  cb_ptr = ptr;
+  set_cb_timer(t_wait);
+  return LWB_STATUS_SUCCESS;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+void lwb_net_time_cancel()
+{
+  ctimer_stop(&cb_timer);
+  cb_rt_stop();
+  cb_func = NULL;
+}
+
+#endif /* LWB_NET_TIME_ON */
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2026, Uppsala University, Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __LWB_TIME_H__
+#define __LWB_TIME_H__
+
+/// @file lwb-time.h
+/// @brief Network time service. The application interface is in lwb.h.
+
+#include "contiki.h"
+#include "lwb-common.h"
+
+#if LWB_NET_TIME_ON
+
+/// @brief Forget the reference of the network time and cancel a pending timed callback.
+void lwb_time_init();
+
+/// @brief Set the reference of the network time after the schedule of a round.
+/// @param time Host time of the round in seconds, as in the schedule
+/// @param t_ref Local rtimer time at which the host sent the schedule
+/// @param received Non-zero if the schedule has been received, zero if the time is only predicted
+void lwb_time_set_ref(uint32_t time, rtimer_clock_t t_ref, uint8_t received);
+
+/// @brief Set the timestamp returned by lwb_get_rx_net_time() while a packet is delivered.
+/// @param valid Zero after the packet has been delivered
+/// @param t_rx Local rtimer time of the flood that delivered the packet
+void lwb_time_set_rx(uint8_t valid, rtimer_clock_t t_rx);
+
+/// @brief Set the rtimer for the next wake-up of LWB. Same as rtimer_set(), but lets a timed
+///        callback that is due earlier use the rtimer in between.
+void lwb_time_rtimer_set(struct rtimer* rt, rtimer_clock_t t, rtimer_callback_t func, void* ptr);
+
+#endif /* LWB_NET_TIME_ON */
+
+#endif /* __LWB_TIME_H__ */
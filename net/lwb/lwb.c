@@ -45,6 +45,7 @@
 #include "lwb-g-sync.h"
 #include "lwb-g-rr.h"
 #include "lwb-scheduler.h"
+#include "lwb-time.h"
 
 PROCESS(lwb_main_process, "lwb main");
 
@@ -59,6 +60,13 @@ uint8_t lwb_init(uint8_t mode, lwb_callbacks_t *callbacks)
   LWB_DEBUG_GPIO_PIN_2_INIT();
 #endif
 
+#if LWB_COMPACT_HDR_ON
+  /* Node IDs travel in one byte. Larger IDs could neither initiate floods nor be addressed */
+  if (node_id > 0xff) {
+    return LWB_STATUS_FAIL;
+  }
+#endif /* LWB_COMPACT_HDR_ON */
+
   memset(&lwb_context, 0, sizeof(lwb_context_t));
 
   lwb_context.lwb_mode = mode;
@@ -68,6 +76,9 @@ uint8_t lwb_init(uint8_t mode, lwb_callbacks_t *callbacks)
   glossy_init();
   lwb_g_rr_init();
   lwb_g_sync_init();
+#if LWB_NET_TIME_ON
+  lwb_time_init();
+#endif /* LWB_NET_TIME_ON */
   
   init_process = PROCESS_CURRENT();
 
@@ -94,12 +105,44 @@ uint8_t lwb_queue_packet(uint8_t* data, uint8_t len, uint16_t dst_node_id)
   return lwb_g_rr_queue_packet(data, len, dst_node_id);
 }
 
+#if LWB_HOST_SLOTS_ON
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_get_tx_q_size(void)
+{
+  return lwb_g_rr_get_tx_q_size();
+}
+#endif /* LWB_HOST_SLOTS_ON */
+
+#if LWB_EVENT_SLOT_ON
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_queue_event(uint8_t* data, uint8_t len, uint16_t dst_node_id)
+{
+  return lwb_g_rr_queue_event(data, len, dst_node_id);
+}
+#endif /* LWB_EVENT_SLOT_ON */
+
+#if LWB_ONESHOT_ON
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_send_oneshot(uint8_t* data, uint8_t len, uint16_t dst_node_id)
+{
+  return lwb_g_rr_queue_oneshot(data, len, dst_node_id);
+}
+#endif /* LWB_ONESHOT_ON */
+
 /*------------------------------------------------------------------------------------------------*/
 uint8_t lwb_request_stream_add(uint16_t ipi, uint16_t t_offset)
 {
   return lwb_g_rr_stream_add(ipi, t_offset);
 }
 
+#if LWB_SLOT_CLASSES_ON
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_request_stream_add_max_len(uint16_t ipi, uint16_t t_offset, uint8_t max_len)
+{
+  return lwb_g_rr_stream_add_max_len(ipi, t_offset, max_len);
+}
+#endif /* LWB_SLOT_CLASSES_ON */
+
 /*------------------------------------------------------------------------------------------------*/
 void lwb_request_stream_del(uint8_t id)
 {
@@ -118,6 +161,14 @@ uint8_t lwb_get_n_my_slots()
   return lwb_context.n_my_slots;
 }
 
+#if LWB_SHORT_ADDR_ON
+/*------------------------------------------------------------------------------------------------*/
+uint8_t lwb_get_short_addr()
+{
+  return lwb_context.short_addr;
+}
+#endif /* LWB_SHORT_ADDR_ON */
+
 /*------------------------------------------------------------------------------------------------*/
 uint8_t lwb_get_joining_state()
 {
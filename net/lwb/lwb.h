@@ -46,7 +46,8 @@
  * @brief Initialize LWB.
  * @param mode The mode of LWB. @see lwb_mode_t
  * @param callbacks A pointer to callback functions
- * @return Non-zero if initialization is successful.
+ * @return Non-zero if initialization is successful. Fails with LWB_CONF_COMPACT_HDR if node_id
+ *         is 256 or larger.
  */
 uint8_t lwb_init(lwb_mode_t mode, lwb_callbacks_t *callbacks);
 
@@ -65,24 +66,139 @@ lwb_run_state_t lwb_get_run_state(void);
  * @brief Queue packet to be sent over LWB.
  * @param data A pointer to the data buffer.
  * @param len The length of data.
- * @param dst_node_id The ID of the destination node
+ * @param dst_node_id The ID of the destination node. Below 256 with LWB_CONF_COMPACT_HDR.
  * @return Non-zero if queuing is successful.
  */
 uint8_t lwb_queue_packet(uint8_t* data, uint8_t len, uint16_t dst_node_id);
 
+#if LWB_HOST_SLOTS_ON
+/**
+ * @brief Get the number of packets queued with lwb_queue_packet that are not sent yet.
+ */
+uint8_t lwb_get_tx_q_size(void);
+#endif /* LWB_HOST_SLOTS_ON */
+
+#if LWB_EVENT_SLOT_ON
+/**
+ * @brief Queue an urgent message to be sent in the next event slot.
+ *        The message is kept until the host acknowledges it. Only sources can send events.
+ * @param data A pointer to the data buffer.
+ * @param len The length of data.
+ * @param dst_node_id The ID of the destination node. Below 256 with LWB_CONF_COMPACT_HDR.
+ * @return Non-zero if queuing is successful.
+ */
+uint8_t lwb_queue_event(uint8_t* data, uint8_t len, uint16_t dst_node_id);
+#endif /* LWB_EVENT_SLOT_ON */
+
+#if LWB_ONESHOT_ON
+/**
+ * @brief Queue a single message to be sent in the contention slot, without a stream.
+ *        The message is kept until the host acknowledges it in one of the next rounds. Only
+ *        sources can send one-shot messages.
+ * @param data A pointer to the data buffer.
+ * @param len The length of data.
+ * @param dst_node_id The ID of the destination node. Below 256 with LWB_CONF_COMPACT_HDR.
+ * @return Non-zero if queuing is successful.
+ */
+uint8_t lwb_send_oneshot(uint8_t* data, uint8_t len, uint16_t dst_node_id);
+#endif /* LWB_ONESHOT_ON */
+
 /**
  * @brief Get the time of LWB in seconds from when host is started.
  */
 uint32_t lwb_get_host_time();
 
+#if LWB_NET_TIME_ON
+/**
+ * @brief Get the current network time, the rtimer time of the host since it started.
+ * @param nt Network time
+ * @return LWB_STATUS_SUCCESS, or LWB_STATUS_FAIL if the node is not synchronized.
+ */
+lwb_status_t lwb_get_net_time(lwb_net_time_t* nt);
+
+/**
+ * @brief Convert a local rtimer time to network time.
+ * @param t Local rtimer time, within 18 hours of the last schedule
+ * @param nt Network time
+ * @return LWB_STATUS_SUCCESS, or LWB_STATUS_FAIL if the node is not synchronized.
+ */
+lwb_status_t lwb_net_time_from_rtimer(rtimer_clock_t t, lwb_net_time_t* nt);
+
+/**
+ * @brief Convert a MAC timer value (e.g. an SFD timestamp of the radio) to network time.
+ * @param t_mt MAC timer value, within 67 seconds of now
+ * @param nt Network time
+ * @return LWB_STATUS_SUCCESS, or LWB_STATUS_FAIL if the node is not synchronized.
+ */
+lwb_status_t lwb_net_time_from_mac_time(uint64_t t_mt, lwb_net_time_t* nt);
+
+/**
+ * @brief Convert a network time to local rtimer time.
+ * @param nt Network time, within 18 hours of the last schedule
+ * @param t Local rtimer time
+ * @return LWB_STATUS_SUCCESS, or LWB_STATUS_FAIL if the node is not synchronized.
+ */
+lwb_status_t lwb_net_time_to_rtimer(lwb_net_time_t nt, rtimer_clock_t* t);
+
+/**
+ * @brief Get the bound of the error of the network time. It grows with the time since the last
+ *        received schedule by the skew error measured at that schedule.
+ * @return Error bound in rtimer ticks. Zero on the host, LWB_NET_TIME_UNSYNCED if the node is not
+ *         synchronized.
+ */
+rtimer_clock_t lwb_get_net_time_error();
+
+/**
+ * @brief Get the network time of the packet being delivered, i.e. the start of the flood that
+ *        carried it as measured by Glossy, or its scheduled start if the flood gave no
+ *        reference. Only valid within the p_on_data callback.
+ * @param nt Network time
+ * @return LWB_STATUS_SUCCESS, or LWB_STATUS_FAIL if called outside p_on_data or not synchronized.
+ */
+lwb_status_t lwb_get_rx_net_time(lwb_net_time_t* nt);
+
+/**
+ * @brief Call a function at a network time. Only one call can be pending, a new one replaces it.
+ *        The node sleeps on the clock until T_NET_TIME_RTIMER before the time and waits for the
+ *        rest on the rtimer. The time is converted again when the node wakes up to follow skew
+ *        updates.
+ * @param nt Network time
+ * @param func Function to be called in the rtimer interrupt, it must return quickly
+ * @param ptr Argument of func
+ * @return LWB_STATUS_SUCCESS, or LWB_STATUS_FAIL if the node is not synchronized or the time
+ *         has passed.
+ */
+lwb_status_t lwb_net_time_schedule(lwb_net_time_t nt, void (*func)(void*), void* ptr);
+
+/**
+ * @brief Cancel the call scheduled with lwb_net_time_schedule().
+ */
+void lwb_net_time_cancel();
+#endif /* LWB_NET_TIME_ON */
+
 /**
  * @brief Request from LWB host to add a stream for the node.
  * @param ipi Inter-packet interval in seconds.
- * @param t_offset The time offset when the slot should be allocated.
+ * @param t_offset The time offset when the slot should be allocated. With LWB_CONF_SCHED_PHASE,
+ *        the slots of the stream are allocated at the host times t_offset + k * ipi (seconds,
+ *        rounded up to the next round), or at a time the host chooses with LWB_STREAM_PHASE_ANY.
  * @return The ID of the stream
  */
 uint8_t lwb_request_stream_add(uint16_t ipi, uint16_t t_offset);
 
+#if LWB_SLOT_CLASSES_ON
+/**
+ * @brief Request from LWB host to add a stream with a known maximum payload size.
+ *        The host gives the slots of the node a duration that fits the largest payload of all of
+ *        its streams. Packets must not be larger than the declared size.
+ * @param ipi Inter-packet interval in seconds.
+ * @param t_offset The time offset when the slot should be allocated.
+ * @param max_len Maximum length of the packets of the stream.
+ * @return The ID of the stream
+ */
+uint8_t lwb_request_stream_add_max_len(uint16_t ipi, uint16_t t_offset, uint8_t max_len);
+#endif /* LWB_SLOT_CLASSES_ON */
+
 /**
  * @brief Request from LWB host to delete a stream for the node
  * @param id The stream ID
@@ -93,6 +209,7 @@ void lwb_request_stream_del(uint8_t id);
  * @brief Request from LWB host to modify a stream request.
  * @param id The ID of the stream to be modified.
  * @param ipi New inter-packet interval
+ * @note  With LWB_CONF_SCHED_PHASE, the stream keeps its time offset.
  */
 void lwb_request_stream_mod(uint8_t id, uint16_t ipi);
 
@@ -102,6 +219,14 @@ void lwb_request_stream_mod(uint8_t id, uint16_t ipi);
  */
 uint8_t lwb_get_n_my_slots();
 
+#if LWB_SHORT_ADDR_ON
+/**
+ * @brief Get the short address the host assigned to the node
+ * @return Short address used in the schedules, zero if none has been received yet
+ */
+uint8_t lwb_get_short_addr();
+#endif /* LWB_SHORT_ADDR_ON */
+
 /**
  * @brief Get LWB joining state
  * @return one of the states from @link lwb_joining_state_t
@@ -0,0 +1,27 @@
+/*
+ * Minimal stand-in for contiki.h, just enough for the host tests of this directory.
+ */
+
+#ifndef CONTIKI_H_
+#define CONTIKI_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sys/pt.h"
+
+typedef uint32_t rtimer_clock_t;
+struct rtimer { rtimer_clock_t time; };
+typedef void (*rtimer_callback_t)(struct rtimer *t, void *ptr);
+#define RTIMER_SECOND                   32768
+
+#ifndef MIN
+#define MIN(a, b)                       ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                       ((a) > (b) ? (a) : (b))
+#endif
+
+struct process { int unused; };
+
+#endif /* CONTIKI_H_ */
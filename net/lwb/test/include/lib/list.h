@@ -0,0 +1,19 @@
+/*
+ * Minimal stand-in for lib/list.h, implemented by the host test itself.
+ */
+
+#ifndef LIST_H_
+#define LIST_H_
+
+#define LIST(name) \
+  static void *name##_list = NULL; \
+  static list_t name = (list_t)&name##_list
+
+typedef void ** list_t;
+
+void  list_init(list_t list);
+void *list_head(list_t list);
+void  list_add(list_t list, void *item);
+void  list_remove(list_t list, void *item);
+
+#endif /* LIST_H_ */
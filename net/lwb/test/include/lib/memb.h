@@ -0,0 +1,24 @@
+/*
+ * Minimal stand-in for lib/memb.h, implemented by the host test itself.
+ */
+
+#ifndef MEMB_H_
+#define MEMB_H_
+
+struct memb {
+  unsigned short size;
+  unsigned short num;
+  char *count;
+  void *mem;
+};
+
+#define MEMB(name, structure, num) \
+  static char name##_memb_count[num]; \
+  static structure name##_memb_mem[num]; \
+  static struct memb name = {sizeof(structure), num, name##_memb_count, (void *)name##_memb_mem}
+
+void  memb_init(struct memb *m);
+void *memb_alloc(struct memb *m);
+char  memb_free(struct memb *m, void *ptr);
+
+#endif /* MEMB_H_ */
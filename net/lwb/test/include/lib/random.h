@@ -0,0 +1,10 @@
+/*
+ * Minimal stand-in for lib/random.h, just enough for the host tests of this directory.
+ */
+
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+unsigned short random_rand(void);
+
+#endif /* RANDOM_H_ */
@@ -0,0 +1,12 @@
+/*
+ * Minimal stand-in for sys/pt.h, just enough for the host tests of this directory.
+ */
+
+#ifndef PT_H_
+#define PT_H_
+
+struct pt { unsigned short lc; };
+
+#define PT_THREAD(name_args)            char name_args
+
+#endif /* PT_H_ */
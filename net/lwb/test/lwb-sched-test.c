@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2026, Uppsala University, Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file   lwb-sched-test.c
+ *
+ * Host test of the host slots of lwb-scheduler-static.c. The host gets one data slot per packet in
+ * its TX queue, up to LWB_HOST_SLOTS_SHARE percent of the round's bandwidth and at least one slot.
+ * The host slots (owner 0) follow the stream slots, and the streams get exactly the rest of the
+ * round. This is checked with an empty network and with one whose streams want more than the
+ * round can take, for TX queues from empty to longer than the share.
+ *
+ * Build and run from this directory:
+ *
+ *   gcc -Wall -fshort-enums -Iinclude -I.. -I../../glossy -DLWB_CONF_HOST_SLOTS=1 \
+ *       -DLWB_CONF_MAX_N_STREAMS=64 -o lwb-sched-test lwb-sched-test.c ../lwb-scheduler-static.c
+ *   ./lwb-sched-test
+ *
+ * Add -DLWB_CONF_SCHED_PIN_SLOTS=1 or -DLWB_CONF_HOST_SLOTS_SHARE=50 (or any other share) to check
+ * those configurations. The include directory holds minimal stand-ins for the Contiki headers.
+ * The exit status is non-zero if any check failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "lwb-common.h"
+#include "lwb-scheduler.h"
+
+/* Streams offered to the scheduler, more than any round can take */
+#define N_STREAMS           64
+/* Round period of lwb-scheduler-static.c, so that each stream has one packet per round */
+#define ROUND_PERIOD        5
+/* Longer than the host's share of any round */
+#define Q_LONG              255
+
+#if !LWB_HOST_SLOTS_ON
+#error "Build with -DLWB_CONF_HOST_SLOTS=1"
+#endif
+
+lwb_context_t lwb_context;
+
+static uint8_t tx_q_size;
+static unsigned n_failed;
+
+#define CHECK(cond, ...) \
+  do { \
+    if (!(cond)) { \
+      printf("FAIL: " __VA_ARGS__); \
+      printf("\n"); \
+      n_failed++; \
+    } \
+  } while (0)
+
+/* ---------------------------------------------------------------------------------------------- */
+/* The scheduler's view of the host's TX queue */
+uint8_t lwb_g_rr_get_tx_q_size()
+{
+  return tx_q_size;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Contiki's list and memb, enough for the scheduler */
+void list_init(list_t list)
+{
+  *list = NULL;
+}
+
+void *list_head(list_t list)
+{
+  return *list;
+}
+
+void list_add(list_t list, void *item)
+{
+  struct item { struct item *next; } *l;
+
+  list_remove(list, item);
+  ((struct item *)item)->next = NULL;
+  l = *list;
+  if (l == NULL) {
+    *list = item;
+    return;
+  }
+  while (l->next != NULL) {
+    l = l->next;
+  }
+  l->next = item;
+}
+
+void list_remove(list_t list, void *item)
+{
+  struct item { struct item *next; } *l, *r;
+
+  for (l = *list, r = NULL; l != NULL; r = l, l = l->next) {
+    if (l == item) {
+      if (r == NULL) {
+        *list = l->next;
+      } else {
+        r->next = l->next;
+      }
+      l->next = NULL;
+      return;
+    }
+  }
+}
+
+void memb_init(struct memb *m)
+{
+  memset(m->count, 0, m->num);
+  memset(m->mem, 0, (size_t)m->size * m->num);
+}
+
+void *memb_alloc(struct memb *m)
+{
+  unsigned short i;
+
+  for (i = 0; i < m->num; i++) {
+    if (m->count[i] == 0) {
+      m->count[i] = 1;
+      return (char *)m->mem + (size_t)i * m->size;
+    }
+  }
+  return NULL;
+}
+
+char memb_free(struct memb *m, void *ptr)
+{
+  m->count[((char *)ptr - (char *)m->mem) / m->size] = 0;
+  return 0;
+}
+
+unsigned short random_rand(void)
+{
+  return (unsigned short)rand();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+static void sched_reset(void)
+{
+  memset(&lwb_context, 0, sizeof(lwb_context));
+  lwb_sched_init();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Offer N_STREAMS streams of one packet per round each. The scheduler admits what fits */
+static void add_streams(void)
+{
+  lwb_stream_req_t req;
+  uint16_t node_id;
+
+  for (node_id = 1; node_id <= N_STREAMS; node_id++) {
+    memset(&req, 0, sizeof(req));
+    req.ipi = ROUND_PERIOD;
+    LWB_SET_STREAM_ID(req.req_type, 1);
+    LWB_SET_STREAM_TYPE(req.req_type, LWB_STREAM_TYPE_ADD);
+    lwb_sched_process_stream_req(node_id, &req);
+  }
+  /* The stream acknowledgements are assumed sent, they are not what is tested here */
+  lwb_context.n_stream_acks = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Compute one round and count its stream and host slots. Returns the number of data slots */
+static uint8_t run_round(uint8_t q_size, uint8_t* n_host, uint8_t* n_stream)
+{
+  lwb_schedule_t sched;
+  uint8_t n_slots, i;
+
+  memset(&sched, 0, sizeof(sched));
+  tx_q_size = q_size;
+  lwb_sched_compute_schedule(&sched);
+  n_slots = LWB_GET_N_DATA_SLOTS(sched.sched_info.n_slots);
+
+  *n_host = 0;
+  *n_stream = 0;
+  for (i = 0; i < n_slots; i++) {
+    if (sched.slots[i] == 0) {
+      (*n_host)++;
+    } else {
+      (*n_stream)++;
+      CHECK(*n_host == 0, "q %u: stream slot %u after a host slot", q_size, i);
+    }
+  }
+  return n_slots;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+int main(void)
+{
+  static const uint8_t q_sizes[] = {0, 1, 2, 3, 5, 8, 13, 21, 34, Q_LONG};
+  uint8_t n_slots, n_host, n_stream, max_bw, share, expected;
+  uint8_t i;
+
+  /* Saturated network. With an empty TX queue the streams take the whole round */
+  sched_reset();
+  add_streams();
+  n_slots = run_round(0, &n_host, &n_stream);
+  max_bw = n_slots;
+  CHECK(max_bw > 0 && max_bw <= LWB_SCHED_MAX_SLOTS, "round of %u slots", max_bw);
+  CHECK(n_host == 0, "q 0: %u host slots", n_host);
+  share = MAX(1, max_bw * LWB_HOST_SLOTS_SHARE / 100);
+
+  for (i = 0; i < sizeof(q_sizes); i++) {
+    expected = MIN(q_sizes[i], share);
+    n_slots = run_round(q_sizes[i], &n_host, &n_stream);
+    CHECK(n_host == expected, "q %u: %u host slots, expected %u", q_sizes[i], n_host, expected);
+    CHECK(n_slots == max_bw, "q %u: %u data slots, expected %u", q_sizes[i], n_slots, max_bw);
+    CHECK(n_stream == max_bw - expected, "q %u: %u stream slots, expected %u", q_sizes[i],
+          n_stream, max_bw - expected);
+  }
+
+  /* Empty network: the host slots are all there is */
+  sched_reset();
+  for (i = 0; i < sizeof(q_sizes); i++) {
+    expected = MIN(q_sizes[i], share);
+    n_slots = run_round(q_sizes[i], &n_host, &n_stream);
+    CHECK(n_host == expected, "no streams, q %u: %u host slots, expected %u", q_sizes[i], n_host,
+          expected);
+    CHECK(n_slots == n_host, "no streams, q %u: %u data slots", q_sizes[i], n_slots);
+  }
+
+  printf("LWB_HOST_SLOTS_SHARE %u, round of %u slots, host share %u slots\n",
+         LWB_HOST_SLOTS_SHARE, max_bw, share);
+  if (n_failed) {
+    printf("FAILED (%u)\n", n_failed);
+    return 1;
+  }
+  printf("PASSED\n");
+  return 0;
+}